@@ -1,7 +1,7 @@
 #!/bin/bash
 
 # =================================================================
-# Script para encontrar el mejor K (menor MAPE) - CORREGIDO
+# Script para encontrar el mejor K (menor MAPE) - UNA SOLA EJECUCIÓN
 # =================================================================
 
 K_MIN=1
@@ -34,44 +34,39 @@ if [ ! -f ./prediccion ]; then
     exit 1
 fi
 
-printf "%-5s | %-15s | %-15s\n" "K" "MAPE (%)" "TIEMPO (s)"
+# Una sola ejecución con K = K_MAX: el programa guarda los K_MAX mejores vecinos de cada día
+# y calcula el MAPE de todos los k <= K_MAX (MAPE_por_k.txt) y el mejor k (best_k.txt)
+rm -f MAPE_por_k.txt
+output=$(mpirun -np $NUM_PROCS --oversubscribe ./prediccion $K_MAX $FICHERO_DATOS $NUM_PROCS $NUM_HILOS --barrido 2>&1)
+tiempo=$(echo "$output" | grep "Tiempo Total:" | awk '{print $3}' | sed 's/s//')
+
+if [ -z "$tiempo" ] || [ ! -f MAPE_por_k.txt ] || [ ! -f best_k.txt ]; then
+    echo -e "${RED}FALLO en la ejecución del barrido:${NC}"
+    echo "$output"
+    exit 1
+fi
+
+printf "%-5s | %-15s\n" "K" "MAPE (%)"
 echo "----------------------------------------"
 
+# Saltamos la cabecera de la tabla y buscamos el mínimo dentro de [K_MIN, K_MAX]
 best_k=0
 min_mape=100000.0
-
-for k in $(seq $K_MIN $K_MAX); do
-    # Ejecutamos capturando stderr también por si hay fallos
-    output=$(mpirun -np $NUM_PROCS --oversubscribe ./prediccion $k $FICHERO_DATOS $NUM_PROCS $NUM_HILOS 2>&1)
-    
-    # --- CORRECCIÓN CRÍTICA AQUÍ ---
-    # 1. Buscamos "MAPE Medio:" en lugar de "RESULTADO_MAPE:"
-    # 2. Cogemos la columna 3 (awk '{print $3}') porque la salida es "MAPE Medio: X.XX%"
-    # 3. Quitamos el símbolo '%' (sed 's/%//')
-    mape=$(echo "$output" | grep "MAPE Medio:" | awk '{print $3}' | sed 's/%//')
-    tiempo=$(echo "$output" | grep "Tiempo Total:" | awk '{print $3}' | sed 's/s//')
-    
-    # Si no se encontró el número, marcamos fallo
-    if [ -z "$mape" ]; then
-        echo -e "$k     | ${RED}FALLO${NC}           | -"
+while read -r k mape; do
+    if [ "$k" -lt "$K_MIN" ]; then
         continue
     fi
-
-    printf "%-5d | %-15s | %-15s\n" "$k" "$mape" "$tiempo"
-
-    # Comparar flotantes con awk para ver si es el mejor hasta ahora
+    printf "%-5d | %-15s\n" "$k" "$mape"
     es_mejor=$(awk -v n1="$mape" -v n2="$min_mape" 'BEGIN {if (n1<n2) print 1; else print 0}')
-    
     if [ "$es_mejor" -eq 1 ]; then
         min_mape=$mape
         best_k=$k
     fi
-done
+done < <(tail -n +2 MAPE_por_k.txt)
 
 echo "----------------------------------------"
-echo -e "El mejor K es: ${GREEN}$best_k${NC} con un MAPE de ${GREEN}$min_mape%${NC}"
+echo -e "El mejor K es: ${GREEN}$best_k${NC} con un MAPE de ${GREEN}$min_mape%${NC} (barrido completo en ${tiempo}s)"
 echo "----------------------------------------"
-
 # Guardamos el mejor K en un fichero para que el otro script lo use
 echo $best_k > best_k.txt
-echo "Valor K guardado en 'best_k.txt'."
\ No newline at end of file
+echo "Valor K guardado en 'best_k.txt'."
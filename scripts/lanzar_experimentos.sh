@@ -4,6 +4,10 @@
 # SCRIPT DE AUTOMATIZACIÓN DE EXPERIMENTOS (Matriz Completa)
 # =================================================================
 # Ejecuta las 48 combinaciones requeridas por el enunciado.
+# Con --un-lanzamiento se ejecutan todas en un solo mpirun (./prediccion --experimentos):
+# cada fichero se lee una vez y los resultados quedan también en experimentos.csv.
+# Predicciones.txt/MAPE.txt se sobrescriben en cada configuración (solo queda la última);
+# experimentos.csv y Tiempo.txt guardan todas. El script termina con el código de mpirun.
 
 # 1. Detectar el K óptimo (o usar 5 si no se encuentra)
 if [ -f best_k.txt ]; then
@@ -30,6 +34,31 @@ FILES=("data/datos_1X.txt" "data/datos_10X.txt" "data/datos_100X.txt")
 PROCS=(1 2 3 4)
 THREADS=(1 2 3 4)
 
+if [ "$1" == "--un-lanzamiento" ]; then
+    MATRIZ="matriz_experimentos.txt"
+    MAX_PROCS=$(printf "%s\n" "${PROCS[@]}" | sort -n | tail -1)
+    echo "# Generado por lanzar_experimentos.sh: <ficheros> <K> <procesos> <hilos>" > $MATRIZ
+    for fichero in "${FILES[@]}"; do
+        if [ ! -f "$fichero" ]; then
+            echo "SALTANDO: $fichero (No existe)"
+            continue
+        fi
+        echo "$fichero $K_OPT $(IFS=,; echo "${PROCS[*]}") $(IFS=,; echo "${THREADS[*]}")" >> $MATRIZ
+    done
+
+    mpirun -np $MAX_PROCS --oversubscribe ./prediccion --experimentos=$MATRIZ
+    estado=$?
+    if [ $estado -eq 0 ]; then
+        echo "-----------------------------------------------------------------------"
+        echo " ¡EXPERIMENTOS COMPLETADOS! Resultados en $OUTPUT_FILE y experimentos.csv"
+        echo " (Predicciones.txt y MAPE.txt son solo los de la última configuración)"
+        echo "-----------------------------------------------------------------------"
+    else
+        echo "FALLÓ (código $estado)"
+    fi
+    exit $estado
+fi
+
 # Contadores para barra de progreso
 total_tests=$((${#FILES[@]} * ${#PROCS[@]} * ${#THREADS[@]}))
 current=0
@@ -1,9 +1,13 @@
 import matplotlib.pyplot as plt
 import re
 import os
+import sys
+import csv
+import json
 
 # Configuración
-INPUT_FILE = "Tiempo.txt"
+INPUT_FILE = "Tiempo.txt"   # O el experimentos.csv de --experimentos: python3 plot_results.py experimentos.csv
+TRAZA_FILE = "traza.json"   # Generado con --traza
 OUTPUT_DIR = "graficas"
 
 if not os.path.exists(OUTPUT_DIR):
@@ -33,6 +37,21 @@ def parse_file(filename):
         print(f"Error: No se encuentra el archivo {filename}")
         return None
 
+def parse_csv(filename):
+    """Lee la tabla de --experimentos (experimentos.csv) con la misma estructura que parse_file."""
+    data = {}
+    try:
+        with open(filename, newline='') as f:
+            for fila in csv.DictReader(f):
+                fich_name = fila["fichero"].split("/")[-1]
+                procs = int(fila["procesos"])
+                hilos = int(fila["hilos"])
+                data.setdefault(fich_name, {}).setdefault(procs, {})[hilos] = float(fila["t_total"])
+        return data
+    except FileNotFoundError:
+        print(f"Error: No se encuentra el archivo {filename}")
+        return None
+
 def plot_mpi_scalability(data):
     """Gráfica 1: Tiempo vs Procesos (con Hilos fijos a 1) para ver impacto MPI."""
     plt.figure(figsize=(10, 6))
@@ -132,12 +151,42 @@ def plot_oversubscription_100x(data):
     plt.savefig(f"{OUTPUT_DIR}/analisis_saturacion_100x.png")
     print(f"Generada: {OUTPUT_DIR}/analisis_saturacion_100x.png")
 
+def plot_traza(filename):
+    """Gráfica 4: tiempo de cada fase por proceso (de traza.json) para ver desequilibrios."""
+    try:
+        with open(filename, 'r') as f:
+            traza = json.load(f)
+    except FileNotFoundError:
+        print(f"Aviso: No hay {filename} (ejecuta con --traza) para la gráfica de fases.")
+        return
+
+    ambitos = traza["ambitos"]
+    procesos = range(traza["procesos"])
+    plt.figure(figsize=(12, 7))
+    base = [0.0] * traza["procesos"]
+    for nombre, datos in ambitos.items():
+        valores = datos["por_proceso"]
+        plt.bar([f"P{p}" for p in procesos], valores, bottom=base,
+                label=f"{nombre} (deseq. {datos['desequilibrio']:.2f})")
+        base = [b + v for b, v in zip(base, valores)]
+
+    plt.title("Tiempo por fase y proceso (hilo más lento de cada proceso)")
+    plt.xlabel("Proceso MPI")
+    plt.ylabel("Tiempo (segundos)")
+    plt.grid(axis='y', linestyle='--', alpha=0.5)
+    plt.legend(fontsize=8)
+    plt.tight_layout()
+    plt.savefig(f"{OUTPUT_DIR}/fases_por_proceso.png")
+    print(f"Generada: {OUTPUT_DIR}/fases_por_proceso.png")
+
 if __name__ == "__main__":
-    datos = parse_file(INPUT_FILE)
+    entrada = sys.argv[1] if len(sys.argv) > 1 else INPUT_FILE
+    datos = parse_csv(entrada) if entrada.endswith(".csv") else parse_file(entrada)
     if datos:
         plot_mpi_scalability(datos)
         plot_openmp_scalability(datos)
         plot_oversubscription_100x(datos)
+        plot_traza(TRAZA_FILE)
         print("\n¡Proceso completado! Revisa la carpeta 'graficas'.")
     else:
         print("No se pudieron generar las gráficas.")
\ No newline at end of file
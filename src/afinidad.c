@@ -0,0 +1,122 @@
+/*
+ * src/afinidad.c
+ * Fijación de los hilos OpenMP de cada proceso a CPUs concretas.
+ */
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <mpi.h>
+#include <omp.h>
+#ifdef __linux__
+#include <sched.h>
+#endif
+#include "afinidad.h"
+
+#define MASTERPID 0
+
+#ifdef __linux__
+
+// CPUs permitidas al proceso, en orden creciente. Devuelve cuántas hay.
+static int cpus_permitidas(cpu_set_t *mascara, int *cpus) {
+    int n = 0;
+    for (int c = 0; c < CPU_SETSIZE; c++) {
+        if (CPU_ISSET(c, mascara)) cpus[n++] = c;
+    }
+    return n;
+}
+
+void aplicar_afinidad(TipoAfinidad tipo, MPI_Comm comm) {
+    if (tipo == AFINIDAD_NINGUNA) return;
+
+    int pid, num_procs;
+    MPI_Comm_rank(comm, &pid);
+    MPI_Comm_size(comm, &num_procs);
+
+    // Procesos del mismo nodo
+    MPI_Comm nodo;
+    int pid_nodo, procs_nodo;
+    MPI_Comm_split_type(comm, MPI_COMM_TYPE_SHARED, pid, MPI_INFO_NULL, &nodo);
+    MPI_Comm_rank(nodo, &pid_nodo);
+    MPI_Comm_size(nodo, &procs_nodo);
+
+    cpu_set_t mascara;
+    CPU_ZERO(&mascara);
+    if (sched_getaffinity(0, sizeof(mascara), &mascara) != 0) {
+        perror("[AFINIDAD] sched_getaffinity");
+        MPI_Comm_free(&nodo);
+        return;
+    }
+
+    // ¿Comparten todos los procesos del nodo el mismo conjunto de CPUs?
+    int palabras = (int)(sizeof(cpu_set_t) / sizeof(unsigned long));
+    unsigned long *union_nodo = (unsigned long *)malloc(sizeof(cpu_set_t));
+    unsigned long *interseccion = (unsigned long *)malloc(sizeof(cpu_set_t));
+    int *cpus = (int *)malloc(CPU_SETSIZE * sizeof(int));
+    if (union_nodo == NULL || interseccion == NULL || cpus == NULL) {
+        fprintf(stderr, "[ERROR P%d] Sin memoria para la afinidad\n", pid);
+        MPI_Abort(MPI_COMM_WORLD, EXIT_FAILURE);
+    }
+    MPI_Allreduce(&mascara, union_nodo, palabras, MPI_UNSIGNED_LONG, MPI_BOR, nodo);
+    MPI_Allreduce(&mascara, interseccion, palabras, MPI_UNSIGNED_LONG, MPI_BAND, nodo);
+    int compartido = (memcmp(union_nodo, interseccion, sizeof(cpu_set_t)) == 0);
+    int num_cpus = cpus_permitidas(&mascara, cpus);
+
+    int hilos = omp_get_max_threads();
+    int *cpu_hilo = (int *)malloc(hilos * sizeof(int));
+    if (cpu_hilo == NULL) {
+        fprintf(stderr, "[ERROR P%d] Sin memoria para la afinidad\n", pid);
+        MPI_Abort(MPI_COMM_WORLD, EXIT_FAILURE);
+    }
+    for (int t = 0; t < hilos; t++) {
+        int posicion;
+        if (!compartido) posicion = t;
+        else if (tipo == AFINIDAD_COMPACTA) posicion = pid_nodo * hilos + t;
+        else posicion = t * procs_nodo + pid_nodo;
+        cpu_hilo[t] = cpus[posicion % num_cpus];
+    }
+
+    int fallos = 0;
+    #pragma omp parallel reduction(+:fallos)
+    {
+        cpu_set_t propia;
+        CPU_ZERO(&propia);
+        CPU_SET(cpu_hilo[omp_get_thread_num()], &propia);
+        if (sched_setaffinity(0, sizeof(propia), &propia) != 0) fallos++;
+    }
+    if (fallos > 0) fprintf(stderr, "[AVISO P%d] %d hilos no se pudieron fijar a su CPU\n", pid, fallos);
+
+    // Informe: CPU de cada hilo de cada proceso
+    int *todas = NULL;
+    if (pid == MASTERPID) todas = (int *)malloc((long)num_procs * hilos * sizeof(int));
+    MPI_Gather(cpu_hilo, hilos, MPI_INT, todas, hilos, MPI_INT, MASTERPID, comm);
+    if (pid == MASTERPID && todas) {
+        printf("[AFINIDAD] %s%s:", tipo == AFINIDAD_COMPACTA ? "compacta" : "dispersa",
+               compartido ? "" : " (dentro de las CPUs asignadas por el lanzador)");
+        for (int p = 0; p < num_procs; p++) {
+            printf(" P%d->", p);
+            for (int t = 0; t < hilos; t++) printf("%s%d", t ? "," : "", todas[(long)p * hilos + t]);
+        }
+        printf("\n");
+    }
+
+    free(todas);
+    free(cpu_hilo);
+    free(cpus);
+    free(union_nodo);
+    free(interseccion);
+    MPI_Comm_free(&nodo);
+}
+
+#else
+
+void aplicar_afinidad(TipoAfinidad tipo, MPI_Comm comm) {
+    int pid;
+    MPI_Comm_rank(comm, &pid);
+    if (tipo != AFINIDAD_NINGUNA && pid == MASTERPID) {
+        printf("[AVISO] --afinidad solo está disponible en Linux; se ignora\n");
+    }
+}
+
+#endif
@@ -0,0 +1,18 @@
+#ifndef AFINIDAD_H
+#define AFINIDAD_H
+
+#include <mpi.h>
+#include "opciones.h"
+
+// Fijación de los hilos OpenMP a CPUs (Linux, sched_setaffinity).
+// Las CPUs candidatas son las que el lanzador deja usar al proceso. Si todos los procesos de un
+// nodo ven el mismo conjunto (mpirun --bind-to none), se reparte entre ellos:
+//   compacta: el proceso local r ocupa las CPUs r*H .. r*H + H - 1 (H = hilos por proceso)
+//   dispersa: el hilo t del proceso local r va a la CPU t*R + r (R = procesos del nodo)
+// Si el lanzador ya ha dado a cada proceso sus propias CPUs, los hilos se reparten dentro de ellas.
+// Debe llamarse antes de reservar los datos, para que el primer toque ya ocurra en su CPU.
+
+// Colectiva sobre 'comm'. El Master imprime la CPU de cada hilo de cada proceso.
+void aplicar_afinidad(TipoAfinidad tipo, MPI_Comm comm);
+
+#endif
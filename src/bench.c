@@ -0,0 +1,609 @@
+/*
+ * src/bench.c
+ * Banco de pruebas de rendimiento (make bench): micro-pruebas de los núcleos del cálculo y una
+ * ejecución completa de ejecutar_predicciones, todo con datos sintéticos generados aquí.
+ *
+ * Uso: mpirun -np P ./benchmark [--salida=f.csv] [--comparar=base.csv] [--umbral=0.10]
+ *                               [--repeticiones=N] [--rapido]
+ *
+ * Cada prueba se calibra una vez (iteraciones para durar al menos TIEMPO_MUESTRA) y después se
+ * toman N muestras; se informa de la mediana, el mínimo, la media y la dispersión relativa
+ * (desviación absoluta mediana / mediana). En las colectivas cada muestra es la del proceso más
+ * lento. Con --comparar se marca como regresión toda prueba cuya mediana empeore más que el
+ * umbral y que el ruido de ambas medidas; en ese caso el programa termina con error.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <mpi.h>
+#include <omp.h>
+#include "utils.h"
+#include "k_nn.h"
+#include "opciones.h"
+#include "distancia.h"
+#include "vecinos.h"
+
+#define MASTERPID 0
+#define TIEMPO_MUESTRA 0.02     // Segundos mínimos por muestra (se calibra el nº de iteraciones)
+#define REPETICIONES_DEFECTO 7
+#define UMBRAL_DEFECTO 0.10     // Empeoramiento relativo de la mediana que se considera regresión
+#define MAX_RESULTADOS 128
+#define NOMBRE_DATOS "datos_bench.txt"
+
+typedef struct {
+    char prueba[32];
+    char parametros[64];
+    char unidad[16];
+    int procesos;
+    int hilos;
+    int repeticiones;
+    double mediana;
+    double minimo;
+    double media;
+    double dispersion;      // MAD / mediana
+} ResultadoBench;
+
+typedef struct {
+    int repeticiones;
+    int rapido;
+    const char *salida;
+    const char *base;
+    double umbral;
+    int pid;
+    int num_procs;
+    ResultadoBench resultados[MAX_RESULTADOS];
+    int num_resultados;
+} ConfigBench;
+
+// Cada prueba hace una unidad de trabajo por llamada y devuelve cuántas operaciones contiene
+typedef double (*FuncPrueba)(void *args);
+
+static unsigned int semilla_lcg = 12345u;
+
+static float aleatorio_uniforme(void) {
+    semilla_lcg = semilla_lcg * 1664525u + 1013904223u;
+    return (float)(semilla_lcg >> 8) / 16777216.0f;
+}
+
+// Serie sintética determinista con ciclo diario y semanal y algo de ruido (como un consumo horario)
+static float valor_sintetico(long fila, int columna, int columnas) {
+    double t = (double)fila * columnas + columna;
+    unsigned int h = (unsigned int)(fila * 2654435761u) ^ (unsigned int)(columna * 40503u);
+    h = h * 1664525u + 1013904223u;
+    double ruido = ((h >> 8) / 16777216.0 - 0.5) * 10.0;
+    return (float)(100.0 + 30.0 * sin(2.0 * M_PI * t / columnas) + 15.0 * sin(2.0 * M_PI * t / (7.0 * columnas)) + ruido);
+}
+
+static int comparar_double(const void *a, const void *b) {
+    double x = *(const double *)a, y = *(const double *)b;
+    return (x > y) - (x < y);
+}
+
+// Silencia stdout mientras corre código que imprime su propio progreso
+static int silenciar_stdout(void) {
+    fflush(stdout);
+    int guardado = dup(STDOUT_FILENO);
+    int nulo = open("/dev/null", O_WRONLY);
+    if (nulo >= 0) {
+        dup2(nulo, STDOUT_FILENO);
+        close(nulo);
+    }
+    return guardado;
+}
+
+static void restaurar_stdout(int guardado) {
+    fflush(stdout);
+    if (guardado >= 0) {
+        dup2(guardado, STDOUT_FILENO);
+        close(guardado);
+    }
+}
+
+// Calibra, mide y guarda una prueba. 'escala' convierte segundos por operación a la unidad.
+static void medir(ConfigBench *cfg, const char *prueba, const char *parametros, const char *unidad, double escala,
+                  FuncPrueba f, void *args) {
+    // Calibración (y calentamiento): el Master decide cuándo una muestra dura TIEMPO_MUESTRA y
+    // todos hacen las mismas iteraciones, así las pruebas colectivas no se desparejan
+    long iteraciones = 0;
+    double operaciones = 0.0;
+    int seguir = 1;
+    MPI_Barrier(MPI_COMM_WORLD);
+    double t_inicio = MPI_Wtime();
+    while (seguir) {
+        operaciones += f(args);
+        iteraciones++;
+        seguir = (MPI_Wtime() - t_inicio < TIEMPO_MUESTRA);
+        MPI_Bcast(&seguir, 1, MPI_INT, MASTERPID, MPI_COMM_WORLD);
+    }
+    double ops_por_iteracion = operaciones / iteraciones;
+    MPI_Bcast(&ops_por_iteracion, 1, MPI_DOUBLE, MASTERPID, MPI_COMM_WORLD);
+
+    double *muestras = (double *)malloc(cfg->repeticiones * sizeof(double));
+    if (muestras == NULL) {
+        fprintf(stderr, "[ERROR] Sin memoria para las muestras\n");
+        MPI_Abort(MPI_COMM_WORLD, EXIT_FAILURE);
+    }
+    for (int r = 0; r < cfg->repeticiones; r++) {
+        MPI_Barrier(MPI_COMM_WORLD);
+        double t0 = MPI_Wtime();
+        for (long i = 0; i < iteraciones; i++) f(args);
+        double t = MPI_Wtime() - t0;
+        double t_max;
+        MPI_Allreduce(&t, &t_max, 1, MPI_DOUBLE, MPI_MAX, MPI_COMM_WORLD);
+        muestras[r] = t_max / (iteraciones * ops_por_iteracion) * escala;
+    }
+
+    if (cfg->pid == MASTERPID && cfg->num_resultados < MAX_RESULTADOS) {
+        ResultadoBench *res = &cfg->resultados[cfg->num_resultados++];
+        qsort(muestras, cfg->repeticiones, sizeof(double), comparar_double);
+        int n = cfg->repeticiones;
+        double mediana = (n % 2) ? muestras[n / 2] : 0.5 * (muestras[n / 2 - 1] + muestras[n / 2]);
+        double suma = 0.0;
+        for (int r = 0; r < n; r++) suma += muestras[r];
+        double *desvios = (double *)malloc(n * sizeof(double));
+        for (int r = 0; r < n; r++) desvios[r] = fabs(muestras[r] - mediana);
+        qsort(desvios, n, sizeof(double), comparar_double);
+        double mad = (n % 2) ? desvios[n / 2] : 0.5 * (desvios[n / 2 - 1] + desvios[n / 2]);
+        free(desvios);
+
+        snprintf(res->prueba, sizeof(res->prueba), "%s", prueba);
+        snprintf(res->parametros, sizeof(res->parametros), "%s", parametros);
+        snprintf(res->unidad, sizeof(res->unidad), "%s", unidad);
+        res->procesos = cfg->num_procs;
+        res->hilos = omp_get_max_threads();
+        res->repeticiones = n;
+        res->mediana = mediana;
+        res->minimo = muestras[0];
+        res->media = suma / n;
+        res->dispersion = (mediana > 0.0) ? mad / mediana : 0.0;
+        printf("%-16s %-28s %12.3f %-13s (min %.3f, disp %.1f%%)\n", prueba, parametros, mediana, unidad,
+               res->minimo, 100.0 * res->dispersion);
+        fflush(stdout);
+    }
+    free(muestras);
+}
+
+// ---------------------------------------------------------------------------------------------
+// Pruebas
+// ---------------------------------------------------------------------------------------------
+
+typedef struct {
+    const float *filas;
+    const float *patron;
+    int num_filas;
+    int columnas;
+    int stride;
+    volatile float sumidero;
+} ArgsDistancia;
+
+static double prueba_distancia(void *p) {
+    ArgsDistancia *a = (ArgsDistancia *)p;
+    float suma = 0.0f;
+    for (int i = 0; i < a->num_filas; i++) suma += calcular_distancia_sq(&a->filas[(long)i * a->stride], a->patron, a->columnas);
+    a->sumidero += suma;
+    return a->num_filas;
+}
+
+static void bench_distancia(ConfigBench *cfg) {
+    const int columnas[] = {24, 96, 384};
+    const int filas[] = {4096, 262144};
+    for (int c = 0; c < 3; c++) {
+        distancia_inicializar(columnas[c], SIMD_AUTO);
+        int stride = distancia_stride(columnas[c]);
+        for (int f = 0; f < 2; f++) {
+            int num_filas = cfg->rapido ? filas[f] / 8 : filas[f];
+            float *datos = reservar_filas_alineadas(num_filas + 1, stride);
+            if (datos == NULL) {
+                fprintf(stderr, "[ERROR] Sin memoria para la prueba de distancia\n");
+                MPI_Abort(MPI_COMM_WORLD, EXIT_FAILURE);
+            }
+            for (long i = 0; i <= num_filas; i++) {
+                for (int j = 0; j < columnas[c]; j++) datos[i * stride + j] = valor_sintetico(i, j, columnas[c]);
+            }
+            ArgsDistancia args = {datos, &datos[(long)num_filas * stride], num_filas, columnas[c], stride, 0.0f};
+            char parametros[64];
+            snprintf(parametros, sizeof(parametros), "columnas=%d filas=%d kernel=%s", columnas[c], num_filas,
+                     distancia_nombre_kernel());
+            medir(cfg, "distancia", parametros, "ns/fila", 1e9, prueba_distancia, &args);
+            free(datos);
+        }
+    }
+}
+
+typedef struct {
+    const float *distancias;
+    int num;
+    int k;
+    VecinoInterno *lista;
+} ArgsInsercion;
+
+static double prueba_insercion(void *p) {
+    ArgsInsercion *a = (ArgsInsercion *)p;
+    for (int j = 0; j < a->k; j++) {
+        a->lista[j].dist_sq = FLT_MAX;
+        a->lista[j].indice_dia = -1;
+    }
+    for (int i = 0; i < a->num; i++) insertar_vecino_ordenado(a->lista, a->k, i, a->distancias[i]);
+    return a->num;
+}
+
+static void bench_insercion(ConfigBench *cfg) {
+    const int valores_k[] = {4, 32, 256};
+    int num = cfg->rapido ? 100000 : 1000000;
+    float *aleatorio = (float *)malloc(num * sizeof(float));
+    float *decreciente = (float *)malloc(num * sizeof(float));
+    VecinoInterno *lista = (VecinoInterno *)malloc(256 * sizeof(VecinoInterno));
+    if (aleatorio == NULL || decreciente == NULL || lista == NULL) {
+        fprintf(stderr, "[ERROR] Sin memoria para la prueba de inserción\n");
+        MPI_Abort(MPI_COMM_WORLD, EXIT_FAILURE);
+    }
+    for (int i = 0; i < num; i++) {
+        aleatorio[i] = aleatorio_uniforme();
+        decreciente[i] = (float)(num - i);
+    }
+    // Flujo aleatorio (casi todo se rechaza, como en un recorrido real) y decreciente (todo entra)
+    for (int ik = 0; ik < 3; ik++) {
+        char parametros[64];
+        ArgsInsercion args = {aleatorio, num, valores_k[ik], lista};
+        snprintf(parametros, sizeof(parametros), "k=%d flujo=aleatorio", valores_k[ik]);
+        medir(cfg, "insercion", parametros, "ns/candidato", 1e9, prueba_insercion, &args);
+        args.distancias = decreciente;
+        args.num = num / 100;   // El peor caso es O(K) por candidato
+        snprintf(parametros, sizeof(parametros), "k=%d flujo=decreciente", valores_k[ik]);
+        medir(cfg, "insercion", parametros, "ns/candidato", 1e9, prueba_insercion, &args);
+    }
+    free(aleatorio);
+    free(decreciente);
+    free(lista);
+}
+
+typedef struct {
+    const VecinoInterno *buffer_hilos;
+    int num_hilos;
+    long separacion;
+    int k;
+    VecinoInterno *destino;
+} ArgsFusion;
+
+static double prueba_fusion(void *p) {
+    ArgsFusion *a = (ArgsFusion *)p;
+    fusionar_listas_hilos(a->buffer_hilos, a->num_hilos, a->separacion, a->k, a->destino);
+    return 1.0;
+}
+
+// Listas ordenadas de K vecinos con distancias crecientes e índices distintos por lista
+static void rellenar_listas(VecinoInterno *listas, int num_listas, long separacion, int k, int semilla) {
+    for (int l = 0; l < num_listas; l++) {
+        float d = 0.0f;
+        for (int j = 0; j < k; j++) {
+            d += aleatorio_uniforme();
+            listas[l * separacion + j].dist_sq = d;
+            listas[l * separacion + j].indice_dia = (semilla + l) * k + j;
+        }
+    }
+}
+
+static void bench_fusion(ConfigBench *cfg) {
+    const int valores_k[] = {4, 32, 256};
+    const int hilos[] = {4, 16, 64};
+    for (int ik = 0; ik < 3; ik++) {
+        for (int ih = 0; ih < 3; ih++) {
+            int k = valores_k[ik];
+            long separacion = (k + 7) / 8 * 8;
+            VecinoInterno *buffer = (VecinoInterno *)malloc(hilos[ih] * separacion * sizeof(VecinoInterno));
+            VecinoInterno *destino = (VecinoInterno *)malloc(k * sizeof(VecinoInterno));
+            if (buffer == NULL || destino == NULL) {
+                fprintf(stderr, "[ERROR] Sin memoria para la prueba de fusión\n");
+                MPI_Abort(MPI_COMM_WORLD, EXIT_FAILURE);
+            }
+            rellenar_listas(buffer, hilos[ih], separacion, k, 0);
+            ArgsFusion args = {buffer, hilos[ih], separacion, k, destino};
+            char parametros[64];
+            snprintf(parametros, sizeof(parametros), "k=%d hilos=%d", k, hilos[ih]);
+            medir(cfg, "fusion_hilos", parametros, "us/fusion", 1e6, prueba_fusion, &args);
+            free(buffer);
+            free(destino);
+        }
+    }
+}
+
+typedef struct {
+    VecinoInterno *mias;
+    VecinoInterno *globales;
+    int num_listas;
+    TiposVecinos *tipos;
+} ArgsColectiva;
+
+static double prueba_colectiva(void *p) {
+    ArgsColectiva *a = (ArgsColectiva *)p;
+    MPI_Allreduce(a->mias, a->globales, a->num_listas, a->tipos->tipo_lista, a->tipos->op_fusion, MPI_COMM_WORLD);
+    return 1.0;
+}
+
+static void bench_colectiva(ConfigBench *cfg) {
+    const int valores_k[] = {4, 32, 256};
+    const int listas[] = {1, 1000};
+    for (int ik = 0; ik < 3; ik++) {
+        int k = valores_k[ik];
+        TiposVecinos tipos;
+        crear_tipos_vecinos(k, &tipos);
+        for (int il = 0; il < 2; il++) {
+            int num_listas = listas[il];
+            VecinoInterno *mias = (VecinoInterno *)malloc((long)num_listas * k * sizeof(VecinoInterno));
+            VecinoInterno *globales = (VecinoInterno *)malloc((long)num_listas * k * sizeof(VecinoInterno));
+            if (mias == NULL || globales == NULL) {
+                fprintf(stderr, "[ERROR] Sin memoria para la prueba colectiva\n");
+                MPI_Abort(MPI_COMM_WORLD, EXIT_FAILURE);
+            }
+            rellenar_listas(mias, num_listas, k, k, cfg->pid * num_listas);
+            ArgsColectiva args = {mias, globales, num_listas, &tipos};
+            char parametros[64];
+            snprintf(parametros, sizeof(parametros), "k=%d listas=%d", k, num_listas);
+            medir(cfg, "colectiva_topk", parametros, "us/llamada", 1e6, prueba_colectiva, &args);
+            free(mias);
+            free(globales);
+        }
+        liberar_tipos_vecinos(&tipos);
+    }
+}
+
+typedef struct {
+    int pid;
+    long filas;
+} ArgsParseo;
+
+static double prueba_parseo(void *p) {
+    ArgsParseo *a = (ArgsParseo *)p;
+    if (a->pid != MASTERPID) return (double)a->filas;
+    int filas = 0, columnas = 0;
+    int guardado = silenciar_stdout();
+    float *datos = leer_fichero(NOMBRE_DATOS, &filas, &columnas, a->pid);
+    restaurar_stdout(guardado);
+    free(datos);
+    return (double)filas;
+}
+
+// Fichero de texto con el formato de data/ ("FILAS COLUMNAS" y filas CSV con 2 decimales)
+static void escribir_datos_texto(const char *nombre, long filas, int columnas) {
+    FILE *f = fopen(nombre, "w");
+    if (f == NULL) {
+        fprintf(stderr, "[ERROR] No se pudo crear %s\n", nombre);
+        MPI_Abort(MPI_COMM_WORLD, EXIT_FAILURE);
+    }
+    fprintf(f, "%ld %d\n", filas, columnas);
+    for (long i = 0; i < filas; i++) {
+        for (int j = 0; j < columnas; j++) fprintf(f, "%s%.2f", j ? "," : "", valor_sintetico(i, j, columnas));
+        fputc('\n', f);
+    }
+    fclose(f);
+}
+
+static void bench_parseo(ConfigBench *cfg) {
+    const long filas[] = {20000, 200000};
+    for (int f = 0; f < 2; f++) {
+        long num_filas = cfg->rapido ? filas[f] / 10 : filas[f];
+        if (cfg->pid == MASTERPID) escribir_datos_texto(NOMBRE_DATOS, num_filas, 24);
+        ArgsParseo args = {cfg->pid, num_filas};
+        char parametros[64];
+        snprintf(parametros, sizeof(parametros), "filas=%ld columnas=24", num_filas);
+        medir(cfg, "parseo", parametros, "ns/fila", 1e9, prueba_parseo, &args);
+        if (cfg->pid == MASTERPID) unlink(NOMBRE_DATOS);
+    }
+}
+
+typedef struct {
+    float *datos_locales;
+    int mis_filas;
+    int columnas;
+    int stride;
+    int k;
+    int num_procs;
+    int pid;
+    const int *inicios;
+    int total_filas;
+    OpcionesPrediccion *opciones;
+} ArgsEjecucion;
+
+static double prueba_ejecucion(void *p) {
+    ArgsEjecucion *a = (ArgsEjecucion *)p;
+    int guardado = silenciar_stdout();
+    ejecutar_predicciones(a->datos_locales, a->mis_filas, a->columnas, a->stride, a->k, a->num_procs, a->pid,
+                          MPI_COMM_WORLD, a->inicios, a->total_filas, "sintetico", 0.0, 0.0, a->opciones, NULL);
+    restaurar_stdout(guardado);
+    return 1.0;
+}
+
+// Ejecución completa con el reparto equitativo y las filas generadas ya en cada proceso
+static void bench_ejecucion(ConfigBench *cfg) {
+    const int filas[] = {10000, 50000};
+    const int valores_k[] = {4, 32};
+    const char *modos[] = {"dia", "lote"};
+    int columnas = 24;
+    int stride = distancia_stride(columnas);
+    distancia_inicializar(columnas, SIMD_AUTO);
+
+    for (int f = 0; f < 2; f++) {
+        int total_filas = cfg->rapido ? filas[f] / 5 : filas[f];
+        int *inicios = (int *)malloc((cfg->num_procs + 1) * sizeof(int));
+        calcular_particion(total_filas, cfg->num_procs, NULL, inicios);
+        int mis_filas = inicios[cfg->pid + 1] - inicios[cfg->pid];
+        int almacenadas = calcular_filas_almacenadas(inicios, cfg->num_procs, cfg->pid);
+        float *datos = reservar_filas_primer_toque(almacenadas, stride);
+        if (inicios == NULL || datos == NULL) {
+            fprintf(stderr, "[ERROR] Sin memoria para la ejecución completa\n");
+            MPI_Abort(MPI_COMM_WORLD, EXIT_FAILURE);
+        }
+        for (int i = 0; i < almacenadas; i++) {
+            for (int j = 0; j < columnas; j++) datos[(long)i * stride + j] = valor_sintetico(inicios[cfg->pid] + i, j, columnas);
+        }
+
+        for (int ik = 0; ik < 2; ik++) {
+            for (int m = 0; m < 2; m++) {
+                OpcionesPrediccion opciones;
+                opciones_por_defecto(&opciones);
+                opciones.modo_lote = (m == 1);
+                ArgsEjecucion args = {datos, mis_filas, columnas, stride, valores_k[ik], cfg->num_procs, cfg->pid,
+                                      inicios, total_filas, &opciones};
+                char parametros[64];
+                snprintf(parametros, sizeof(parametros), "filas=%d k=%d modo=%s", total_filas, valores_k[ik], modos[m]);
+                medir(cfg, "ejecucion", parametros, "ms/ejecucion", 1e3, prueba_ejecucion, &args);
+            }
+        }
+        free(datos);
+        free(inicios);
+    }
+}
+
+// ---------------------------------------------------------------------------------------------
+// Resultados y comparación con una base
+// ---------------------------------------------------------------------------------------------
+
+static void guardar_csv(const ConfigBench *cfg) {
+    FILE *f = fopen(cfg->salida, "w");
+    if (f == NULL) {
+        fprintf(stderr, "[AVISO] No se pudo escribir %s\n", cfg->salida);
+        return;
+    }
+    fprintf(f, "prueba,parametros,procesos,hilos,unidad,repeticiones,mediana,minimo,media,dispersion\n");
+    for (int i = 0; i < cfg->num_resultados; i++) {
+        const ResultadoBench *r = &cfg->resultados[i];
+        fprintf(f, "%s,%s,%d,%d,%s,%d,%.6g,%.6g,%.6g,%.4f\n", r->prueba, r->parametros, r->procesos, r->hilos,
+                r->unidad, r->repeticiones, r->mediana, r->minimo, r->media, r->dispersion);
+    }
+    fclose(f);
+    printf("\nResultados en %s\n", cfg->salida);
+}
+
+// Devuelve el número de regresiones (o -1 si no se puede leer la base)
+static int comparar_con_base(const ConfigBench *cfg) {
+    FILE *f = fopen(cfg->base, "r");
+    if (f == NULL) {
+        fprintf(stderr, "[ERROR] No se pudo abrir la base %s\n", cfg->base);
+        return -1;
+    }
+    ResultadoBench *base = (ResultadoBench *)calloc(MAX_RESULTADOS, sizeof(ResultadoBench));
+    int num_base = 0;
+    char linea[512];
+    if (fgets(linea, sizeof(linea), f) == NULL) num_base = 0;  // Cabecera
+    while (num_base < MAX_RESULTADOS && fgets(linea, sizeof(linea), f)) {
+        ResultadoBench *b = &base[num_base];
+        if (sscanf(linea, "%31[^,],%63[^,],%d,%d,%15[^,],%d,%lf,%lf,%lf,%lf", b->prueba, b->parametros, &b->procesos,
+                   &b->hilos, b->unidad, &b->repeticiones, &b->mediana, &b->minimo, &b->media, &b->dispersion) == 10) {
+            num_base++;
+        }
+    }
+    fclose(f);
+
+    printf("\nComparación con %s (umbral %.0f%%)\n", cfg->base, 100.0 * cfg->umbral);
+    int regresiones = 0;
+    for (int i = 0; i < cfg->num_resultados; i++) {
+        const ResultadoBench *r = &cfg->resultados[i];
+        const ResultadoBench *b = NULL;
+        // Solo se compara la misma prueba con los mismos procesos e hilos
+        for (int j = 0; j < num_base && b == NULL; j++) {
+            if (strcmp(base[j].prueba, r->prueba) == 0 && strcmp(base[j].parametros, r->parametros) == 0 &&
+                base[j].procesos == r->procesos && base[j].hilos == r->hilos) {
+                b = &base[j];
+            }
+        }
+        if (b == NULL || b->mediana <= 0.0) {
+            printf("  %-16s %-28s sin base\n", r->prueba, r->parametros);
+            continue;
+        }
+        // Un cambio solo cuenta si supera el umbral y el ruido de las dos medidas
+        double cambio = r->mediana / b->mediana - 1.0;
+        double tolerancia = cfg->umbral;
+        double ruido = 2.0 * (r->dispersion + b->dispersion);
+        if (ruido > tolerancia) tolerancia = ruido;
+        const char *estado = "=";
+        if (cambio > tolerancia) {
+            estado = "REGRESION";
+            regresiones++;
+        } else if (cambio < -tolerancia) {
+            estado = "mejora";
+        }
+        printf("  %-16s %-28s %12.3f -> %12.3f %-13s %+7.1f%%  %s\n", r->prueba, r->parametros, b->mediana,
+               r->mediana, r->unidad, 100.0 * cambio, estado);
+    }
+    free(base);
+    printf("%d regresiones\n", regresiones);
+    return regresiones;
+}
+
+static void uso(void) {
+    printf("Uso: mpirun -np P ./benchmark [opciones]\n");
+    printf("  --salida=f.csv        Resultados (por defecto bench_resultados.csv)\n");
+    printf("  --comparar=base.csv   Compara con una ejecución anterior; sale con error si hay regresiones\n");
+    printf("  --umbral=X            Empeoramiento relativo que cuenta como regresión (por defecto %.2f)\n", UMBRAL_DEFECTO);
+    printf("  --repeticiones=N      Muestras por prueba (por defecto %d)\n", REPETICIONES_DEFECTO);
+    printf("  --rapido              Tamaños reducidos\n");
+}
+
+int main(int argc, char *argv[]) {
+    int provided;
+    MPI_Init_thread(&argc, &argv, MPI_THREAD_FUNNELED, &provided);
+
+    ConfigBench *cfg = (ConfigBench *)calloc(1, sizeof(ConfigBench));
+    if (cfg == NULL) {
+        fprintf(stderr, "[ERROR] Sin memoria\n");
+        MPI_Abort(MPI_COMM_WORLD, EXIT_FAILURE);
+    }
+    MPI_Comm_rank(MPI_COMM_WORLD, &cfg->pid);
+    MPI_Comm_size(MPI_COMM_WORLD, &cfg->num_procs);
+    cfg->repeticiones = REPETICIONES_DEFECTO;
+    cfg->umbral = UMBRAL_DEFECTO;
+    cfg->salida = "bench_resultados.csv";
+
+    for (int i = 1; i < argc; i++) {
+        if (strncmp(argv[i], "--salida=", 9) == 0) cfg->salida = argv[i] + 9;
+        else if (strncmp(argv[i], "--comparar=", 11) == 0) cfg->base = argv[i] + 11;
+        else if (strncmp(argv[i], "--umbral=", 9) == 0) cfg->umbral = atof(argv[i] + 9);
+        else if (strncmp(argv[i], "--repeticiones=", 15) == 0) cfg->repeticiones = atoi(argv[i] + 15);
+        else if (strcmp(argv[i], "--rapido") == 0) cfg->rapido = 1;
+        else {
+            if (cfg->pid == MASTERPID) uso();
+            MPI_Finalize();
+            return 0;
+        }
+    }
+    if (cfg->repeticiones < 1) cfg->repeticiones = 1;
+
+    // Los ficheros que escriben parseo y ejecución van a un directorio temporal
+    char directorio[] = "/tmp/bench_knnXXXXXX";
+    char anterior[4096];
+    if (getcwd(anterior, sizeof(anterior)) == NULL) anterior[0] = '\0';
+    if (cfg->pid == MASTERPID && mkdtemp(directorio) != NULL && chdir(directorio) != 0) {
+        fprintf(stderr, "[AVISO] No se pudo entrar en %s; los ficheros temporales quedan aquí\n", directorio);
+    }
+
+    if (cfg->pid == MASTERPID) {
+        printf("[BENCH] %d procesos x %d hilos, %d muestras por prueba%s\n", cfg->num_procs, omp_get_max_threads(),
+               cfg->repeticiones, cfg->rapido ? " (tamaños reducidos)" : "");
+        printf("%-16s %-28s %12s\n", "prueba", "parametros", "mediana");
+    }
+    bench_distancia(cfg);
+    bench_insercion(cfg);
+    bench_fusion(cfg);
+    bench_colectiva(cfg);
+    bench_parseo(cfg);
+    bench_ejecucion(cfg);
+
+    int regresiones = 0;
+    if (cfg->pid == MASTERPID) {
+        const char *temporales[] = {"Predicciones.txt", "MAPE.txt", "Tiempo.txt"};
+        for (int i = 0; i < 3; i++) unlink(temporales[i]);
+        if (anterior[0] != '\0' && chdir(anterior) == 0) rmdir(directorio);
+
+        guardar_csv(cfg);
+        if (cfg->base) regresiones = comparar_con_base(cfg);
+    }
+    MPI_Bcast(&regresiones, 1, MPI_INT, MASTERPID, MPI_COMM_WORLD);
+
+    free(cfg);
+    MPI_Finalize();
+    return (regresiones != 0) ? EXIT_FAILURE : EXIT_SUCCESS;
+}
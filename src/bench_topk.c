@@ -0,0 +1,114 @@
+/*
+ * src/bench_topk.c
+ * Microbenchmark de las estrategias de selección de los K mejores (src/vecinos.h).
+ * Uso: ./bench_topk [candidatos]
+ *
+ * Para cada K recorre el mismo flujo de distancias con cada estrategia y mide ns por candidato.
+ * Dos flujos: "aleatorio" (distancias uniformes, como un recorrido real: tras las primeras filas
+ * casi todo se rechaza) y "decreciente" (cada candidato entra en la lista, el peor caso).
+ * Comprueba además que las tres estrategias devuelven la misma lista.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <omp.h>
+#include "vecinos.h"
+
+#define CANDIDATOS_DEFECTO 2000000
+#define TIEMPO_MINIMO 0.2   // Segundos por medida (se repite el recorrido hasta alcanzarlo)
+
+static const int valores_k[] = {4, 8, 16, 32, 48, 64, 128, 256, 500};
+static const EstrategiaTopK estrategias[] = {TOPK_ORDENADO, TOPK_MONTICULO, TOPK_SELECCION};
+#define NUM_K ((int)(sizeof(valores_k) / sizeof(valores_k[0])))
+#define NUM_ESTRATEGIAS ((int)(sizeof(estrategias) / sizeof(estrategias[0])))
+
+static void recorrer(const float *distancias, int num, int k, EstrategiaTopK estrategia, VecinoInterno *datos) {
+    SeleccionTopK s;
+    topk_iniciar(&s, datos, k, estrategia);
+    for (int i = 0; i < num; i++) topk_insertar(&s, i, distancias[i]);
+    topk_finalizar(&s);
+}
+
+// Devuelve ns por candidato
+static double medir(const float *distancias, int num, int k, EstrategiaTopK estrategia, VecinoInterno *datos) {
+    int repeticiones = 0;
+    double inicio = omp_get_wtime(), transcurrido;
+    do {
+        recorrer(distancias, num, k, estrategia, datos);
+        repeticiones++;
+        transcurrido = omp_get_wtime() - inicio;
+    } while (transcurrido < TIEMPO_MINIMO);
+    return transcurrido * 1e9 / ((double)num * repeticiones);
+}
+
+static int listas_iguales(const VecinoInterno *a, const VecinoInterno *b, int k) {
+    for (int j = 0; j < k; j++) {
+        if (a[j].indice_dia != b[j].indice_dia || a[j].dist_sq != b[j].dist_sq) return 0;
+    }
+    return 1;
+}
+
+int main(int argc, char *argv[]) {
+    int num = (argc > 1) ? atoi(argv[1]) : CANDIDATOS_DEFECTO;
+    if (num < 2 * valores_k[NUM_K - 1]) {
+        fprintf(stderr, "[ERROR] Hacen falta al menos %d candidatos\n", 2 * valores_k[NUM_K - 1]);
+        return EXIT_FAILURE;
+    }
+
+    float *aleatorio = (float *)malloc((size_t)num * sizeof(float));
+    float *decreciente = (float *)malloc((size_t)num * sizeof(float));
+    VecinoInterno *datos = (VecinoInterno *)malloc(2 * (size_t)valores_k[NUM_K - 1] * sizeof(VecinoInterno));
+    VecinoInterno *referencia = (VecinoInterno *)malloc((size_t)valores_k[NUM_K - 1] * sizeof(VecinoInterno));
+    if (!aleatorio || !decreciente || !datos || !referencia) {
+        fprintf(stderr, "[ERROR] Sin memoria\n");
+        return EXIT_FAILURE;
+    }
+
+    // Generador fijo (LCG) para que las medidas sean repetibles
+    unsigned int semilla = 12345u;
+    for (int i = 0; i < num; i++) {
+        semilla = semilla * 1664525u + 1013904223u;
+        aleatorio[i] = (float)(semilla >> 8) / 16777216.0f;
+        decreciente[i] = (float)(num - i);
+    }
+
+    const char *nombres_flujo[2] = {"aleatorio", "decreciente"};
+    const float *flujos[2] = {aleatorio, decreciente};
+    int errores = 0;
+
+    printf("Candidatos por recorrido: %d (ns por candidato)\n", num);
+    for (int f = 0; f < 2; f++) {
+        printf("\nFlujo %s\n%6s", nombres_flujo[f], "K");
+        for (int e = 0; e < NUM_ESTRATEGIAS; e++) printf(" %12s", topk_nombre(estrategias[e]));
+        printf("   mejor\n");
+
+        for (int ik = 0; ik < NUM_K; ik++) {
+            int k = valores_k[ik];
+            double mejor_tiempo = 0.0;
+            int mejor = 0;
+            printf("%6d", k);
+            for (int e = 0; e < NUM_ESTRATEGIAS; e++) {
+                double ns = medir(flujos[f], num, k, estrategias[e], datos);
+                if (e == 0) {
+                    for (int j = 0; j < k; j++) referencia[j] = datos[j];
+                } else if (!listas_iguales(referencia, datos, k)) {
+                    errores++;
+                }
+                if (e == 0 || ns < mejor_tiempo) {
+                    mejor_tiempo = ns;
+                    mejor = e;
+                }
+                printf(" %12.2f", ns);
+            }
+            printf("   %s\n", topk_nombre(estrategias[mejor]));
+        }
+    }
+
+    if (errores > 0) printf("\n[ERROR] %d listas distintas entre estrategias\n", errores);
+
+    free(aleatorio);
+    free(decreciente);
+    free(datos);
+    free(referencia);
+    return (errores > 0) ? EXIT_FAILURE : EXIT_SUCCESS;
+}
@@ -0,0 +1,173 @@
+/*
+ * src/compacto.c
+ * Copia en 16 bits (int16 escalado o fp16) de las filas locales y cota de su error.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <float.h>
+#include <omp.h>
+#include "compacto.h"
+
+#define INT16_LIMITE 32767
+#define FP16_MAXIMO 65504.0f
+// Enteros consecutivos representables sin pérdida en fp16 (mantisa de 11 bits)
+#define FP16_RANGO_ENTERO 4096
+
+static uint16_t cuantizar(const DatosCompactos *c, int j, float x) {
+    float s = c->escala[j], off = c->desplazamiento[j];
+    if (c->formato == COMPACTO_INT16) {
+        float q = rintf((x - off) / s);
+        if (!(q >= -INT16_LIMITE)) q = -INT16_LIMITE;   // también NaN
+        if (q > INT16_LIMITE) q = INT16_LIMITE;
+        return (uint16_t)(int16_t)q;
+    }
+    float q = (x - off) / s;
+    if (!(q >= -FP16_MAXIMO)) q = -FP16_MAXIMO;
+    if (q > FP16_MAXIMO) q = FP16_MAXIMO;
+    return float_a_fp16(q);
+}
+
+static float reconstruir(const DatosCompactos *c, int j, uint16_t q) {
+    float v = (c->formato == COMPACTO_INT16) ? (float)(int16_t)q : fp16_a_float(q);
+    return fmaf(v, c->escala[j], c->desplazamiento[j]);
+}
+
+// Cuantiza la fila 'i' y devuelve ||x - x̂||^2 con x̂ reconstruido igual que en los kernels
+static double cuantizar_fila(DatosCompactos *c, const float *x, long i) {
+    uint16_t *q = &c->datos[i * c->stride];
+    double error = 0.0;
+    for (int j = 0; j < c->columnas; j++) {
+        q[j] = cuantizar(c, j, x[j]);
+        double d = (double)x[j] - (double)reconstruir(c, j, q[j]);
+        error += d * d;
+    }
+    for (int j = c->columnas; j < c->stride; j++) q[j] = 0;
+    return error;
+}
+
+// Escala y desplazamiento de la columna a partir de su rango
+static void parametros_columna(FormatoCompacto formato, float minimo, float maximo, int entera,
+                               float *escala, float *desplazamiento) {
+    double rango = (double)maximo - (double)minimo;
+    double medio = 0.5 * ((double)minimo + (double)maximo);
+    if (formato == COMPACTO_INT16) {
+        if (entera && rango <= 2.0 * INT16_LIMITE) {
+            *escala = 1.0f;
+            *desplazamiento = floorf(minimo) + INT16_LIMITE;
+        } else {
+            *escala = (rango > 0.0) ? (float)(rango / (2.0 * INT16_LIMITE)) : 1.0f;
+            *desplazamiento = (float)medio;
+        }
+    } else {
+        if (entera && rango <= FP16_RANGO_ENTERO) {
+            *escala = 1.0f;
+            *desplazamiento = floorf(minimo) + FP16_RANGO_ENTERO / 2;
+        } else {
+            *escala = (rango > 0.0) ? (float)(0.5 * rango) : 1.0f;
+            *desplazamiento = (float)medio;
+        }
+    }
+}
+
+static int reservar_datos(DatosCompactos *c, int capacidad) {
+    size_t bytes = (size_t)capacidad * c->stride * sizeof(uint16_t);
+    bytes = (bytes + DISTANCIA_ALINEACION - 1) / DISTANCIA_ALINEACION * DISTANCIA_ALINEACION;
+    uint16_t *datos = (uint16_t *)aligned_alloc(DISTANCIA_ALINEACION, bytes);
+    if (datos == NULL) return -1;
+    if (c->datos != NULL) {
+        memcpy(datos, c->datos, (size_t)c->filas * c->stride * sizeof(uint16_t));
+        free(c->datos);
+    }
+    c->datos = datos;
+    c->capacidad = capacidad;
+    return 0;
+}
+
+DatosCompactos* compacto_construir(const float *datos, int filas, int stride, int columnas, FormatoCompacto formato) {
+    DatosCompactos *c = (DatosCompactos *)calloc(1, sizeof(DatosCompactos));
+    if (c == NULL) return NULL;
+    c->formato = formato;
+    c->columnas = columnas;
+    c->stride = stride;
+    c->distancia = (formato == COMPACTO_INT16) ? calcular_distancias_int16 : calcular_distancias_fp16;
+    c->escala = (float *)calloc(stride, sizeof(float));
+    c->desplazamiento = (float *)calloc(stride, sizeof(float));
+    if (c->escala == NULL || c->desplazamiento == NULL || reservar_datos(c, filas > 0 ? filas : 1) != 0) {
+        compacto_liberar(c);
+        return NULL;
+    }
+
+    // Rango de cada columna y si todos sus valores son enteros
+    #pragma omp parallel for schedule(static)
+    for (int j = 0; j < columnas; j++) {
+        float minimo = FLT_MAX, maximo = -FLT_MAX;
+        int entera = 1;
+        for (long i = 0; i < filas; i++) {
+            float x = datos[i * stride + j];
+            if (x < minimo) minimo = x;
+            if (x > maximo) maximo = x;
+            if (x != rintf(x)) entera = 0;
+        }
+        if (filas == 0) minimo = maximo = 0.0f;
+        parametros_columna(formato, minimo, maximo, entera, &c->escala[j], &c->desplazamiento[j]);
+    }
+
+    // Primer toque de las filas compactas con el reparto del recorrido
+    double error = 0.0;
+    #pragma omp parallel for schedule(static) reduction(max:error)
+    for (long i = 0; i < filas; i++) {
+        double e = cuantizar_fila(c, &datos[i * stride], i);
+        if (e > error) error = e;
+    }
+    c->filas = filas;
+    c->error = sqrt(error);
+    return c;
+}
+
+void compacto_liberar(DatosCompactos *c) {
+    if (c == NULL) return;
+    free(c->datos);
+    free(c->escala);
+    free(c->desplazamiento);
+    free(c);
+}
+
+int compacto_ampliar(DatosCompactos *c, const float *datos, int filas) {
+    if (filas > c->capacidad) {
+        // Capacidad doble: añadir una fila cuesta O(1) amortizado
+        int capacidad = 2 * c->capacidad;
+        if (capacidad < filas) capacidad = filas;
+        if (reservar_datos(c, capacidad) != 0) return -1;
+    }
+    double error = c->error * c->error;
+    for (long i = c->filas; i < filas; i++) {
+        double e = cuantizar_fila(c, &datos[i * c->stride], i);
+        if (e > error) error = e;
+    }
+    c->filas = filas;
+    c->error = sqrt(error);
+    return 0;
+}
+
+// Con 'dk' la K-ésima distancia aproximada (redondeo relativo <= m en ambos kernels):
+//   - Los K primeros tienen distancia exacta <= U = (sqrt(dk (1+m)) + E)^2, luego la K-ésima
+//     exacta (calculada) no pasa de U (1+m).
+//   - Una fila con distancia exacta <= U (1+m)^2 tiene distancia aproximada calculada
+//     <= ((sqrt(U) (1+m) + E)^2 (1+m) = T.
+double compacto_umbral(const DatosCompactos *c, float dist_k) {
+    double m = COMPACTO_MARGEN;
+    double raiz_u = sqrt((double)dist_k * (1.0 + m)) + c->error;
+    double r = raiz_u * (1.0 + m) + c->error;
+    return r * r * (1.0 + m);
+}
+
+const char* compacto_nombre(FormatoCompacto formato) {
+    switch (formato) {
+        case COMPACTO_INT16: return "int16";
+        case COMPACTO_FP16:  return "fp16";
+        default:             return "no";
+    }
+}
@@ -0,0 +1,65 @@
+#ifndef COMPACTO_H
+#define COMPACTO_H
+
+#include <stdint.h>
+#include "distancia.h"
+
+// Copia compacta de las filas locales (--compacto=int16|fp16) para el recorrido lineal.
+// Cada columna j se guarda en 16 bits y se reconstruye como x̂ = q * escala[j] + desplazamiento[j]:
+//   INT16: q entero con signo. Si la columna es entera y su rango cabe en 65534 valores
+//          (la carga de datos_1X) la escala es 1 y la copia no pierde nada.
+//   FP16:  q en media precisión (IEEE binary16) del valor centrado y normalizado a [-1, 1].
+// El recorrido lee solo las filas compactas (la mitad de bytes) y guarda los K' mejores por
+// distancia aproximada; después recalcula en float32 la distancia de los que pueden estar entre
+// los K exactos y se queda con esos. 'error' acota ||x - x̂|| en cualquier fila, así que por la
+// desigualdad triangular el resultado es exactamente el del recorrido en float32.
+
+typedef enum {
+    COMPACTO_NINGUNO = 0,
+    COMPACTO_INT16,
+    COMPACTO_FP16
+} FormatoCompacto;
+
+// Holgura relativa frente al redondeo float de las distancias (como PODA_MARGEN)
+#define COMPACTO_MARGEN 1e-4
+
+// Candidatos aproximados por hilo y día para K vecinos
+#define COMPACTO_CANDIDATOS(k) (2 * (k) + 8)
+
+typedef struct {
+    FormatoCompacto formato;
+    int filas;
+    int capacidad;              // Filas que caben en 'datos' (ver compacto_ampliar)
+    int columnas;
+    int stride;                 // El mismo relleno que las filas float32
+    uint16_t *datos;            // capacidad * stride valores
+    float *escala;              // stride (0 en el relleno)
+    float *desplazamiento;      // stride (0 en el relleno)
+    double error;               // Máximo de ||x - x̂|| entre todas las filas
+    FuncDistanciaCompacta distancia;
+} DatosCompactos;
+
+// Parámetros por columna, cuantización y cota de error (en paralelo con OpenMP, con el mismo
+// reparto estático que el recorrido). Llamar después de distancia_inicializar().
+DatosCompactos* compacto_construir(const float *datos, int filas, int stride, int columnas, FormatoCompacto formato);
+void compacto_liberar(DatosCompactos *c);
+
+// Añade las filas [c->filas, filas) de 'datos' con los parámetros ya fijados (modo continuo);
+// los valores fuera de rango se saturan y 'error' crece si hace falta. Devuelve 0 si todo va
+// bien, -1 si no hay memoria (la copia queda como estaba).
+int compacto_ampliar(DatosCompactos *c, const float *datos, int filas);
+
+// Distancias aproximadas de las filas [primera, primera + num_filas) al patrón
+static inline void compacto_distancias(const DatosCompactos *c, long primera, int num_filas, const float *patron,
+                                       float *distancias) {
+    c->distancia(patron, &c->datos[primera * c->stride], num_filas, c->escala, c->desplazamiento, c->columnas,
+                 distancias);
+}
+
+// Umbral de distancia aproximada por encima del que ninguna fila puede estar entre los K
+// exactos, a partir de la K-ésima distancia aproximada de las filas recorridas
+double compacto_umbral(const DatosCompactos *c, float dist_k);
+
+const char* compacto_nombre(FormatoCompacto formato);
+
+#endif
@@ -0,0 +1,158 @@
+/*
+ * src/continuo.c
+ * Entrada y salida del modo continuo (FIFO, fichero o socket local) y latencias por petición.
+ */
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include "continuo.h"
+#include "utils.h"
+
+#define PREFIJO_SOCKET "unix:"
+
+// Socket local: escucha en 'ruta' y acepta un único cliente
+static int abrir_socket(FuenteContinua *f, const char *ruta) {
+    struct sockaddr_un dir;
+    if (strlen(ruta) >= sizeof(dir.sun_path)) {
+        fprintf(stderr, "[ERROR CONTINUO] Ruta de socket demasiado larga: %s\n", ruta);
+        return -1;
+    }
+    f->socket_escucha = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (f->socket_escucha < 0) {
+        perror("Error creando el socket del modo continuo");
+        return -1;
+    }
+    memset(&dir, 0, sizeof(dir));
+    dir.sun_family = AF_UNIX;
+    strcpy(dir.sun_path, ruta);
+    unlink(ruta);
+    if (bind(f->socket_escucha, (struct sockaddr *)&dir, sizeof(dir)) != 0 || listen(f->socket_escucha, 1) != 0) {
+        perror("Error en bind/listen del socket del modo continuo");
+        return -1;
+    }
+    f->ruta_socket = ruta;
+
+    printf("[CONTINUO] Esperando cliente en %s\n", ruta);
+    fflush(stdout);
+    int conexion = accept(f->socket_escucha, NULL, NULL);
+    if (conexion < 0) {
+        perror("Error aceptando el cliente del modo continuo");
+        return -1;
+    }
+    int copia = dup(conexion);
+    f->entrada = fdopen(conexion, "r");
+    f->salida = (copia >= 0) ? fdopen(copia, "w") : NULL;
+    if (f->entrada == NULL || f->salida == NULL) {
+        perror("Error abriendo la conexión del modo continuo");
+        return -1;
+    }
+    return 0;
+}
+
+FuenteContinua* continuo_abrir(const char *ruta) {
+    FuenteContinua *f = (FuenteContinua *)calloc(1, sizeof(FuenteContinua));
+    if (f == NULL) return NULL;
+    f->socket_escucha = -1;
+
+    int error = 0;
+    if (strncmp(ruta, PREFIJO_SOCKET, strlen(PREFIJO_SOCKET)) == 0) {
+        error = abrir_socket(f, ruta + strlen(PREFIJO_SOCKET));
+    } else {
+        // Con un FIFO, fopen espera a que aparezca quien escribe
+        f->entrada = (strcmp(ruta, "-") == 0) ? stdin : fopen(ruta, "r");
+        f->salida = stdout;
+        if (f->entrada == NULL) {
+            fprintf(stderr, "[ERROR CONTINUO] No se pudo abrir %s\n", ruta);
+            error = -1;
+        }
+    }
+    if (error != 0) {
+        continuo_cerrar(f);
+        return NULL;
+    }
+    return f;
+}
+
+static void responder_error(FuenteContinua *f, const char *motivo) {
+    fprintf(f->salida, "ERROR %s\n", motivo);
+    fflush(f->salida);
+}
+
+PeticionContinua continuo_leer(FuenteContinua *f, float *fila, int columnas) {
+    ssize_t leidos;
+    while ((leidos = getline(&f->linea, &f->tam_linea, f->entrada)) >= 0) {
+        char *ini = f->linea, *fin = f->linea + leidos;
+        while (fin > ini && (fin[-1] == '\n' || fin[-1] == '\r' || fin[-1] == ' ')) fin--;
+        while (ini < fin && (*ini == ' ' || *ini == '\t')) ini++;
+        if (ini == fin) continue;
+
+        if (fin - ini == 1 && *ini == '?') return CONTINUO_PREDECIR;
+        if (fin - ini == 3 && strncmp(ini, "FIN", 3) == 0) return CONTINUO_FIN;
+
+        int campos = parsear_linea(ini, fin, fila, columnas);
+        if (campos == columnas) return CONTINUO_FILA;
+
+        char motivo[96];
+        if (campos < 0) snprintf(motivo, sizeof(motivo), "campo no numerico");
+        else snprintf(motivo, sizeof(motivo), "%d columnas, se esperaban %d", campos, columnas);
+        responder_error(f, motivo);
+        return CONTINUO_INVALIDA;
+    }
+    return CONTINUO_FIN;
+}
+
+void continuo_responder(FuenteContinua *f, int dia, const float *prediccion, int columnas) {
+    fprintf(f->salida, "%d", dia);
+    for (int h = 0; h < columnas; h++) fprintf(f->salida, " %.2f", prediccion[h]);
+    fprintf(f->salida, "\n");
+    fflush(f->salida);
+}
+
+void continuo_cerrar(FuenteContinua *f) {
+    if (f == NULL) return;
+    if (f->entrada && f->entrada != stdin) fclose(f->entrada);
+    if (f->salida && f->salida != stdout) fclose(f->salida);
+    if (f->socket_escucha >= 0) {
+        close(f->socket_escucha);
+        if (f->ruta_socket) unlink(f->ruta_socket);
+    }
+    free(f->linea);
+    free(f);
+}
+
+void latencias_anotar(LatenciasContinuo *l, double segundos) {
+    if (l->num == l->capacidad) {
+        long nueva = l->capacidad ? 2 * l->capacidad : 1024;
+        double *m = (double *)realloc(l->muestras, nueva * sizeof(double));
+        if (m == NULL) return;   // Sin memoria: se pierde la muestra, no la petición
+        l->muestras = m;
+        l->capacidad = nueva;
+    }
+    l->muestras[l->num++] = segundos;
+}
+
+static int comparar_double(const void *a, const void *b) {
+    double x = *(const double *)a, y = *(const double *)b;
+    return (x > y) - (x < y);
+}
+
+double latencias_percentil(LatenciasContinuo *l, double p) {
+    if (l->num == 0) return 0.0;
+    qsort(l->muestras, l->num, sizeof(double), comparar_double);
+    long idx = (long)ceil(p * l->num) - 1;
+    if (idx < 0) idx = 0;
+    if (idx >= l->num) idx = l->num - 1;
+    return l->muestras[idx];
+}
+
+void latencias_liberar(LatenciasContinuo *l) {
+    free(l->muestras);
+    l->muestras = NULL;
+    l->num = l->capacidad = 0;
+}
@@ -0,0 +1,59 @@
+#ifndef CONTINUO_H
+#define CONTINUO_H
+
+#include <stdio.h>
+
+// Modo continuo (--continuo=RUTA): el histórico se carga una vez y el Master lee los días
+// nuevos de uno en uno; cada uno se añade al histórico distribuido y se responde al momento
+// con la predicción del día siguiente.
+//
+// RUTA puede ser un FIFO o un fichero ("-" es la entrada estándar), con las respuestas por la
+// salida estándar, o "unix:/ruta/socket", un socket local en el que se acepta un cliente y
+// se le responde por la misma conexión.
+//
+// Protocolo (una línea por petición):
+//   v1,v2,...,vN   día nuevo con las N columnas del dataset (separadas por comas o espacios)
+//   ?              predicción del día siguiente sin añadir nada
+//   FIN            termina (también al cerrar la entrada)
+// Respuesta: "<día> p1 p2 ... pN" (día = índice global del día predicho) o "ERROR <motivo>".
+
+typedef enum {
+    CONTINUO_FIN = 0,
+    CONTINUO_FILA,          // Día nuevo en 'fila'
+    CONTINUO_PREDECIR,      // Solo predicción
+    CONTINUO_INVALIDA       // Línea mal formada (ya se ha respondido con el error)
+} PeticionContinua;
+
+typedef struct {
+    FILE *entrada;
+    FILE *salida;
+    int socket_escucha;     // -1 si no es un socket
+    const char *ruta_socket;
+    char *linea;
+    size_t tam_linea;
+} FuenteContinua;
+
+// Solo Master: abre la fuente (con un socket espera al cliente). Devuelve NULL si falla.
+FuenteContinua* continuo_abrir(const char *ruta);
+
+// Espera la siguiente petición; con CONTINUO_FILA deja los valores en 'fila' (columnas floats)
+PeticionContinua continuo_leer(FuenteContinua *f, float *fila, int columnas);
+
+void continuo_responder(FuenteContinua *f, int dia, const float *prediccion, int columnas);
+void continuo_cerrar(FuenteContinua *f);
+
+// Latencias de las peticiones (segundos), para los percentiles del informe final
+typedef struct {
+    double *muestras;
+    long num;
+    long capacidad;
+} LatenciasContinuo;
+
+void latencias_anotar(LatenciasContinuo *l, double segundos);
+
+// Ordena las muestras y devuelve el percentil p (0..1) por rango más cercano (0 si no hay)
+double latencias_percentil(LatenciasContinuo *l, double p);
+
+void latencias_liberar(LatenciasContinuo *l);
+
+#endif
@@ -0,0 +1,35 @@
+/*
+ * src/convertir.c
+ * Conversor del dataset de texto ("FILAS COLUMNAS" + CSV) al formato binario de dataset_bin.h.
+ * Uso: ./convertir <entrada.txt> <salida.bin>
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <mpi.h>
+#include "utils.h"
+#include "dataset_bin.h"
+
+int main(int argc, char *argv[]) {
+    MPI_Init(&argc, &argv);
+
+    if (argc != 3) {
+        printf("Uso: ./convertir <entrada.txt> <salida.bin>\n");
+        MPI_Finalize();
+        return 0;
+    }
+
+    int filas = 0, columnas = 0;
+    // Reutilizamos el mismo parser que el programa principal (como Master)
+    float *datos = leer_fichero(argv[1], &filas, &columnas, 0);
+
+    int ret = escribir_dataset_binario(argv[2], datos, filas, columnas);
+    if (ret == 0) {
+        printf("[CONVERTIR] %s -> %s (%d filas x %d columnas, %ld bytes de datos)\n",
+               argv[1], argv[2], filas, columnas, (long)filas * columnas * (long)sizeof(float));
+    }
+
+    free(datos);
+    MPI_Finalize();
+    return ret == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
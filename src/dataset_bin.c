@@ -0,0 +1,146 @@
+/*
+ * src/dataset_bin.c
+ * Formato binario del dataset y carga paralela con MPI-IO.
+ * Cada proceso lee solo su rango de filas, sin parseo de texto ni MPI_Scatter.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <mpi.h>
+#include "dataset_bin.h"
+#include "distancia.h"
+#include "utils.h"
+
+_Static_assert(sizeof(CabeceraDataset) == DATASET_TAM_CABECERA, "La cabecera binaria debe ocupar 64 bytes");
+
+uint64_t checksum_dataset(const float *datos, long num_elementos, long primer_elemento) {
+    uint64_t suma = 0;
+    for (long i = 0; i < num_elementos; i++) {
+        uint32_t palabra;
+        memcpy(&palabra, &datos[i], sizeof(palabra));
+        suma += (uint64_t)(primer_elemento + i + 1) * palabra;
+    }
+    return suma;
+}
+
+int es_dataset_binario(const char *nombre_fichero) {
+    FILE *f = fopen(nombre_fichero, "rb");
+    if (f == NULL) return 0;
+    uint32_t magic = 0;
+    size_t n = fread(&magic, sizeof(magic), 1, f);
+    fclose(f);
+    return (n == 1 && magic == DATASET_MAGIC);
+}
+
+int leer_cabecera_dataset(const char *nombre_fichero, CabeceraDataset *cab) {
+    FILE *f = fopen(nombre_fichero, "rb");
+    if (f == NULL) {
+        fprintf(stderr, "[ERROR IO] No se pudo abrir %s\n", nombre_fichero);
+        return -1;
+    }
+    size_t n = fread(cab, sizeof(CabeceraDataset), 1, f);
+    fseek(f, 0, SEEK_END);
+    long tam_fichero = ftell(f);
+    fclose(f);
+
+    if (n != 1 || cab->magic != DATASET_MAGIC) {
+        fprintf(stderr, "[ERROR IO] %s no tiene cabecera binaria válida\n", nombre_fichero);
+        return -1;
+    }
+    if (cab->version != DATASET_VERSION || cab->offset_datos < DATASET_TAM_CABECERA) {
+        fprintf(stderr, "[ERROR IO] Versión de formato no soportada en %s (v%u)\n", nombre_fichero, cab->version);
+        return -1;
+    }
+    long esperado = (long)cab->offset_datos + (long)cab->filas * cab->columnas * sizeof(float);
+    if (tam_fichero < esperado) {
+        fprintf(stderr, "[ERROR IO] %s truncado: %ld bytes, se esperaban %ld\n", nombre_fichero, tam_fichero, esperado);
+        return -1;
+    }
+    return 0;
+}
+
+float* leer_filas_dataset(const char *nombre_fichero, const CabeceraDataset *cab,
+                          long fila_inicio, int num_filas, int stride, MPI_Comm comm) {
+    float *datos = reservar_filas_primer_toque(num_filas, stride);
+    if (datos == NULL) {
+        perror("Error en malloc para filas binarias");
+        MPI_Abort(MPI_COMM_WORLD, EXIT_FAILURE);
+    }
+    leer_filas_dataset_en(nombre_fichero, cab, fila_inicio, num_filas, stride, comm, datos);
+    return datos;
+}
+
+void leer_filas_dataset_en(const char *nombre_fichero, const CabeceraDataset *cab,
+                           long fila_inicio, int num_filas, int stride, MPI_Comm comm, float *destino) {
+    MPI_File fh;
+    int err = MPI_File_open(comm, (char *)nombre_fichero, MPI_MODE_RDONLY, MPI_INFO_NULL, &fh);
+    if (err != MPI_SUCCESS) {
+        char error_string[MPI_MAX_ERROR_STRING];
+        int length_of_error_string;
+        MPI_Error_string(err, error_string, &length_of_error_string);
+        fprintf(stderr, "[ERROR MPI I/O] No se pudo abrir %s: %s\n", nombre_fichero, error_string);
+        MPI_Abort(MPI_COMM_WORLD, EXIT_FAILURE);
+    }
+
+    // Lectura colectiva: MPI-IO puede agregar las peticiones de todos los procesos.
+    // El tipo en memoria deja cada fila en su hueco con relleno.
+    MPI_Datatype tipo_fila = crear_tipo_fila(cab->columnas, stride);
+    MPI_Offset offset = (MPI_Offset)cab->offset_datos + (MPI_Offset)fila_inicio * cab->columnas * sizeof(float);
+    MPI_Status status;
+    MPI_File_read_at_all(fh, offset, destino, num_filas, tipo_fila, &status);
+    MPI_Type_free(&tipo_fila);
+    MPI_File_close(&fh);
+}
+
+float* mapear_filas_dataset(const char *nombre_fichero, const CabeceraDataset *cab, long fila_inicio,
+                            void **base, size_t *tam) {
+    int fd = open(nombre_fichero, O_RDONLY);
+    if (fd < 0) {
+        perror("Error abriendo dataset para mmap");
+        MPI_Abort(MPI_COMM_WORLD, EXIT_FAILURE);
+    }
+    *tam = (size_t)cab->offset_datos + (size_t)cab->filas * cab->columnas * sizeof(float);
+    *base = mmap(NULL, *tam, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (*base == MAP_FAILED) {
+        perror("Error en mmap del dataset");
+        MPI_Abort(MPI_COMM_WORLD, EXIT_FAILURE);
+    }
+    char *datos = (char *)*base + cab->offset_datos;
+    return (float *)(datos + (size_t)fila_inicio * cab->columnas * sizeof(float));
+}
+
+void liberar_mapeo_dataset(void *base, size_t tam) {
+    if (base) munmap(base, tam);
+}
+
+int escribir_dataset_binario(const char *nombre_fichero, const float *datos, int filas, int columnas) {
+    FILE *f = fopen(nombre_fichero, "wb");
+    if (f == NULL) {
+        fprintf(stderr, "[ERROR IO] No se pudo crear %s\n", nombre_fichero);
+        return -1;
+    }
+
+    long num_elementos = (long)filas * columnas;
+    CabeceraDataset cab;
+    memset(&cab, 0, sizeof(cab));
+    cab.magic = DATASET_MAGIC;
+    cab.version = DATASET_VERSION;
+    cab.filas = (uint64_t)filas;
+    cab.columnas = (uint32_t)columnas;
+    cab.offset_datos = DATASET_TAM_CABECERA;
+    cab.checksum = checksum_dataset(datos, num_elementos, 0);
+
+    int ok = fwrite(&cab, sizeof(cab), 1, f) == 1 &&
+             fwrite(datos, sizeof(float), num_elementos, f) == (size_t)num_elementos;
+    if (fclose(f) != 0) ok = 0;
+    if (!ok) {
+        fprintf(stderr, "[ERROR IO] Escritura incompleta de %s\n", nombre_fichero);
+        return -1;
+    }
+    return 0;
+}
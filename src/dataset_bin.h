@@ -0,0 +1,56 @@
+#ifndef DATASET_BIN_H
+#define DATASET_BIN_H
+
+#include <stdint.h>
+#include <mpi.h>
+
+// Formato binario del dataset (generado con ./convertir a partir del fichero de texto):
+//   [cabecera de 64 bytes][filas * columnas float32 en orden de filas]
+// Los datos empiezan en el byte 64, así cada proceso puede leer su rango de filas
+// directamente con MPI_File_read_at_all (o mapearlo) sin parsear texto ni hacer Scatter.
+#define DATASET_MAGIC   0x424E4E4B  // "KNNB" en little-endian
+#define DATASET_VERSION 1
+#define DATASET_TAM_CABECERA 64
+
+typedef struct {
+    uint32_t magic;
+    uint32_t version;
+    uint64_t filas;
+    uint32_t columnas;
+    uint32_t offset_datos;   // Byte donde empieza la matriz (DATASET_TAM_CABECERA)
+    uint64_t checksum;       // Ver checksum_dataset()
+    uint8_t reservado[32];
+} CabeceraDataset;
+
+// Checksum posicional: suma de (índice_global + 1) * palabra_32bits módulo 2^64.
+// Es aditivo, así que cada proceso puede calcular la parte de sus filas y sumarlas con MPI_Reduce.
+// 'primer_elemento' es el índice global del primer float de 'datos'.
+uint64_t checksum_dataset(const float *datos, long num_elementos, long primer_elemento);
+
+// Devuelve 1 si el fichero empieza por la cabecera binaria, 0 si no (o no se puede abrir)
+int es_dataset_binario(const char *nombre_fichero);
+
+// Lee y valida la cabecera. Devuelve 0 si es correcta.
+int leer_cabecera_dataset(const char *nombre_fichero, CabeceraDataset *cab);
+
+// Colectiva sobre 'comm': cada proceso lee [fila_inicio, fila_inicio + num_filas) con MPI_File_read_at_all.
+// Las filas quedan en memoria alineada con 'stride' floats por fila (relleno a 0).
+float* leer_filas_dataset(const char *nombre_fichero, const CabeceraDataset *cab,
+                          long fila_inicio, int num_filas, int stride, MPI_Comm comm);
+
+// Igual, pero en memoria ya reservada (p.ej. la ventana compartida del nodo, ver memoria_nodo.h)
+void leer_filas_dataset_en(const char *nombre_fichero, const CabeceraDataset *cab,
+                           long fila_inicio, int num_filas, int stride, MPI_Comm comm, float *destino);
+
+// Alternativa sin copia: mapea el fichero con mmap y devuelve un puntero a la fila 'fila_inicio'.
+// Las filas quedan sin relleno (stride = columnas).
+// Los procesos de un mismo nodo comparten las páginas de la caché del sistema.
+// 'base' y 'tam' se necesitan para liberar_mapeo_dataset().
+float* mapear_filas_dataset(const char *nombre_fichero, const CabeceraDataset *cab, long fila_inicio,
+                            void **base, size_t *tam);
+void liberar_mapeo_dataset(void *base, size_t tam);
+
+// Escribe 'datos' (filas x columnas) en formato binario. Devuelve 0 si todo va bien.
+int escribir_dataset_binario(const char *nombre_fichero, const float *datos, int filas, int columnas);
+
+#endif
@@ -0,0 +1,583 @@
+/*
+ * src/distancia.c
+ * Kernels de distancia euclídea al cuadrado: escalar, AVX2+FMA y AVX-512.
+ * Se compilan todos con atributos 'target' y se elige uno en tiempo de ejecución
+ * (__builtin_cpu_supports), así el mismo binario sirve para todos los nodos del cluster.
+ * Para los números de columnas habituales (8, 16, 24, 32) hay versiones especializadas
+ * en tiempo de compilación, con los bucles totalmente desenrollados.
+ * También están aquí los kernels sobre filas compactas (int16 y fp16, ver compacto.h).
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include "distancia.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define DISTANCIA_X86 1
+#endif
+
+// --- KERNELS ESCALARES (siempre disponibles) ---
+// Ocho sumas parciales (una por carril, como en AVX2) y sin reasociación: así la versión
+// con abandono temprano da exactamente el mismo resultado que la completa. El compilador
+// puede seguir vectorizando los carriles.
+
+#define ESCALAR_SIN_REASOCIAR __attribute__((optimize("no-associative-math")))
+
+ESCALAR_SIN_REASOCIAR
+static inline float suma_carriles(const float *acc) {
+    float s0 = acc[0] + acc[4], s1 = acc[1] + acc[5], s2 = acc[2] + acc[6], s3 = acc[3] + acc[7];
+    return (s0 + s2) + (s1 + s3);
+}
+
+ESCALAR_SIN_REASOCIAR
+static float distancia_escalar(const float *v1, const float *v2, int cols) {
+    float acc[DISTANCIA_ANCHO] = { 0.0f };
+    for (int i = 0; i < cols; i++) {
+        float diff = v1[i] - v2[i];
+        acc[i % DISTANCIA_ANCHO] += diff * diff;
+    }
+    return suma_carriles(acc);
+}
+
+ESCALAR_SIN_REASOCIAR
+static float distancia_acotada_escalar(const float *v1, const float *v2, int cols, float umbral) {
+    float acc[DISTANCIA_ANCHO] = { 0.0f };
+    for (int i = 0; i < cols; i++) {
+        float diff = v1[i] - v2[i];
+        acc[i % DISTANCIA_ANCHO] += diff * diff;
+        // Cada carril solo crece, así que la suma parcial es cota inferior de la final
+        if (i % DISTANCIA_ANCHO == DISTANCIA_ANCHO - 1 && i + 1 < cols) {
+            float parcial = suma_carriles(acc);
+            if (parcial >= umbral) return parcial;
+        }
+    }
+    return suma_carriles(acc);
+}
+
+static void distancias_multi_escalar(const float *fila, const float *patrones, int num_patrones,
+                                     int stride, int cols, float *distancias) {
+    for (int p = 0; p < num_patrones; p++) {
+        distancias[p] = distancia_escalar(fila, &patrones[(long)p * stride], cols);
+    }
+}
+
+uint16_t float_a_fp16(float x) {
+    uint32_t bits;
+    memcpy(&bits, &x, sizeof(bits));
+    uint16_t signo = (uint16_t)((bits >> 16) & 0x8000);
+    uint32_t abs = bits & 0x7FFFFFFF;
+
+    if (abs >= 0x7F800000) return signo | 0x7C00 | (abs > 0x7F800000 ? 0x200 : 0);  // inf / NaN
+    if (abs >= 0x477FF000) return signo | 0x7C00;     // >= 65520 se redondea a infinito
+    if (abs < 0x38800000) {                            // < 2^-14: subnormal en fp16
+        if (abs < 0x33000000) return signo;
+        uint32_t desplaz = 126 - (abs >> 23);
+        uint32_t mant = (abs & 0x7FFFFF) | 0x800000;
+        uint32_t h = mant >> desplaz, resto = mant & ((1u << desplaz) - 1), mitad = 1u << (desplaz - 1);
+        if (resto > mitad || (resto == mitad && (h & 1))) h++;
+        return signo | (uint16_t)h;
+    }
+    // Normal: se rebaja el sesgo del exponente (127 -> 15); el acarreo del redondeo pasa solo al exponente
+    uint32_t h = (abs >> 13) - ((127 - 15) << 10), resto = abs & 0x1FFF;
+    if (resto > 0x1000 || (resto == 0x1000 && (h & 1))) h++;
+    return signo | (uint16_t)h;
+}
+
+float fp16_a_float(uint16_t h) {
+    uint32_t signo = (uint32_t)(h & 0x8000) << 16;
+    uint32_t exp = (h >> 10) & 0x1F, mant = h & 0x3FF, bits;
+    if (exp == 0) {
+        if (mant == 0) {
+            bits = signo;
+        } else {                                       // Subnormal: se normaliza
+            exp = 127 - 15 + 1;
+            while ((mant & 0x400) == 0) { mant <<= 1; exp--; }
+            bits = signo | (exp << 23) | ((mant & 0x3FF) << 13);
+        }
+    } else if (exp == 31) {
+        bits = signo | 0x7F800000 | (mant << 13);
+    } else {
+        bits = signo | ((exp + 127 - 15) << 23) | (mant << 13);
+    }
+    float f;
+    memcpy(&f, &bits, sizeof(f));
+    return f;
+}
+
+ESCALAR_SIN_REASOCIAR
+static void distancias_int16_escalar(const float *patron, const uint16_t *filas, int num_filas, const float *escala,
+                                     const float *desplazamiento, int cols, float *distancias) {
+    int stride = distancia_stride(cols);
+    for (int f = 0; f < num_filas; f++) {
+        const uint16_t *fila = &filas[(long)f * stride];
+        float acc[DISTANCIA_ANCHO] = { 0.0f };
+        for (int i = 0; i < cols; i++) {
+            float diff = patron[i] - fmaf((float)(int16_t)fila[i], escala[i], desplazamiento[i]);
+            acc[i % DISTANCIA_ANCHO] += diff * diff;
+        }
+        distancias[f] = suma_carriles(acc);
+    }
+}
+
+ESCALAR_SIN_REASOCIAR
+static void distancias_fp16_escalar(const float *patron, const uint16_t *filas, int num_filas, const float *escala,
+                                    const float *desplazamiento, int cols, float *distancias) {
+    int stride = distancia_stride(cols);
+    for (int f = 0; f < num_filas; f++) {
+        const uint16_t *fila = &filas[(long)f * stride];
+        float acc[DISTANCIA_ANCHO] = { 0.0f };
+        for (int i = 0; i < cols; i++) {
+            float diff = patron[i] - fmaf(fp16_a_float(fila[i]), escala[i], desplazamiento[i]);
+            acc[i % DISTANCIA_ANCHO] += diff * diff;
+        }
+        distancias[f] = suma_carriles(acc);
+    }
+}
+
+FuncDistancia calcular_distancia_sq = distancia_escalar;
+FuncDistanciaMulti calcular_distancias_multi = distancias_multi_escalar;
+FuncDistanciaAcotada calcular_distancia_sq_acotada = distancia_acotada_escalar;
+FuncDistanciaCompacta calcular_distancias_int16 = distancias_int16_escalar;
+FuncDistanciaCompacta calcular_distancias_fp16 = distancias_fp16_escalar;
+static char nombre_kernel[32] = "escalar";
+
+int distancia_stride(int columnas) {
+    return (columnas + DISTANCIA_ANCHO - 1) / DISTANCIA_ANCHO * DISTANCIA_ANCHO;
+}
+
+float* reservar_filas_alineadas(long filas, int stride) {
+    size_t bytes = (size_t)(filas > 0 ? filas : 1) * stride * sizeof(float);
+    // aligned_alloc exige que el tamaño sea múltiplo de la alineación
+    bytes = (bytes + DISTANCIA_ALINEACION - 1) / DISTANCIA_ALINEACION * DISTANCIA_ALINEACION;
+    float *p = (float *)aligned_alloc(DISTANCIA_ALINEACION, bytes);
+    if (p) memset(p, 0, bytes);
+    return p;
+}
+
+float* reservar_filas_primer_toque(long filas, int stride) {
+    long num_filas = filas > 0 ? filas : 1;
+    size_t bytes = (size_t)num_filas * stride * sizeof(float);
+    bytes = (bytes + DISTANCIA_ALINEACION - 1) / DISTANCIA_ALINEACION * DISTANCIA_ALINEACION;
+    float *p = (float *)aligned_alloc(DISTANCIA_ALINEACION, bytes);
+    if (p == NULL) return NULL;
+
+    // Mismo reparto que el recorrido de filas (schedule(static) sobre las filas)
+    #pragma omp parallel for schedule(static)
+    for (long i = 0; i < num_filas; i++) memset(&p[i * stride], 0, (size_t)stride * sizeof(float));
+    size_t usados = (size_t)num_filas * stride * sizeof(float);
+    if (bytes > usados) memset((char *)p + usados, 0, bytes - usados);
+    return p;
+}
+
+#ifdef DISTANCIA_X86
+
+#define ATTR_AVX2   __attribute__((target("avx2,fma")))
+#define ATTR_AVX512 __attribute__((target("avx512f,avx2,fma")))
+#define ATTR_F16C   __attribute__((target("avx2,fma,f16c")))
+#define EN_LINEA    __attribute__((always_inline)) inline
+
+// Máximo de registros que usamos para mantener la fila cargada en los kernels multi-patrón
+#define MAX_REG_FILA 4
+
+// --- AVX2 + FMA (8 floats por registro) ---
+
+static ATTR_AVX2 EN_LINEA float suma_horizontal_avx2(__m256 v) {
+    __m128 s = _mm_add_ps(_mm256_castps256_ps128(v), _mm256_extractf128_ps(v, 1));
+    s = _mm_add_ps(s, _mm_movehl_ps(s, s));
+    s = _mm_add_ss(s, _mm_movehdup_ps(s));
+    return _mm_cvtss_f32(s);
+}
+
+// 'n' es el stride (múltiplo de 8). Con 'n' constante el bucle se desenrolla entero.
+static ATTR_AVX2 EN_LINEA float distancia_avx2_n(const float *a, const float *b, int n) {
+    __m256 acc = _mm256_setzero_ps();
+    for (int j = 0; j < n; j += 8) {
+        __m256 d = _mm256_sub_ps(_mm256_loadu_ps(a + j), _mm256_loadu_ps(b + j));
+        acc = _mm256_fmadd_ps(d, d, acc);
+    }
+    return suma_horizontal_avx2(acc);
+}
+
+// Abandono temprano tras cada bloque de 8 (salvo el último). Las FMA de cuadrados solo
+// hacen crecer cada carril, así que la suma parcial nunca supera a la final.
+static ATTR_AVX2 EN_LINEA float distancia_acotada_avx2_n(const float *a, const float *b, int n, float umbral) {
+    __m256 acc = _mm256_setzero_ps();
+    for (int j = 0; j < n; j += 8) {
+        __m256 d = _mm256_sub_ps(_mm256_loadu_ps(a + j), _mm256_loadu_ps(b + j));
+        acc = _mm256_fmadd_ps(d, d, acc);
+        if (j + 8 < n) {
+            float parcial = suma_horizontal_avx2(acc);
+            if (parcial >= umbral) return parcial;
+        }
+    }
+    return suma_horizontal_avx2(acc);
+}
+
+// Mismo orden de operaciones que distancia_avx2_n: los resultados son idénticos bit a bit
+static ATTR_AVX2 EN_LINEA void distancias_multi_avx2_n(const float *fila, const float *patrones, int num_patrones,
+                                                       int stride, int n, float *distancias) {
+    if (n > MAX_REG_FILA * 8) {
+        for (int p = 0; p < num_patrones; p++) distancias[p] = distancia_avx2_n(fila, &patrones[(long)p * stride], n);
+        return;
+    }
+    __m256 f[MAX_REG_FILA];
+    for (int j = 0; j < n / 8; j++) f[j] = _mm256_loadu_ps(fila + 8 * j);
+
+    for (int p = 0; p < num_patrones; p++) {
+        const float *pat = &patrones[(long)p * stride];
+        __m256 acc = _mm256_setzero_ps();
+        for (int j = 0; j < n / 8; j++) {
+            __m256 d = _mm256_sub_ps(f[j], _mm256_loadu_ps(pat + 8 * j));
+            acc = _mm256_fmadd_ps(d, d, acc);
+        }
+        distancias[p] = suma_horizontal_avx2(acc);
+    }
+}
+
+// --- AVX-512 (16 floats por registro, cola de 8 con máscara) ---
+
+static ATTR_AVX512 EN_LINEA float distancia_avx512_n(const float *a, const float *b, int n) {
+    __m512 acc = _mm512_setzero_ps();
+    int j = 0;
+    for (; j + 16 <= n; j += 16) {
+        __m512 d = _mm512_sub_ps(_mm512_loadu_ps(a + j), _mm512_loadu_ps(b + j));
+        acc = _mm512_fmadd_ps(d, d, acc);
+    }
+    if (j < n) {
+        __mmask16 m = (__mmask16)((1u << (n - j)) - 1);
+        __m512 d = _mm512_sub_ps(_mm512_maskz_loadu_ps(m, a + j), _mm512_maskz_loadu_ps(m, b + j));
+        acc = _mm512_fmadd_ps(d, d, acc);
+    }
+    return _mm512_reduce_add_ps(acc);
+}
+
+static ATTR_AVX512 EN_LINEA float distancia_acotada_avx512_n(const float *a, const float *b, int n, float umbral) {
+    __m512 acc = _mm512_setzero_ps();
+    int j = 0;
+    for (; j + 16 <= n; j += 16) {
+        __m512 d = _mm512_sub_ps(_mm512_loadu_ps(a + j), _mm512_loadu_ps(b + j));
+        acc = _mm512_fmadd_ps(d, d, acc);
+        if (j + 16 < n) {
+            float parcial = _mm512_reduce_add_ps(acc);
+            if (parcial >= umbral) return parcial;
+        }
+    }
+    if (j < n) {
+        __mmask16 m = (__mmask16)((1u << (n - j)) - 1);
+        __m512 d = _mm512_sub_ps(_mm512_maskz_loadu_ps(m, a + j), _mm512_maskz_loadu_ps(m, b + j));
+        acc = _mm512_fmadd_ps(d, d, acc);
+    }
+    return _mm512_reduce_add_ps(acc);
+}
+
+static ATTR_AVX512 EN_LINEA void distancias_multi_avx512_n(const float *fila, const float *patrones, int num_patrones,
+                                                           int stride, int n, float *distancias) {
+    if (n > MAX_REG_FILA * 16) {
+        for (int p = 0; p < num_patrones; p++) distancias[p] = distancia_avx512_n(fila, &patrones[(long)p * stride], n);
+        return;
+    }
+    int completos = n / 16;
+    __mmask16 m = (__mmask16)((1u << (n % 16)) - 1);
+    __m512 f[MAX_REG_FILA + 1];
+    for (int j = 0; j < completos; j++) f[j] = _mm512_loadu_ps(fila + 16 * j);
+    if (m) f[completos] = _mm512_maskz_loadu_ps(m, fila + 16 * completos);
+
+    for (int p = 0; p < num_patrones; p++) {
+        const float *pat = &patrones[(long)p * stride];
+        __m512 acc = _mm512_setzero_ps();
+        for (int j = 0; j < completos; j++) {
+            __m512 d = _mm512_sub_ps(f[j], _mm512_loadu_ps(pat + 16 * j));
+            acc = _mm512_fmadd_ps(d, d, acc);
+        }
+        if (m) {
+            __m512 d = _mm512_sub_ps(f[completos], _mm512_maskz_loadu_ps(m, pat + 16 * completos));
+            acc = _mm512_fmadd_ps(d, d, acc);
+        }
+        distancias[p] = _mm512_reduce_add_ps(acc);
+    }
+}
+
+// --- INSTANCIAS: genéricas (stride en tiempo de ejecución) y especializadas por columnas ---
+
+#define DEFINIR_KERNELS(ISA, ATTR, N)                                                              \
+    static ATTR float distancia_##ISA##_##N(const float *a, const float *b, int cols) {           \
+        (void)cols;                                                                                \
+        return distancia_##ISA##_n(a, b, N);                                                       \
+    }                                                                                              \
+    static ATTR void distancias_multi_##ISA##_##N(const float *fila, const float *patrones,        \
+                                                  int num_patrones, int stride, int cols,          \
+                                                  float *distancias) {                             \
+        (void)cols;                                                                                \
+        distancias_multi_##ISA##_n(fila, patrones, num_patrones, stride, N, distancias);           \
+    }                                                                                              \
+    static ATTR float distancia_acotada_##ISA##_##N(const float *a, const float *b, int cols,      \
+                                                    float umbral) {                                \
+        (void)cols;                                                                                \
+        return distancia_acotada_##ISA##_n(a, b, N, umbral);                                       \
+    }
+
+DEFINIR_KERNELS(avx2, ATTR_AVX2, 8)
+DEFINIR_KERNELS(avx2, ATTR_AVX2, 16)
+DEFINIR_KERNELS(avx2, ATTR_AVX2, 24)
+DEFINIR_KERNELS(avx2, ATTR_AVX2, 32)
+DEFINIR_KERNELS(avx512, ATTR_AVX512, 8)
+DEFINIR_KERNELS(avx512, ATTR_AVX512, 16)
+DEFINIR_KERNELS(avx512, ATTR_AVX512, 24)
+DEFINIR_KERNELS(avx512, ATTR_AVX512, 32)
+
+static ATTR_AVX2 float distancia_avx2_gen(const float *a, const float *b, int cols) {
+    return distancia_avx2_n(a, b, distancia_stride(cols));
+}
+static ATTR_AVX2 void distancias_multi_avx2_gen(const float *fila, const float *patrones, int num_patrones,
+                                                int stride, int cols, float *distancias) {
+    distancias_multi_avx2_n(fila, patrones, num_patrones, stride, distancia_stride(cols), distancias);
+}
+static ATTR_AVX2 float distancia_acotada_avx2_gen(const float *a, const float *b, int cols, float umbral) {
+    return distancia_acotada_avx2_n(a, b, distancia_stride(cols), umbral);
+}
+static ATTR_AVX512 float distancia_avx512_gen(const float *a, const float *b, int cols) {
+    return distancia_avx512_n(a, b, distancia_stride(cols));
+}
+static ATTR_AVX512 void distancias_multi_avx512_gen(const float *fila, const float *patrones, int num_patrones,
+                                                    int stride, int cols, float *distancias) {
+    distancias_multi_avx512_n(fila, patrones, num_patrones, stride, distancia_stride(cols), distancias);
+}
+static ATTR_AVX512 float distancia_acotada_avx512_gen(const float *a, const float *b, int cols, float umbral) {
+    return distancia_acotada_avx512_n(a, b, distancia_stride(cols), umbral);
+}
+
+// --- FILAS COMPACTAS: 8 (AVX2) o 16 (AVX-512) valores de 16 bits por carga ---
+// Cada valor se ensancha a float y se reconstruye con una FMA (q * escala + desplazamiento).
+// El relleno tiene escala y desplazamiento 0, así que no suma nada. Patrón, escalas y
+// desplazamientos se cargan una vez por bloque de filas; solo se leen las filas de 16 bits.
+
+static ATTR_AVX2 EN_LINEA __m256 a_float_int16_avx2(const uint16_t *q) {
+    return _mm256_cvtepi32_ps(_mm256_cvtepi16_epi32(_mm_loadu_si128((const __m128i *)q)));
+}
+static ATTR_F16C EN_LINEA __m256 a_float_fp16_avx2(const uint16_t *q) {
+    return _mm256_cvtph_ps(_mm_loadu_si128((const __m128i *)q));
+}
+static ATTR_AVX512 EN_LINEA __m512 a_float_int16_avx512(const uint16_t *q) {
+    return _mm512_cvtepi32_ps(_mm512_cvtepi16_epi32(_mm256_loadu_si256((const __m256i *)q)));
+}
+static ATTR_AVX512 EN_LINEA __m512 a_float_fp16_avx512(const uint16_t *q) {
+    return _mm512_cvtph_ps(_mm256_loadu_si256((const __m256i *)q));
+}
+// Cola de 8 valores (el stride es múltiplo de 8): la mitad alta queda a 0
+static ATTR_AVX512 EN_LINEA __m512 a_float_int16_cola_avx512(const uint16_t *q) {
+    return _mm512_cvtepi32_ps(_mm512_cvtepi16_epi32(_mm256_zextsi128_si256(_mm_loadu_si128((const __m128i *)q))));
+}
+static ATTR_AVX512 EN_LINEA __m512 a_float_fp16_cola_avx512(const uint16_t *q) {
+    return _mm512_cvtph_ps(_mm256_zextsi128_si256(_mm_loadu_si128((const __m128i *)q)));
+}
+
+// Cuerpo común a int16 y fp16 ('n' es el stride). Si los registros no bastan para el patrón,
+// las escalas y los desplazamientos, se leen de memoria en cada fila.
+#define DEFINIR_COMPACTO_AVX2_N(TIPO, ATTR)                                                           \
+    static ATTR EN_LINEA void distancias_##TIPO##_avx2_n(const float *patron, const uint16_t *filas,   \
+                                                         int num_filas, const float *escala,          \
+                                                         const float *desplazamiento, int n,          \
+                                                         float *distancias) {                         \
+        if (n > MAX_REG_FILA * 8) {                                                                   \
+            for (int i = 0; i < num_filas; i++) {                                                     \
+                const uint16_t *q = filas + (long)i * n;                                              \
+                __m256 acc = _mm256_setzero_ps();                                                     \
+                for (int j = 0; j < n; j += 8) {                                                      \
+                    __m256 x = _mm256_fmadd_ps(a_float_##TIPO##_avx2(q + j), _mm256_loadu_ps(escala + j), \
+                                               _mm256_loadu_ps(desplazamiento + j));                  \
+                    __m256 d = _mm256_sub_ps(_mm256_loadu_ps(patron + j), x);                         \
+                    acc = _mm256_fmadd_ps(d, d, acc);                                                 \
+                }                                                                                     \
+                distancias[i] = suma_horizontal_avx2(acc);                                            \
+            }                                                                                         \
+            return;                                                                                   \
+        }                                                                                             \
+        __m256 p[MAX_REG_FILA], s[MAX_REG_FILA], o[MAX_REG_FILA];                                     \
+        for (int j = 0; j < n / 8; j++) {                                                             \
+            p[j] = _mm256_loadu_ps(patron + 8 * j);                                                   \
+            s[j] = _mm256_loadu_ps(escala + 8 * j);                                                   \
+            o[j] = _mm256_loadu_ps(desplazamiento + 8 * j);                                           \
+        }                                                                                             \
+        for (int i = 0; i < num_filas; i++) {                                                         \
+            const uint16_t *q = filas + (long)i * n;                                                  \
+            __m256 acc = _mm256_setzero_ps();                                                         \
+            for (int j = 0; j < n / 8; j++) {                                                         \
+                __m256 d = _mm256_sub_ps(p[j], _mm256_fmadd_ps(a_float_##TIPO##_avx2(q + 8 * j), s[j], o[j])); \
+                acc = _mm256_fmadd_ps(d, d, acc);                                                     \
+            }                                                                                         \
+            distancias[i] = suma_horizontal_avx2(acc);                                                \
+        }                                                                                             \
+    }
+
+#define DEFINIR_COMPACTO_AVX512_N(TIPO)                                                               \
+    static ATTR_AVX512 EN_LINEA void distancias_##TIPO##_avx512_n(const float *patron,                 \
+                                                                  const uint16_t *filas, int num_filas, \
+                                                                  const float *escala,                \
+                                                                  const float *desplazamiento, int n, \
+                                                                  float *distancias) {                \
+        int completos = n / 16;                                                                       \
+        __mmask16 m = (__mmask16)((1u << (n % 16)) - 1);                                              \
+        if (n > MAX_REG_FILA * 16) {                                                                  \
+            for (int i = 0; i < num_filas; i++) {                                                     \
+                const uint16_t *q = filas + (long)i * n;                                              \
+                __m512 acc = _mm512_setzero_ps();                                                     \
+                for (int j = 0; j < completos; j++) {                                                 \
+                    __m512 x = _mm512_fmadd_ps(a_float_##TIPO##_avx512(q + 16 * j), _mm512_loadu_ps(escala + 16 * j), \
+                                               _mm512_loadu_ps(desplazamiento + 16 * j));             \
+                    __m512 d = _mm512_sub_ps(_mm512_loadu_ps(patron + 16 * j), x);                    \
+                    acc = _mm512_fmadd_ps(d, d, acc);                                                 \
+                }                                                                                     \
+                if (m) {                                                                              \
+                    int j = 16 * completos;                                                           \
+                    __m512 x = _mm512_fmadd_ps(a_float_##TIPO##_cola_avx512(q + j), _mm512_maskz_loadu_ps(m, escala + j), \
+                                               _mm512_maskz_loadu_ps(m, desplazamiento + j));         \
+                    __m512 d = _mm512_sub_ps(_mm512_maskz_loadu_ps(m, patron + j), x);                \
+                    acc = _mm512_fmadd_ps(d, d, acc);                                                 \
+                }                                                                                     \
+                distancias[i] = _mm512_reduce_add_ps(acc);                                            \
+            }                                                                                         \
+            return;                                                                                   \
+        }                                                                                             \
+        __m512 p[MAX_REG_FILA + 1], s[MAX_REG_FILA + 1], o[MAX_REG_FILA + 1];                         \
+        for (int j = 0; j < completos; j++) {                                                         \
+            p[j] = _mm512_loadu_ps(patron + 16 * j);                                                  \
+            s[j] = _mm512_loadu_ps(escala + 16 * j);                                                  \
+            o[j] = _mm512_loadu_ps(desplazamiento + 16 * j);                                          \
+        }                                                                                             \
+        if (m) {                                                                                      \
+            p[completos] = _mm512_maskz_loadu_ps(m, patron + 16 * completos);                         \
+            s[completos] = _mm512_maskz_loadu_ps(m, escala + 16 * completos);                         \
+            o[completos] = _mm512_maskz_loadu_ps(m, desplazamiento + 16 * completos);                 \
+        }                                                                                             \
+        for (int i = 0; i < num_filas; i++) {                                                         \
+            const uint16_t *q = filas + (long)i * n;                                                  \
+            __m512 acc = _mm512_setzero_ps();                                                         \
+            for (int j = 0; j < completos; j++) {                                                     \
+                __m512 d = _mm512_sub_ps(p[j], _mm512_fmadd_ps(a_float_##TIPO##_avx512(q + 16 * j), s[j], o[j])); \
+                acc = _mm512_fmadd_ps(d, d, acc);                                                     \
+            }                                                                                         \
+            if (m) {                                                                                  \
+                __m512 x = a_float_##TIPO##_cola_avx512(q + 16 * completos);                          \
+                __m512 d = _mm512_sub_ps(p[completos], _mm512_fmadd_ps(x, s[completos], o[completos])); \
+                acc = _mm512_fmadd_ps(d, d, acc);                                                     \
+            }                                                                                         \
+            distancias[i] = _mm512_reduce_add_ps(acc);                                                \
+        }                                                                                             \
+    }
+
+DEFINIR_COMPACTO_AVX2_N(int16, ATTR_AVX2)
+DEFINIR_COMPACTO_AVX2_N(fp16, ATTR_F16C)
+DEFINIR_COMPACTO_AVX512_N(int16)
+DEFINIR_COMPACTO_AVX512_N(fp16)
+
+#define DEFINIR_KERNEL_COMPACTO(TIPO, ISA, ATTR, N)                                                   \
+    static ATTR void distancias_##TIPO##_##ISA##_##N(const float *patron, const uint16_t *filas,       \
+                                                     int num_filas, const float *escala,              \
+                                                     const float *desplazamiento, int cols,           \
+                                                     float *distancias) {                             \
+        (void)cols;                                                                                   \
+        distancias_##TIPO##_##ISA##_n(patron, filas, num_filas, escala, desplazamiento, N, distancias); \
+    }
+
+#define DEFINIR_KERNELS_COMPACTOS(N)                          \
+    DEFINIR_KERNEL_COMPACTO(int16, avx2, ATTR_AVX2, N)        \
+    DEFINIR_KERNEL_COMPACTO(fp16, avx2, ATTR_F16C, N)         \
+    DEFINIR_KERNEL_COMPACTO(int16, avx512, ATTR_AVX512, N)    \
+    DEFINIR_KERNEL_COMPACTO(fp16, avx512, ATTR_AVX512, N)
+
+DEFINIR_KERNELS_COMPACTOS(8)
+DEFINIR_KERNELS_COMPACTOS(16)
+DEFINIR_KERNELS_COMPACTOS(24)
+DEFINIR_KERNELS_COMPACTOS(32)
+
+#define DEFINIR_KERNEL_COMPACTO_GEN(TIPO, ISA, ATTR)                                                  \
+    static ATTR void distancias_##TIPO##_##ISA##_gen(const float *patron, const uint16_t *filas,       \
+                                                     int num_filas, const float *escala,              \
+                                                     const float *desplazamiento, int cols,           \
+                                                     float *distancias) {                             \
+        distancias_##TIPO##_##ISA##_n(patron, filas, num_filas, escala, desplazamiento,               \
+                                      distancia_stride(cols), distancias);                            \
+    }
+
+DEFINIR_KERNEL_COMPACTO_GEN(int16, avx2, ATTR_AVX2)
+DEFINIR_KERNEL_COMPACTO_GEN(fp16, avx2, ATTR_F16C)
+DEFINIR_KERNEL_COMPACTO_GEN(int16, avx512, ATTR_AVX512)
+DEFINIR_KERNEL_COMPACTO_GEN(fp16, avx512, ATTR_AVX512)
+
+typedef struct {
+    int stride;               // 0 = genérico
+    FuncDistancia distancia;
+    FuncDistanciaMulti multi;
+    FuncDistanciaAcotada acotada;
+    FuncDistanciaCompacta int16;
+    FuncDistanciaCompacta fp16;
+} KernelDistancia;
+
+#define KERNEL(ISA, N) { N, distancia_##ISA##_##N, distancias_multi_##ISA##_##N, distancia_acotada_##ISA##_##N, \
+                         distancias_int16_##ISA##_##N, distancias_fp16_##ISA##_##N }
+
+static const KernelDistancia KERNELS_AVX2[] = {
+    KERNEL(avx2, 8), KERNEL(avx2, 16), KERNEL(avx2, 24), KERNEL(avx2, 32),
+    { 0, distancia_avx2_gen, distancias_multi_avx2_gen, distancia_acotada_avx2_gen,
+      distancias_int16_avx2_gen, distancias_fp16_avx2_gen },
+};
+
+static const KernelDistancia KERNELS_AVX512[] = {
+    KERNEL(avx512, 8), KERNEL(avx512, 16), KERNEL(avx512, 24), KERNEL(avx512, 32),
+    { 0, distancia_avx512_gen, distancias_multi_avx512_gen, distancia_acotada_avx512_gen,
+      distancias_int16_avx512_gen, distancias_fp16_avx512_gen },
+};
+
+static void elegir_kernel(const KernelDistancia *tabla, const char *isa, int stride) {
+    int i = 0;
+    while (tabla[i].stride != 0 && tabla[i].stride != stride) i++;
+    calcular_distancia_sq = tabla[i].distancia;
+    calcular_distancias_multi = tabla[i].multi;
+    calcular_distancia_sq_acotada = tabla[i].acotada;
+    calcular_distancias_int16 = tabla[i].int16;
+    calcular_distancias_fp16 = tabla[i].fp16;
+    if (tabla[i].stride) snprintf(nombre_kernel, sizeof(nombre_kernel), "%s-%d", isa, stride);
+    else snprintf(nombre_kernel, sizeof(nombre_kernel), "%s", isa);
+}
+
+#endif // DISTANCIA_X86
+
+NivelSimd distancia_inicializar(int columnas, NivelSimd pedido) {
+    NivelSimd nivel = SIMD_ESCALAR;
+
+#ifdef DISTANCIA_X86
+    __builtin_cpu_init();
+    int hay_avx2 = __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma");
+    int hay_avx512 = hay_avx2 && __builtin_cpu_supports("avx512f");
+
+    if ((pedido == SIMD_AUTO || pedido == SIMD_AVX512) && hay_avx512) nivel = SIMD_AVX512;
+    else if ((pedido == SIMD_AUTO || pedido == SIMD_AVX512 || pedido == SIMD_AVX2) && hay_avx2) nivel = SIMD_AVX2;
+
+    int stride = distancia_stride(columnas);
+    if (nivel == SIMD_AVX512) { elegir_kernel(KERNELS_AVX512, "avx512", stride); return nivel; }
+    if (nivel == SIMD_AVX2) {
+        elegir_kernel(KERNELS_AVX2, "avx2", stride);
+        // La conversión vectorial de fp16 es de F16C, aparte de AVX2
+        if (!__builtin_cpu_supports("f16c")) calcular_distancias_fp16 = distancias_fp16_escalar;
+        return nivel;
+    }
+#else
+    (void)pedido;
+#endif
+
+    (void)columnas;
+    calcular_distancia_sq = distancia_escalar;
+    calcular_distancias_multi = distancias_multi_escalar;
+    calcular_distancia_sq_acotada = distancia_acotada_escalar;
+    calcular_distancias_int16 = distancias_int16_escalar;
+    calcular_distancias_fp16 = distancias_fp16_escalar;
+    snprintf(nombre_kernel, sizeof(nombre_kernel), "escalar");
+    return nivel;
+}
+
+const char* distancia_nombre_kernel(void) {
+    return nombre_kernel;
+}
@@ -0,0 +1,71 @@
+#ifndef DISTANCIA_H
+#define DISTANCIA_H
+
+// Kernels de distancia euclídea al cuadrado con selección en tiempo de ejecución
+// (escalar, AVX2+FMA o AVX-512) según la CPU, sin depender de -march=native.
+//
+// Las filas se guardan con 'stride' floats (columnas redondeadas al ancho SIMD de 8)
+// en memoria alineada a 64 bytes. El relleno vale 0 tanto en los datos como en los
+// patrones, así los kernels recorren vectores completos sin tratar la cola.
+
+#include <stdint.h>
+
+#define DISTANCIA_ALINEACION 64
+#define DISTANCIA_ANCHO 8
+
+typedef enum {
+    SIMD_AUTO = 0,
+    SIMD_ESCALAR,
+    SIMD_AVX2,
+    SIMD_AVX512
+} NivelSimd;
+
+// Distancia al cuadrado entre dos vectores de 'cols' columnas (con relleno hasta el stride)
+typedef float (*FuncDistancia)(const float *v1, const float *v2, int cols);
+
+// Distancias de una fila contra 'num_patrones' patrones separados 'stride' floats.
+// La fila se carga una sola vez y se reutiliza para todos los patrones.
+typedef void (*FuncDistanciaMulti)(const float *fila, const float *patrones, int num_patrones,
+                                   int stride, int cols, float *distancias);
+
+// Distancia con abandono temprano: en cuanto la suma parcial alcanza 'umbral' devuelve
+// esa suma parcial (>= umbral). Si no abandona, el resultado es idéntico bit a bit al de
+// calcular_distancia_sq (mismo orden de operaciones), así la poda no cambia los vecinos.
+typedef float (*FuncDistanciaAcotada)(const float *v1, const float *v2, int cols, float umbral);
+
+// Distancias entre un patrón float32 y 'num_filas' filas compactas consecutivas (int16 o fp16,
+// ver compacto.h, con distancia_stride(cols) valores por fila). Cada valor se reconstruye como
+// fmaf(q, escala[j], desplazamiento[j]), con el mismo redondeo en todos los kernels.
+typedef void (*FuncDistanciaCompacta)(const float *patron, const uint16_t *filas, int num_filas, const float *escala,
+                                      const float *desplazamiento, int cols, float *distancias);
+
+// Punteros al kernel elegido por distancia_inicializar()
+extern FuncDistancia calcular_distancia_sq;
+extern FuncDistanciaMulti calcular_distancias_multi;
+extern FuncDistanciaAcotada calcular_distancia_sq_acotada;
+extern FuncDistanciaCompacta calcular_distancias_int16;
+extern FuncDistanciaCompacta calcular_distancias_fp16;
+
+// Elige los kernels para 'columnas' (SIMD_AUTO = el mejor que soporte la CPU).
+// Devuelve el nivel realmente usado (si se pide uno no soportado, baja al siguiente).
+NivelSimd distancia_inicializar(int columnas, NivelSimd pedido);
+
+// Nombre del kernel activo (p.ej. "avx2-24") para los informes
+const char* distancia_nombre_kernel(void);
+
+// Columnas redondeadas al múltiplo de DISTANCIA_ANCHO
+int distancia_stride(int columnas);
+
+// Conversión float <-> fp16 (IEEE binary16, redondeo al par más cercano) sin depender de F16C
+uint16_t float_a_fp16(float x);
+float fp16_a_float(uint16_t h);
+
+// Reserva filas * stride floats alineados a DISTANCIA_ALINEACION e inicializados a 0.
+// Se liberan con free().
+float* reservar_filas_alineadas(long filas, int stride);
+
+// Igual, pero el 0 inicial lo escriben los hilos OpenMP con reparto estático por filas: con la
+// política de primer toque cada página queda en el nodo NUMA del hilo que recorrerá esas filas.
+float* reservar_filas_primer_toque(long filas, int stride);
+
+#endif
@@ -0,0 +1,286 @@
+/*
+ * src/experimentos.c
+ * Matriz de experimentos en un solo lanzamiento: subcomunicadores por configuración y
+ * una sola carga de cada dataset.
+ */
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <mpi.h>
+#include <omp.h>
+#include "experimentos.h"
+#include "k_nn.h"
+#include "utils.h"
+#include "distancia.h"
+#include "dataset_bin.h"
+
+#define MASTERPID 0
+#define MAX_RUTA_EXPERIMENTO 512
+#define MAX_VALORES_CAMPO 256     // Valores por campo tras expandir listas y rangos
+
+typedef struct {
+    char fichero[MAX_RUTA_EXPERIMENTO];
+    int k;
+    int procesos;
+    int hilos;
+} ConfigExperimento;
+
+// "1,2,4" o "1-4" (o combinaciones: "1-4,8") -> valores. Devuelve cuántos, o -1 si no es válido.
+static int expandir_enteros(char *campo, int *valores) {
+    int num = 0;
+    char *guardado = NULL;
+    for (char *tramo = strtok_r(campo, ",", &guardado); tramo; tramo = strtok_r(NULL, ",", &guardado)) {
+        int desde, hasta;
+        char resto;
+        if (sscanf(tramo, "%d-%d%c", &desde, &hasta, &resto) == 2) {
+            if (hasta < desde) return -1;
+        } else if (sscanf(tramo, "%d%c", &desde, &resto) == 1) {
+            hasta = desde;
+        } else {
+            return -1;
+        }
+        for (int v = desde; v <= hasta; v++) {
+            if (num == MAX_VALORES_CAMPO) return -1;
+            valores[num++] = v;
+        }
+    }
+    return num;
+}
+
+static void anadir_config(ConfigExperimento **configs, int *num, int *capacidad, const ConfigExperimento *c) {
+    if (*num == *capacidad) {
+        *capacidad = *capacidad ? 2 * *capacidad : 64;
+        *configs = (ConfigExperimento *)realloc(*configs, *capacidad * sizeof(ConfigExperimento));
+        if (*configs == NULL) {
+            perror("Error realloc configuraciones");
+            MPI_Abort(MPI_COMM_WORLD, EXIT_FAILURE);
+        }
+    }
+    (*configs)[(*num)++] = *c;
+}
+
+// Solo Master: lee el fichero de configuraciones y expande cada línea (producto cartesiano)
+static ConfigExperimento* leer_configuraciones(const char *ruta, int *num_configs) {
+    FILE *f = fopen(ruta, "r");
+    if (f == NULL) {
+        fprintf(stderr, "[ERROR EXPERIMENTOS] No se pudo abrir %s\n", ruta);
+        MPI_Abort(MPI_COMM_WORLD, EXIT_FAILURE);
+    }
+
+    ConfigExperimento *configs = NULL;
+    int num = 0, capacidad = 0;
+    static int ks[MAX_VALORES_CAMPO], procesos[MAX_VALORES_CAMPO], hilos[MAX_VALORES_CAMPO];
+    char *linea = NULL;
+    size_t tam_linea = 0;
+    int num_linea = 0;
+    while (getline(&linea, &tam_linea, f) >= 0) {
+        num_linea++;
+        char *comentario = strchr(linea, '#');
+        if (comentario) *comentario = '\0';
+
+        char *campos[4], *guardado = NULL;
+        int num_campos = 0;
+        for (char *t = strtok_r(linea, " \t\r\n", &guardado); t; t = strtok_r(NULL, " \t\r\n", &guardado)) {
+            if (num_campos < 4) campos[num_campos] = t;
+            num_campos++;
+        }
+        if (num_campos == 0) continue;
+
+        int nk = -1, np = -1, nh = -1;
+        if (num_campos == 4) {
+            nk = expandir_enteros(campos[1], ks);
+            np = expandir_enteros(campos[2], procesos);
+            nh = expandir_enteros(campos[3], hilos);
+        }
+        if (nk <= 0 || np <= 0 || nh <= 0) {
+            fprintf(stderr, "[ERROR EXPERIMENTOS] %s:%d: se esperaba '<ficheros> <K> <procesos> <hilos>'\n", ruta, num_linea);
+            MPI_Abort(MPI_COMM_WORLD, EXIT_FAILURE);
+        }
+
+        char *guardado_fich = NULL;
+        for (char *fich = strtok_r(campos[0], ",", &guardado_fich); fich; fich = strtok_r(NULL, ",", &guardado_fich)) {
+            ConfigExperimento c;
+            if (strlen(fich) >= sizeof(c.fichero)) {
+                fprintf(stderr, "[ERROR EXPERIMENTOS] %s:%d: ruta demasiado larga\n", ruta, num_linea);
+                MPI_Abort(MPI_COMM_WORLD, EXIT_FAILURE);
+            }
+            memset(&c, 0, sizeof(c));
+            strcpy(c.fichero, fich);
+            for (int a = 0; a < nk; a++) {
+                for (int b = 0; b < np; b++) {
+                    for (int h = 0; h < nh; h++) {
+                        c.k = ks[a];
+                        c.procesos = procesos[b];
+                        c.hilos = hilos[h];
+                        anadir_config(&configs, &num, &capacidad, &c);
+                    }
+                }
+            }
+        }
+    }
+    free(linea);
+    fclose(f);
+    *num_configs = num;
+    return configs;
+}
+
+// Solo Master: dataset completo sin relleno (texto o binario), como lo recibe repartir_filas
+static float* cargar_dataset(const char *ruta, int *filas, int *columnas) {
+    if (!es_dataset_binario(ruta)) return leer_fichero(ruta, filas, columnas, MASTERPID);
+
+    CabeceraDataset cab;
+    if (leer_cabecera_dataset(ruta, &cab) != 0) MPI_Abort(MPI_COMM_WORLD, EXIT_FAILURE);
+    *filas = (int)cab.filas;
+    *columnas = (int)cab.columnas;
+    float *datos = leer_filas_dataset(ruta, &cab, 0, *filas, *columnas, MPI_COMM_SELF);
+    if (checksum_dataset(datos, (long)*filas * *columnas, 0) != cab.checksum) {
+        fprintf(stderr, "[ERROR IO] Checksum incorrecto en %s\n", ruta);
+        MPI_Abort(MPI_COMM_WORLD, EXIT_FAILURE);
+    }
+    return datos;
+}
+
+// Barrera sobre MPI_COMM_WORLD que no ocupa la CPU: los procesos que no participan en una
+// configuración esperan aquí sin quitar tiempo a los que miden
+static void esperar_resto(void) {
+    MPI_Request peticion;
+    int hecho = 0;
+    struct timespec pausa = {0, 1000000};
+    MPI_Ibarrier(MPI_COMM_WORLD, &peticion);
+    MPI_Test(&peticion, &hecho, MPI_STATUS_IGNORE);
+    while (!hecho) {
+        nanosleep(&pausa, NULL);
+        MPI_Test(&peticion, &hecho, MPI_STATUS_IGNORE);
+    }
+}
+
+// Opciones que dependen de un único lanzamiento por configuración
+static void descartar_opciones(OpcionesPrediccion *op, int pid) {
+    const char *ignoradas[5];
+    int num = 0;
+    if (op->ruta_continuo) { op->ruta_continuo = NULL; ignoradas[num++] = "--continuo"; }
+    if (op->memoria_compartida) { op->memoria_compartida = 0; ignoradas[num++] = "--memoria-compartida"; }
+    if (op->usar_mmap) { op->usar_mmap = 0; ignoradas[num++] = "--mmap"; }
+    if (op->prefijo_traza) { op->prefijo_traza = NULL; ignoradas[num++] = "--traza"; }
+    if (op->afinidad != AFINIDAD_NINGUNA) { op->afinidad = AFINIDAD_NINGUNA; ignoradas[num++] = "--afinidad"; }
+    for (int i = 0; i < num && pid == MASTERPID; i++) {
+        printf("[AVISO] %s no se admite con --experimentos: se ignora\n", ignoradas[i]);
+    }
+}
+
+void ejecutar_experimentos(OpcionesPrediccion *opciones, int pid, int prn) {
+    descartar_opciones(opciones, pid);
+
+    // El Master expande las configuraciones y las difunde
+    ConfigExperimento *configs = NULL;
+    int num_configs = 0;
+    if (pid == MASTERPID) configs = leer_configuraciones(opciones->ruta_experimentos, &num_configs);
+    MPI_Bcast(&num_configs, 1, MPI_INT, MASTERPID, MPI_COMM_WORLD);
+    if (num_configs == 0) {
+        if (pid == MASTERPID) printf("[EXPERIMENTOS] %s no contiene configuraciones\n", opciones->ruta_experimentos);
+        return;
+    }
+    if (pid != MASTERPID) {
+        configs = (ConfigExperimento *)malloc(num_configs * sizeof(ConfigExperimento));
+        if (configs == NULL) {
+            perror("Error malloc configuraciones");
+            MPI_Abort(MPI_COMM_WORLD, EXIT_FAILURE);
+        }
+    }
+    MPI_Bcast(configs, num_configs * (int)sizeof(ConfigExperimento), MPI_BYTE, MASTERPID, MPI_COMM_WORLD);
+
+    FILE *csv = NULL;
+    if (pid == MASTERPID) {
+        printf("[EXPERIMENTOS] %d configuraciones con %d procesos disponibles -> %s\n", num_configs, prn, EXPERIMENTOS_CSV);
+        csv = fopen(EXPERIMENTOS_CSV, "w");
+        if (csv == NULL) {
+            fprintf(stderr, "[ERROR EXPERIMENTOS] No se pudo crear %s\n", EXPERIMENTOS_CSV);
+            MPI_Abort(MPI_COMM_WORLD, EXIT_FAILURE);
+        }
+        fprintf(csv, "fichero,k,procesos,hilos,t_total,t_calculo,t_comunicacion,t_escritura,t_reparto,t_carga,mape\n");
+        fflush(csv);
+    }
+
+    // Cada dataset se carga una vez (en el orden de su primera aparición) y se ejecutan todas sus configuraciones
+    int hechas = 0;
+    for (int i = 0; i < num_configs; i++) {
+        int repetido = 0;
+        for (int j = 0; j < i && !repetido; j++) repetido = (strcmp(configs[j].fichero, configs[i].fichero) == 0);
+        if (repetido) continue;
+
+        const char *fichero = configs[i].fichero;
+        int filas_totales = 0, columnas = 0;
+        float *datos_globales = NULL;
+        double t_carga = MPI_Wtime();
+        if (pid == MASTERPID) datos_globales = cargar_dataset(fichero, &filas_totales, &columnas);
+        t_carga = MPI_Wtime() - t_carga;
+        MPI_Bcast(&filas_totales, 1, MPI_INT, MASTERPID, MPI_COMM_WORLD);
+        MPI_Bcast(&columnas, 1, MPI_INT, MASTERPID, MPI_COMM_WORLD);
+
+        int stride = distancia_stride(columnas);
+        distancia_inicializar(columnas, opciones->simd);
+        if (pid == MASTERPID) {
+            printf("[EXPERIMENTOS] %s: %d filas x %d columnas cargadas en %.4fs (kernel %s)\n",
+                   fichero, filas_totales, columnas, t_carga, distancia_nombre_kernel());
+        }
+
+        for (int j = i; j < num_configs; j++) {
+            const ConfigExperimento *c = &configs[j];
+            if (strcmp(c->fichero, fichero) != 0) continue;
+            hechas++;
+            if (c->procesos < 1 || c->procesos > prn || c->hilos < 1 || c->k < 1) {
+                if (pid == MASTERPID) {
+                    printf("[AVISO] Configuración %d/%d (%s K=%d P=%d H=%d) no válida con %d procesos: se omite\n",
+                           hechas, num_configs, fichero, c->k, c->procesos, c->hilos, prn);
+                }
+                continue;
+            }
+            if (pid == MASTERPID) {
+                printf("[EXPERIMENTOS] %d/%d: %s K=%d P=%d H=%d\n", hechas, num_configs, fichero, c->k, c->procesos, c->hilos);
+                fflush(stdout);
+            }
+
+            // Los 'procesos' primeros rangos forman la configuración; el Master es siempre el rango 0
+            MPI_Comm comm;
+            MPI_Comm_split(MPI_COMM_WORLD, pid < c->procesos ? 0 : MPI_UNDEFINED, pid, &comm);
+            if (comm != MPI_COMM_NULL) {
+                omp_set_num_threads(c->hilos);
+
+                double t_reparto = MPI_Wtime();
+                int *inicios = preparar_reparto(filas_totales, columnas, stride,
+                                                opciones->reparto == REPARTO_PONDERADO, comm);
+                int filas_almacenadas = calcular_filas_almacenadas(inicios, c->procesos, pid);
+                float *datos_locales = reservar_filas_primer_toque(filas_almacenadas, stride);
+                if (datos_locales == NULL) {
+                    perror("Error malloc local");
+                    MPI_Abort(MPI_COMM_WORLD, EXIT_FAILURE);
+                }
+                repartir_filas(datos_globales, datos_locales, columnas, stride, inicios, comm);
+                t_reparto = MPI_Wtime() - t_reparto;
+
+                // La carga ya está hecha: T_Total de la configuración es reparto + algoritmo
+                ResultadoPrediccion res;
+                ejecutar_predicciones(datos_locales, inicios[pid+1] - inicios[pid], columnas, stride, c->k,
+                                      c->procesos, pid, comm, inicios, filas_totales, fichero,
+                                      0.0, t_reparto, opciones, &res);
+                if (pid == MASTERPID) {
+                    fprintf(csv, "%s,%d,%d,%d,%.6f,%.6f,%.6f,%.6f,%.6f,%.6f,%.4f\n",
+                            fichero, c->k, c->procesos, c->hilos, res.t_total, res.t_calculo,
+                            res.t_comunicacion, res.t_escritura, t_reparto, t_carga, res.mape);
+                    fflush(csv);
+                }
+                free(datos_locales);
+                free(inicios);
+                MPI_Comm_free(&comm);
+            }
+            esperar_resto();
+        }
+        free(datos_globales);
+    }
+
+    if (csv) fclose(csv);
+    free(configs);
+}
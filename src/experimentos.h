@@ -0,0 +1,26 @@
+#ifndef EXPERIMENTOS_H
+#define EXPERIMENTOS_H
+
+#include "opciones.h"
+
+// Matriz de experimentos en un solo lanzamiento (--experimentos=FICHERO).
+// En lugar de un mpirun por configuración, se lanza una vez con el máximo de procesos y cada
+// configuración se ejecuta sobre un subcomunicador (MPI_Comm_split) con sus hilos
+// (omp_set_num_threads). Cada dataset se lee una sola vez, en el Master, y se reparte de
+// nuevo en cada configuración; la inicialización de MPI y la carga quedan amortizadas.
+//
+// Formato del fichero (una línea por grupo de configuraciones, '#' inicia un comentario):
+//   <ficheros> <K> <procesos> <hilos>
+// Cada campo admite listas separadas por comas y los numéricos también rangos, p.ej.
+//   datos_1X.txt,datos_10X.txt  12  1-4  1,2,4
+// genera el producto cartesiano (2 x 1 x 4 x 3 = 24 configuraciones).
+//
+// Resultados: una fila por configuración en experimentos.csv (ver scripts/plot_results.py)
+// y la línea habitual en Tiempo.txt.
+
+#define EXPERIMENTOS_CSV "experimentos.csv"
+
+// Colectiva sobre MPI_COMM_WORLD. 'opciones' se aplican a todas las configuraciones.
+void ejecutar_experimentos(OpcionesPrediccion *opciones, int pid, int prn);
+
+#endif
@@ -0,0 +1,240 @@
+/*
+ * src/indice_vp.c
+ * Índice VP-tree para búsquedas k-NN exactas con corte causal e inserción incremental.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <float.h>
+#include <limits.h>
+#include <mpi.h>
+#include <omp.h>
+#include "indice_vp.h"
+#include "distancia.h"
+
+// Por debajo de este tamaño no compensa crear una tarea OpenMP para el subárbol
+#define VP_UMBRAL_TAREA 4096
+
+struct NodoVP {
+    int vp;                  // Fila local del punto de referencia (-1 en las hojas)
+    float radio;             // Mediana de las distancias al punto de referencia
+    int min_fila;            // Menor fila local del subárbol (corte causal)
+    NodoVP *dentro;          // Filas con distancia <= radio
+    NodoVP *fuera;           // Filas con distancia >= radio
+    int *filas;              // Solo hojas
+    int cuenta;
+    int capacidad;
+};
+
+// Distancia (sin elevar) y fila, para particionar por la mediana
+typedef struct {
+    float d;
+    int fila;
+} ParVP;
+
+static void* reservar(size_t bytes) {
+    void *p = malloc(bytes);
+    if (p == NULL) {
+        fprintf(stderr, "[ERROR] Sin memoria para el índice VP (%zu bytes)\n", bytes);
+        MPI_Abort(MPI_COMM_WORLD, EXIT_FAILURE);
+    }
+    return p;
+}
+
+static inline const float* fila_ptr(const ArbolVP *a, int fila) {
+    return &a->datos[(long)fila * a->stride];
+}
+
+static inline float distancia_vp(const ArbolVP *a, int fila, const float *patron) {
+    return sqrtf(calcular_distancia_sq(fila_ptr(a, fila), patron, a->columnas));
+}
+
+// Deja en pares[m] el elemento que iría ahí si se ordenara por d (quickselect)
+static void seleccionar_mediana(ParVP *pares, int n, int m) {
+    int lo = 0, hi = n - 1;
+    while (lo < hi) {
+        float pivote = pares[lo + (hi - lo) / 2].d;
+        int i = lo, j = hi;
+        while (i <= j) {
+            while (pares[i].d < pivote) i++;
+            while (pares[j].d > pivote) j--;
+            if (i <= j) {
+                ParVP tmp = pares[i];
+                pares[i] = pares[j];
+                pares[j] = tmp;
+                i++;
+                j--;
+            }
+        }
+        if (m <= j) hi = j;
+        else if (m >= i) lo = i;
+        else return;
+    }
+}
+
+static NodoVP* crear_hoja(const ParVP *pares, int n, int capacidad) {
+    NodoVP *nodo = (NodoVP *)reservar(sizeof(NodoVP));
+    memset(nodo, 0, sizeof(NodoVP));
+    nodo->vp = -1;
+    nodo->capacidad = capacidad;
+    nodo->filas = (int *)reservar(capacidad * sizeof(int));
+    nodo->min_fila = INT_MAX;
+    for (int i = 0; i < n; i++) {
+        nodo->filas[i] = pares[i].fila;
+        if (pares[i].fila < nodo->min_fila) nodo->min_fila = pares[i].fila;
+    }
+    nodo->cuenta = n;
+    return nodo;
+}
+
+// Construye el subárbol de 'pares' (se reordena in situ). n > 0.
+static NodoVP* construir_nodo(const ArbolVP *a, ParVP *pares, int n) {
+    if (n <= VP_TAM_HOJA) return crear_hoja(pares, n, 2 * VP_TAM_HOJA);
+
+    // Punto de referencia: la fila central del rango (las filas llegan en orden temporal)
+    ParVP tmp = pares[0];
+    pares[0] = pares[n / 2];
+    pares[n / 2] = tmp;
+
+    NodoVP *nodo = (NodoVP *)reservar(sizeof(NodoVP));
+    memset(nodo, 0, sizeof(NodoVP));
+    nodo->vp = pares[0].fila;
+
+    const float *referencia = fila_ptr(a, nodo->vp);
+    ParVP *resto = &pares[1];
+    int n_resto = n - 1;
+    for (int i = 0; i < n_resto; i++) resto[i].d = distancia_vp(a, resto[i].fila, referencia);
+
+    // Mitad cercana [0, m) con d <= radio, mitad lejana [m, n_resto) con d >= radio
+    int m = n_resto / 2;
+    seleccionar_mediana(resto, n_resto, m);
+    nodo->radio = resto[m].d;
+
+    NodoVP *dentro = NULL, *fuera = NULL;
+    #pragma omp task shared(dentro) if(m > VP_UMBRAL_TAREA)
+    dentro = (m > 0) ? construir_nodo(a, resto, m) : NULL;
+    fuera = construir_nodo(a, &resto[m], n_resto - m);
+    #pragma omp taskwait
+
+    nodo->dentro = dentro;
+    nodo->fuera = fuera;
+    nodo->min_fila = nodo->vp;
+    if (dentro && dentro->min_fila < nodo->min_fila) nodo->min_fila = dentro->min_fila;
+    if (fuera->min_fila < nodo->min_fila) nodo->min_fila = fuera->min_fila;
+    return nodo;
+}
+
+ArbolVP* vp_construir(const float *datos, int stride, int columnas, int offset_global,
+                      const int *filas, int num_filas) {
+    ArbolVP *a = (ArbolVP *)reservar(sizeof(ArbolVP));
+    a->datos = datos;
+    a->stride = stride;
+    a->columnas = columnas;
+    a->offset_global = offset_global;
+    a->num_filas = num_filas;
+    a->raiz = NULL;
+    if (num_filas == 0) return a;
+
+    ParVP *pares = (ParVP *)reservar(num_filas * sizeof(ParVP));
+    for (int i = 0; i < num_filas; i++) pares[i].fila = filas[i];
+    a->raiz = construir_nodo(a, pares, num_filas);
+    free(pares);
+    return a;
+}
+
+void vp_insertar(ArbolVP *a, int fila) {
+    a->num_filas++;
+    if (a->raiz == NULL) {
+        ParVP par = {0.0f, fila};
+        a->raiz = crear_hoja(&par, 1, 2 * VP_TAM_HOJA);
+        return;
+    }
+
+    // Bajar por el lado que corresponda a la fila, igual que en la construcción
+    const float *v = fila_ptr(a, fila);
+    NodoVP *nodo = a->raiz;
+    while (1) {
+        if (fila < nodo->min_fila) nodo->min_fila = fila;
+        if (nodo->vp < 0) break;
+        float d = distancia_vp(a, nodo->vp, v);
+        NodoVP **hijo = (d <= nodo->radio) ? &nodo->dentro : &nodo->fuera;
+        if (*hijo == NULL) {
+            ParVP par = {0.0f, fila};
+            *hijo = crear_hoja(&par, 1, 2 * VP_TAM_HOJA);
+            return;
+        }
+        nodo = *hijo;
+    }
+
+    nodo->filas[nodo->cuenta++] = fila;
+    if (nodo->cuenta < nodo->capacidad) return;
+
+    // Hoja llena: se sustituye por un subárbol construido con sus filas
+    ParVP *pares = (ParVP *)reservar(nodo->cuenta * sizeof(ParVP));
+    for (int i = 0; i < nodo->cuenta; i++) pares[i].fila = nodo->filas[i];
+    NodoVP *nuevo = construir_nodo(a, pares, nodo->cuenta);
+    free(pares);
+    free(nodo->filas);
+    *nodo = *nuevo;
+    free(nuevo);
+}
+
+static void buscar_nodo(const ArbolVP *a, const NodoVP *nodo, const float *patron, int corte,
+                        VecinoInterno *lista, int k, ContadoresVP *c) {
+    if (nodo == NULL || nodo->min_fila >= corte) return;
+    c->nodos_visitados++;
+
+    if (nodo->vp < 0) {
+        for (int i = 0; i < nodo->cuenta; i++) {
+            int fila = nodo->filas[i];
+            if (fila >= corte) continue;
+            float dist = calcular_distancia_sq(fila_ptr(a, fila), patron, a->columnas);
+            c->distancias++;
+            insertar_vecino_ordenado(lista, k, a->offset_global + fila, dist);
+        }
+        return;
+    }
+
+    float dist_sq = calcular_distancia_sq(fila_ptr(a, nodo->vp), patron, a->columnas);
+    c->distancias++;
+    if (nodo->vp < corte) insertar_vecino_ordenado(lista, k, a->offset_global + nodo->vp, dist_sq);
+
+    // Primero el lado donde cae el patrón; el otro solo si la desigualdad triangular
+    // no garantiza que todas sus filas están más lejos que el K-ésimo actual
+    float d = sqrtf(dist_sq);
+    int cerca_dentro = (d <= nodo->radio);
+    buscar_nodo(a, cerca_dentro ? nodo->dentro : nodo->fuera, patron, corte, lista, k, c);
+
+    if (lista[k-1].dist_sq == FLT_MAX) {
+        buscar_nodo(a, cerca_dentro ? nodo->fuera : nodo->dentro, patron, corte, lista, k, c);
+        return;
+    }
+    float tau = sqrtf(lista[k-1].dist_sq);
+    float cota = cerca_dentro ? (nodo->radio - d) : (d - nodo->radio);
+    float holgura = VP_MARGEN * (d + nodo->radio + tau);
+    if (cota - holgura <= tau) {
+        buscar_nodo(a, cerca_dentro ? nodo->fuera : nodo->dentro, patron, corte, lista, k, c);
+    }
+}
+
+void vp_buscar(const ArbolVP *a, const float *patron, int corte_global,
+               VecinoInterno *lista, int k, ContadoresVP *contadores) {
+    contadores->consultas++;
+    buscar_nodo(a, a->raiz, patron, corte_global - a->offset_global, lista, k, contadores);
+}
+
+static void liberar_nodo(NodoVP *nodo) {
+    if (nodo == NULL) return;
+    liberar_nodo(nodo->dentro);
+    liberar_nodo(nodo->fuera);
+    free(nodo->filas);
+    free(nodo);
+}
+
+void vp_liberar(ArbolVP *a) {
+    if (a == NULL) return;
+    liberar_nodo(a->raiz);
+    free(a);
+}
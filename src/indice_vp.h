@@ -0,0 +1,50 @@
+#ifndef INDICE_VP_H
+#define INDICE_VP_H
+
+#include "vecinos.h"
+
+// Árbol de puntos de referencia (VP-tree) sobre filas locales para búsquedas k-NN exactas.
+// Cada nodo interno separa las filas por la mediana de su distancia a un punto de referencia;
+// las hojas guardan hasta VP_TAM_HOJA filas que se recorren por fuerza bruta.
+// Cada nodo guarda además la menor fila de su subárbol, así una consulta causal
+// (solo filas anteriores a un corte) salta los subárboles que quedan enteros en el futuro.
+//
+// Las distancias son las de calcular_distancia_sq, de modo que los vecinos encontrados
+// tienen exactamente la misma distancia que en el recorrido de fuerza bruta.
+
+#define VP_TAM_HOJA 32
+#define VP_MARGEN 1e-4f   // Holgura relativa de la desigualdad triangular frente al redondeo float
+
+typedef struct NodoVP NodoVP;
+
+typedef struct {
+    const float *datos;     // Filas locales (no se copian)
+    int stride;
+    int columnas;
+    int offset_global;      // Índice global de la fila local 0
+    NodoVP *raiz;
+    int num_filas;          // Filas indexadas
+} ArbolVP;
+
+typedef struct {
+    long consultas;
+    long nodos_visitados;
+    long distancias;        // Distancias completas calculadas
+    long candidatas;        // Filas que habría recorrido la fuerza bruta (lo rellena quien consulta)
+} ContadoresVP;
+
+// Construye el árbol con las filas locales filas[0..num_filas-1]. Los subárboles grandes
+// se construyen como tareas OpenMP si se llama dentro de una región paralela.
+ArbolVP* vp_construir(const float *datos, int stride, int columnas, int offset_global,
+                      const int *filas, int num_filas);
+
+// Añade la fila local 'fila' sin reconstruir (las hojas que crecen demasiado se dividen)
+void vp_insertar(ArbolVP *arbol, int fila);
+
+// Mejora 'lista' (K vecinos ordenados) con las filas del árbol de índice global < corte_global
+void vp_buscar(const ArbolVP *arbol, const float *patron, int corte_global,
+               VecinoInterno *lista, int k, ContadoresVP *contadores);
+
+void vp_liberar(ArbolVP *arbol);
+
+#endif
@@ -8,227 +8,1466 @@
 #include <stdlib.h>
 #include <math.h>
 #include <float.h>
+#include <string.h>
 #include <mpi.h>
 #include <omp.h>
 #include "k_nn.h"
+#include "salida.h"
+#include "utils.h"
+#include "distancia.h"
+#include "poda.h"
+#include "indice_vp.h"
+#include "lsh.h"
+#include "traza.h"
+#include "continuo.h"
+#include "compacto.h"
 
 #define MASTERPID 0
+#define PESO_EPSILON 1e-6f   // Evita dividir por 0 si un vecino coincide con el patrón
+#define BLOQUE_COMPACTO 64   // Filas compactas por llamada al kernel
 
-// Función para comparar vecinos (necesaria para el qsort final de los pocos candidatos)
-int comparar_vecinos(const void *a, const void *b) {
-    float distA = ((VecinoInterno *)a)->dist_sq;
-    float distB = ((VecinoInterno *)b)->dist_sq;
-    if (distA < distB) return -1;
-    if (distA > distB) return 1;
-    return 0;
+// Estado compartido por los distintos modos de ejecución (día a día o por lotes)
+typedef struct {
+    float *datos_locales;   // Filas propias seguidas del halo
+    int mis_filas;          // Filas candidatas (las propias)
+    int columnas;
+    int stride;             // Floats por fila en datos_locales (columnas + relleno SIMD)
+    int k;
+    int num_procs;
+    int pid;
+    MPI_Comm comm;          // Procesos que participan (MPI_COMM_WORLD salvo en --experimentos)
+    const int *inicios;     // Reparto de filas entre procesos (num_procs + 1 entradas)
+    int total_filas;
+    int mi_offset_global;
+    int num_predicciones;
+    int inicio_evaluacion;
+    const OpcionesPrediccion *opciones;
+
+    // Cotas inferiores de las filas locales (NULL si no se usa --poda)
+    ResumenPoda *poda;
+    ContadoresPoda contadores;
+
+    // Un VP-tree por hilo sobre su tramo de filas locales (NULL si no se usa --indice)
+    ArbolVP **arboles;
+    int num_arboles;
+    int filas_tramos;       // Filas locales repartidas entre los árboles (las que llegan en modo continuo van al último)
+    int *siguiente_fila;    // Por árbol: primera fila local de su tramo aún sin indexar
+    ContadoresVP contadores_vp;
+    double t_construccion;
+    double t_consulta;
+
+    // Copia de 16 bits de las filas locales para el recorrido lineal (NULL si no se usa
+    // --compacto) y, por hilo, la lista de candidatos aproximados que se reordenan en float32
+    DatosCompactos *compacto;
+    VecinoInterno *candidatos_compacto;
+    long separacion_compacto;
+    int k_compacto;
+    EstrategiaTopK estrategia_compacto;
+    long reordenadas_compacto;  // Distancias float32 recalculadas
+    long respaldos_compacto;    // Hilos y días en que la lista no bastó y se repitió el recorrido
+
+    // Modo aproximado (NULL si no se usa --lsh): se busca con LSH y además con el camino
+    // exacto para medir el recall y el cambio de MAPE en la misma ejecución
+    IndiceLSH *lsh;
+    int *marcas_lsh;        // max_hilos * mis_filas, ver lsh_buscar()
+    long lsh_evaluadas;
+    double t_lsh;
+    double t_construccion_lsh;
+
+    // Solo Master
+    float *prediccion;
+    EscritorResultados *escritor;
+
+    // Selección de los K mejores en el recorrido lineal (ver SeleccionTopK) y entradas
+    // que necesita cada lista de hilo con esa estrategia
+    EstrategiaTopK estrategia_topk;
+    int capacidad_topk;
+
+    // Tipo MPI de una lista de K vecinos y la operación que fusiona dos listas
+    TiposVecinos tipos;
+
+    // Solo Master con --lsh: comparación con la búsqueda exacta
+    double mape_exacto;
+    long aciertos_lsh;      // Vecinos aproximados que están entre los K exactos
+    int dias_sin_candidatos;
+
+    // Solo Master con --barrido: MAPE acumulado para cada k = 1..K con los mismos vecinos
+    double *mape_por_k;
+    float *suma_barrido;
+
+    // Acumuladores de resultados y profiling
+    double mape_acumulado;
+    double t_calculo;
+    double t_comunicacion;
+
+    // Solo --segmentado: comunicaciones esperadas y cuántas ya habían terminado (latencia oculta)
+    long peticiones[2];
+    double t_escritura;
+
+    // Solo Master con --continuo: latencia de cada petición y días cuya predicción ya se evaluó
+    LatenciasContinuo latencias;
+    int dias_evaluados;
+} ContextoPrediccion;
+
+// Rellena una lista de K vecinos con "distancia infinita"
+static void inicializar_lista(VecinoInterno *lista, int k) {
+    for (int j = 0; j < k; j++) {
+        lista[j].dist_sq = FLT_MAX;
+        lista[j].indice_dia = -1;
+    }
 }
 
-// Cálculo de distancia euclídea al cuadrado (evitamos sqrt para optimizar)
-float calcular_distancia_sq(float *v1, float *v2, int cols) {
-    float suma = 0.0f;
-    // El compilador vectorizará esto automáticamente con las flags -O3 -march=native
-    for (int i = 0; i < cols; i++) {
-        float diff = v1[i] - v2[i];
-        suma += diff * diff;
+// Cascada de poda para una fila candidata: cota de normas, cota PAA y distancia con
+// abandono temprano contra el K-ésimo mejor del hilo. Solo inserta si sobrevive.
+static inline void evaluar_fila_podada(const ResumenPoda *poda, long i, const ResumenPatron *rp,
+                                       const float *fila, const float *patron, int columnas,
+                                       SeleccionTopK *seleccion, int indice_global, ContadoresPoda *c) {
+    float umbral = topk_umbral(seleccion);
+    c->evaluadas++;
+    if (poda_cota_norma(poda, i, rp) > umbral) {
+        c->podadas_norma++;
+        return;
     }
-    return suma;
+    if (poda_cota_paa(poda, i, rp) > umbral) {
+        c->podadas_paa++;
+        return;
+    }
+    float dist = calcular_distancia_sq_acotada(fila, patron, columnas, umbral);
+    if (dist >= umbral) {
+        c->podadas_exacta++;
+        return;
+    }
+    c->aceptadas++;
+    topk_insertar(seleccion, indice_global, dist);
 }
 
-// Función auxiliar para mantener la lista de los K mejores vecinos ordenada.
-// Desplaza elementos solo si encontramos un vecino mejor que el peor de nuestra lista.
-void insertar_vecino_ordenado(VecinoInterno *lista, int k, int indice_global, float distancia) {
-    // Si la distancia es peor (mayor) que el último de la lista, no hacemos nada
-    if (distancia >= lista[k-1].dist_sq) return;
+static void sumar_contadores_vp(ContadoresVP *total, const ContadoresVP *parcial) {
+    total->consultas += parcial->consultas;
+    total->nodos_visitados += parcial->nodos_visitados;
+    total->distancias += parcial->distancias;
+    total->candidatas += parcial->candidatas;
+}
 
-    // Inserción ordenada (de atrás hacia adelante)
-    int i = k - 2;
-    while (i >= 0 && lista[i].dist_sq > distancia) {
-        lista[i+1] = lista[i]; // Desplazar a la derecha
-        i--;
+// Tramo [inicio, fin) de filas locales que cubre el árbol t
+static void tramo_arbol(const ContextoPrediccion *ctx, int t, int *inicio, int *fin) {
+    *inicio = (int)((long)t * ctx->filas_tramos / ctx->num_arboles);
+    *fin = (t == ctx->num_arboles - 1) ? ctx->mis_filas : (int)((long)(t + 1) * ctx->filas_tramos / ctx->num_arboles);
+}
+
+// Construye en paralelo los árboles con las filas locales de índice global < corte_global.
+// El resto se añade después con actualizar_arbol() según avanzan los días.
+static void construir_indice(ContextoPrediccion *ctx, int corte_global) {
+    ctx->num_arboles = omp_get_max_threads();
+    ctx->filas_tramos = ctx->mis_filas;
+    ctx->arboles = (ArbolVP **)calloc(ctx->num_arboles, sizeof(ArbolVP *));
+    ctx->siguiente_fila = (int *)malloc(ctx->num_arboles * sizeof(int));
+    int *filas = (int *)malloc((ctx->mis_filas > 0 ? ctx->mis_filas : 1) * sizeof(int));
+    if (ctx->arboles == NULL || ctx->siguiente_fila == NULL || filas == NULL) {
+        fprintf(stderr, "[ERROR P%d] Sin memoria para el índice\n", ctx->pid);
+        MPI_Abort(MPI_COMM_WORLD, EXIT_FAILURE);
     }
-    // Insertar el nuevo vecino
-    lista[i+1].indice_dia = indice_global;
-    lista[i+1].dist_sq = distancia;
+    for (int i = 0; i < ctx->mis_filas; i++) filas[i] = i;
+
+    double t_inicio = MPI_Wtime();
+    #pragma omp parallel for schedule(dynamic, 1)
+    for (int t = 0; t < ctx->num_arboles; t++) {
+        int inicio, fin;
+        tramo_arbol(ctx, t, &inicio, &fin);
+        int corte = corte_global - ctx->mi_offset_global;
+        if (fin > corte) fin = (corte > inicio) ? corte : inicio;
+        ctx->arboles[t] = vp_construir(ctx->datos_locales, ctx->stride, ctx->columnas, ctx->mi_offset_global,
+                                       &filas[inicio], fin - inicio);
+        ctx->siguiente_fila[t] = fin;
+    }
+    ctx->t_construccion = MPI_Wtime() - t_inicio;
+    free(filas);
 }
 
-void ejecutar_predicciones(float *datos_locales, int mis_filas, int columnas, int k, 
-                           int num_procs, int pid, float *datos_globales, int total_filas,
-                           const char* nombre_fichero, double t_lectura, double t_scatter) {
-    
-    // Configuración del número de predicciones (últimas 1000 filas o menos si el fichero es pequeño)
-    int num_predicciones = 1000;
-    if (total_filas < num_predicciones + 24) {
-        num_predicciones = (total_filas > 50) ? 50 : 1;
-        if(pid == MASTERPID) printf("[AVISO] Fichero pequeño. Reduciendo predicciones a %d\n", num_predicciones);
+// Inserta en el árbol t las filas de su tramo con índice global < corte_global
+static void actualizar_arbol(ContextoPrediccion *ctx, int t, int corte_global) {
+    int inicio, fin;
+    tramo_arbol(ctx, t, &inicio, &fin);
+    int corte = corte_global - ctx->mi_offset_global;
+    if (fin > corte) fin = corte;
+    while (ctx->siguiente_fila[t] < fin) vp_insertar(ctx->arboles[t], ctx->siguiente_fila[t]++);
+}
+
+// Filas del árbol t que cumplen el corte causal (las que recorrería la fuerza bruta)
+static long candidatas_arbol(const ContextoPrediccion *ctx, int t, int corte_global) {
+    int inicio, fin;
+    tramo_arbol(ctx, t, &inicio, &fin);
+    int corte = corte_global - ctx->mi_offset_global;
+    if (corte < inicio) return 0;
+    return (corte < fin ? corte : fin) - inicio;
+}
+
+// MAPE (%) de una predicción frente a los valores reales del día
+static float mape_dia(const float *valores_reales, const float *prediccion, int columnas) {
+    float error_dia = 0.0f;
+    for (int h = 0; h < columnas; h++) {
+        float real = valores_reales[h];
+        if (fabs(real) > 1e-5) {
+            error_dia += fabs(real - prediccion[h]) / fabs(real);
+        }
     }
+    error_dia = (error_dia / columnas) * 100.0f;
+    return error_dia;
+}
 
-    // --- RESERVA DE MEMORIA ---
-    float *patron_objetivo = (float *)malloc(columnas * sizeof(float));
-    float *valores_reales  = (float *)malloc(columnas * sizeof(float));
-    
-    // Buffer para guardar los K mejores de ESTE proceso (resultado de combinar hilos)
-    VecinoInterno *mis_top_k = (VecinoInterno *)malloc(k * sizeof(VecinoInterno));
-    
-    // Buffer para que el Maestro recolecte los K mejores de TODOS los procesos
-    VecinoInterno *todos_candidatos = NULL;
-    float *prediccion = NULL;
-    
-    if (pid == MASTERPID) {
-        todos_candidatos = (VecinoInterno *)malloc(num_procs * k * sizeof(VecinoInterno));
-        prediccion = (float *)calloc(columnas, sizeof(float));
-        
-        // Limpiar ficheros de salida
-        FILE *fp;
-        fp = fopen("Predicciones.txt", "w"); if(fp) fclose(fp);
-        fp = fopen("MAPE.txt", "w"); if(fp) fclose(fp);
+// Bloque de filas de un día: para cada vecino de las listas (en su orden) la fila del día
+// SIGUIENTE, y al final la fila real del día. Cada proceso rellena solo lo que tiene en memoria
+// (los siguientes de sus candidatos, gracias al halo, y la fila real si es suya) y deja el resto
+// a 0: cada hueco tiene un único aportador, así que la suma MPI reconstruye el bloque exacto.
+static void aportar_filas_dia(const ContextoPrediccion *ctx, const VecinoInterno *listas, int num_vecinos,
+                              int dia_idx, float *bloque) {
+    int columnas = ctx->columnas;
+    for (long i = 0; i < (long)(num_vecinos + 1) * columnas; i++) bloque[i] = 0.0f;
+
+    for (int v = 0; v < num_vecinos; v++) {
+        int local = listas[v].indice_dia - ctx->mi_offset_global;
+        if (listas[v].indice_dia < 0 || local < 0 || local >= ctx->mis_filas) continue;
+        const float *siguiente = &ctx->datos_locales[(long)(local + 1) * ctx->stride];
+        for (int h = 0; h < columnas; h++) bloque[(long)v * columnas + h] = siguiente[h];
     }
 
-    // Preparar buffers para OpenMP
-    int max_hilos = omp_get_max_threads();
-    // Matriz temporal donde cada hilo dejará sus K mejores candidatos
-    VecinoInterno *buffer_hilos = (VecinoInterno *)malloc(max_hilos * k * sizeof(VecinoInterno));
+    // En modo continuo el día predicho aún no existe
+    if (dia_idx < ctx->total_filas && propietario_fila(dia_idx, ctx->inicios, ctx->num_procs) == ctx->pid) {
+        const float *real = &ctx->datos_locales[(long)(dia_idx - ctx->mi_offset_global) * ctx->stride];
+        for (int h = 0; h < columnas; h++) bloque[(long)num_vecinos * columnas + h] = real[h];
+    }
+}
 
-    double mape_acumulado = 0.0;
-    double tiempo_inicio = 0.0, tiempo_fin;
+// Peso de un vecino en la predicción ponderada: inverso de su distancia euclídea
+static inline float peso_vecino(float dist_sq) {
+    return 1.0f / (sqrtf(dist_sq) + PESO_EPSILON);
+}
 
-    // Variables de profiling
-    double t_acum_calculo = 0.0;      
-    double t_acum_comunicacion = 0.0; 
-    double t_temp_start;              
+// MASTER: con las filas siguientes a los K vecinos de un día (en su orden), deja en
+// 'prediccion' su media (o, con --ponderar, su media ponderada por el inverso de la distancia)
+static void calcular_prediccion(const ContextoPrediccion *ctx, const VecinoInterno *candidatos,
+                                const float *filas_vecinos, float *prediccion) {
+    int k = ctx->k;
+    int columnas = ctx->columnas;
 
-    if (pid == MASTERPID) tiempo_inicio = MPI_Wtime();
+    // Calcular predicción (media de los K mejores)
+    for (int h = 0; h < columnas; h++) prediccion[h] = 0.0f;
 
-    int inicio_evaluacion = total_filas - num_predicciones;
+    if (ctx->opciones->ponderar_distancia) {
+        float suma_pesos = 0.0f;
+        for (int v = 0; v < k; v++) {
+            float peso = peso_vecino(candidatos[v].dist_sq);
+            suma_pesos += peso;
+            for (int h = 0; h < columnas; h++) prediccion[h] += peso * filas_vecinos[(long)v * columnas + h];
+        }
+        for (int h = 0; h < columnas; h++) prediccion[h] /= suma_pesos;
+        return;
+    }
 
-    // --- BUCLE PRINCIPAL DE PREDICCIONES ---
-    for (int dia_idx = inicio_evaluacion; dia_idx < total_filas; dia_idx++) {
+    for (int v = 0; v < k; v++) {
+        for (int h = 0; h < columnas; h++) {
+            prediccion[h] += filas_vecinos[(long)v * columnas + h];
+        }
+    }
+    for (int h = 0; h < columnas; h++) prediccion[h] /= k;
+}
+
+// MASTER: predicción del día (ver calcular_prediccion) y su MAPE
+static float predecir_dia(ContextoPrediccion *ctx, const VecinoInterno *candidatos, const float *filas_vecinos,
+                          const float *valores_reales, float *prediccion) {
+    calcular_prediccion(ctx, candidatos, filas_vecinos, prediccion);
+    return mape_dia(valores_reales, prediccion, ctx->columnas);
+}
+
+// MASTER con --barrido: los vecinos ya están ordenados; la predicción con k vecinos es la suma
+// prefija de los k primeros días siguientes entre k, así que un solo recorrido da el MAPE de
+// todos los k <= K (con las mismas operaciones que predecir_dia para cada k)
+static void acumular_barrido(ContextoPrediccion *ctx, const VecinoInterno *candidatos, const float *filas_vecinos,
+                             const float *valores_reales) {
+    int columnas = ctx->columnas;
+    float *suma = ctx->suma_barrido;
+    float *prediccion = ctx->prediccion;
+
+    for (int h = 0; h < columnas; h++) suma[h] = 0.0f;
+    if (ctx->opciones->ponderar_distancia) {
+        // Igual con pesos: suma prefija de peso * fila y de los pesos
+        float suma_pesos = 0.0f;
+        for (int v = 0; v < ctx->k; v++) {
+            float peso = peso_vecino(candidatos[v].dist_sq);
+            suma_pesos += peso;
+            for (int h = 0; h < columnas; h++) suma[h] += peso * filas_vecinos[(long)v * columnas + h];
+            for (int h = 0; h < columnas; h++) prediccion[h] = suma[h] / suma_pesos;
+            ctx->mape_por_k[v] += mape_dia(valores_reales, prediccion, columnas);
+        }
+        return;
+    }
+    for (int v = 0; v < ctx->k; v++) {
+        for (int h = 0; h < columnas; h++) suma[h] += filas_vecinos[(long)v * columnas + h];
+
+        int k_actual = v + 1;
+        for (int h = 0; h < columnas; h++) prediccion[h] = suma[h] / k_actual;
+        ctx->mape_por_k[v] += mape_dia(valores_reales, prediccion, columnas);
+    }
+}
+
+// MASTER: predicción del día con el bloque de filas de sus K vecinos globales (ya ordenados
+// por la reducción); acumula el MAPE y la encola para el escritor
+static void procesar_dia_master(ContextoPrediccion *ctx, const VecinoInterno *candidatos, const float *bloque) {
+    float *prediccion = ctx->prediccion;
+    const float *valores_reales = &bloque[(long)ctx->k * ctx->columnas];
 
-        // 1. Maestro prepara el patrón
-        if (pid == MASTERPID) {
-            int idx_patron = (dia_idx - 1) * columnas;
-            int idx_real = dia_idx * columnas;
-            for(int j=0; j<columnas; j++) {
-                patron_objetivo[j] = datos_globales[idx_patron + j];
-                valores_reales[j] = datos_globales[idx_real + j];
+    if (ctx->mape_por_k) acumular_barrido(ctx, candidatos, bloque, valores_reales);
+    float error_dia = predecir_dia(ctx, candidatos, bloque, valores_reales, prediccion);
+    ctx->mape_acumulado += error_dia;
+
+    // Encolar para el hilo escritor (solo copia a memoria)
+    double t_esc = MPI_Wtime();
+    if (ctx->escritor) escritor_encolar(ctx->escritor, prediccion, error_dia);
+    ctx->t_escritura += MPI_Wtime() - t_esc;
+}
+
+// MASTER con --lsh: la predicción publicada es la de los vecinos aproximados; los exactos solo
+// sirven para medir el recall@K y el MAPE de referencia. Si entre todos los procesos la búsqueda
+// aproximada no reúne K candidatos, ese día se usa la lista exacta.
+// El bloque lleva las filas de los K exactos, las de los K aproximados y la fila real.
+static void procesar_dia_lsh(ContextoPrediccion *ctx, const VecinoInterno *exactos, const VecinoInterno *aproximados,
+                             const float *bloque) {
+    int k = ctx->k;
+    float *prediccion = ctx->prediccion;
+    const float *valores_reales = &bloque[2L * k * ctx->columnas];
+
+    ctx->mape_exacto += predecir_dia(ctx, exactos, bloque, valores_reales, prediccion);
+    for (int v = 0; v < k; v++) {
+        if (aproximados[v].dist_sq == FLT_MAX) continue;
+        for (int e = 0; e < k; e++) {
+            if (exactos[e].indice_dia == aproximados[v].indice_dia) {
+                ctx->aciertos_lsh++;
+                break;
             }
         }
+    }
+
+    // Vecinos publicados: los aproximados o, si faltan, los exactos
+    const VecinoInterno *publicados = exactos;
+    const float *filas_publicadas = bloque;
+    if (aproximados[k-1].dist_sq == FLT_MAX) ctx->dias_sin_candidatos++;
+    else {
+        publicados = aproximados;
+        filas_publicadas = &bloque[(long)k * ctx->columnas];
+    }
+    if (ctx->mape_por_k) acumular_barrido(ctx, publicados, filas_publicadas, valores_reales);
+    float error_dia = predecir_dia(ctx, publicados, filas_publicadas, valores_reales, prediccion);
+    ctx->mape_acumulado += error_dia;
+
+    double t_esc = MPI_Wtime();
+    if (ctx->escritor) escritor_encolar(ctx->escritor, prediccion, error_dia);
+    ctx->t_escritura += MPI_Wtime() - t_esc;
+}
+
+// Copia en 'patron' la fila del día anterior a 'dia_idx' si es de este proceso.
+// Devuelve el proceso dueño de esa fila (la raíz de la difusión).
+static int preparar_patron(const ContextoPrediccion *ctx, int dia_idx, float *patron) {
+    int raiz_patron = propietario_fila(dia_idx - 1, ctx->inicios, ctx->num_procs);
+    if (ctx->pid == raiz_patron) {
+        long idx_patron = (long)(dia_idx - 1 - ctx->mi_offset_global) * ctx->stride;
+        for (int j = 0; j < ctx->columnas; j++) patron[j] = ctx->datos_locales[idx_patron + j];
+    }
+    return raiz_patron;
+}
+
+// Separación entre las listas de dos hilos en buffer_hilos: K redondeado a una línea de caché,
+// así los hilos no escriben en la misma línea al insertar (falso compartido)
+static long separacion_listas_hilos(int k) {
+    long por_linea = 64 / sizeof(VecinoInterno);
+    return (k + por_linea - 1) / por_linea * por_linea;
+}
+
+// Distancias aproximadas de las filas locales [primera, fin) por bloques. Sin 'exacta', cada
+// fila va a 'aproximada'; con ella, las que no superan 'umbral' se recalculan en float32 y van a
+// 'exacta'. Devuelve cuántas se recalcularon.
+static long recorrer_bloques_compactos(const ContextoPrediccion *ctx, const float *patron_objetivo, int primera, int fin,
+                                       SeleccionTopK *aproximada, SeleccionTopK *exacta, double umbral) {
+    float distancias[BLOQUE_COMPACTO];
+    long reordenadas = 0;
+    for (int i = primera; i < fin; i += BLOQUE_COMPACTO) {
+        int num = (fin - i < BLOQUE_COMPACTO) ? fin - i : BLOQUE_COMPACTO;
+        compacto_distancias(ctx->compacto, i, num, patron_objetivo, distancias);
+        for (int b = 0; b < num; b++) {
+            if (exacta == NULL) {
+                topk_insertar(aproximada, ctx->mi_offset_global + i + b, distancias[b]);
+            } else if ((double)distancias[b] <= umbral) {
+                topk_insertar(exacta, ctx->mi_offset_global + i + b,
+                              calcular_distancia_sq(&ctx->datos_locales[(long)(i + b) * ctx->stride], patron_objetivo,
+                                                    ctx->columnas));
+                reordenadas++;
+            }
+        }
+    }
+    return reordenadas;
+}
+
+// Recorrido compacto de un hilo: su tramo de filas es el de 'omp for schedule(static)' (el del
+// primer toque), recortado por el corte causal. Se guardan los K' mejores por distancia
+// aproximada y se recalculan en float32 los que no superan el umbral de compacto_umbral(). Si
+// la lista se llena sin pasar del umbral puede haber filas fuera de ella que lo cumplan: se
+// repite el recorrido compacto recalculando todas las que no lo superan (respaldo).
+static void recorrer_compacto_hilo(ContextoPrediccion *ctx, const float *patron_objetivo, int dia_idx,
+                                   SeleccionTopK *seleccion, long *recorridas) {
+    int num_hilos = omp_get_num_threads(), tid = omp_get_thread_num();
+    int por_hilo = ctx->mis_filas / num_hilos, resto = ctx->mis_filas % num_hilos;
+    int primera = tid * por_hilo + (tid < resto ? tid : resto);
+    int fin = primera + por_hilo + (tid < resto ? 1 : 0);
+    int corte = dia_idx - 1 - ctx->mi_offset_global;
+    if (fin > corte) fin = corte;
+    if (primera >= fin) return;
+
+    SeleccionTopK aproximada;
+    topk_iniciar(&aproximada, &ctx->candidatos_compacto[tid * ctx->separacion_compacto], ctx->k_compacto,
+                 ctx->estrategia_compacto);
+    recorrer_bloques_compactos(ctx, patron_objetivo, primera, fin, &aproximada, NULL, 0.0);
+    topk_finalizar(&aproximada);
+    *recorridas += fin - primera;
+
+    int k = ctx->k, k_compacto = ctx->k_compacto;
+    const VecinoInterno *lista = aproximada.datos;
+    int usados = 0;
+    while (usados < k_compacto && lista[usados].indice_dia >= 0) usados++;
+    double umbral = (usados < k) ? HUGE_VAL : compacto_umbral(ctx->compacto, lista[k - 1].dist_sq);
+
+    // La lista basta si tiene todas las filas o si su último candidato ya supera el umbral
+    long reordenadas = 0;
+    if (usados == fin - primera || (usados == k_compacto && (double)lista[k_compacto - 1].dist_sq > umbral)) {
+        for (int c = 0; c < usados && (double)lista[c].dist_sq <= umbral; c++) {
+            int i = lista[c].indice_dia - ctx->mi_offset_global;
+            topk_insertar(seleccion, lista[c].indice_dia,
+                          calcular_distancia_sq(&ctx->datos_locales[(long)i * ctx->stride], patron_objetivo, ctx->columnas));
+            reordenadas++;
+        }
+    } else {
+        reordenadas = recorrer_bloques_compactos(ctx, patron_objetivo, primera, fin, NULL, seleccion, umbral);
+        #pragma omp atomic
+        ctx->respaldos_compacto++;
+    }
+    #pragma omp atomic
+    ctx->reordenadas_compacto += reordenadas;
+}
+
+// Parte de la búsqueda de un día que hace cada hilo: se llama DENTRO de una región paralela
+// (los 'omp for' se reparten entre el equipo que la ejecuta) y deja en 'mi_lista_hilo' los
+// K mejores de las filas o árboles que le tocan (ordenados; el buffer del hilo necesita
+// ctx->capacidad_topk entradas). Los contadores se acumulan en los del hilo.
+static void buscar_dia_hilo(ContextoPrediccion *ctx, const float *patron_objetivo, const ResumenPatron *resumen_patron,
+                            int dia_idx, VecinoInterno *mi_lista_hilo, ContadoresPoda *contadores_hilo,
+                            ContadoresVP *contadores_vp) {
+    int k = ctx->k;
+    int columnas = ctx->columnas;
+    int stride = ctx->stride;
+    int mi_offset_global = ctx->mi_offset_global;
+    const float *datos_locales = ctx->datos_locales;
+    const ResumenPoda *poda = ctx->poda;
+
+    // Con índice no hay recorrido lineal: cada hilo consulta su árbol. Con la copia compacta
+    // el recorrido lo hace recorrer_compacto_hilo.
+    int filas_recorrido = (ctx->arboles || ctx->compacto) ? 0 : ctx->mis_filas;
+
+    // Lista del hilo a "distancia infinita". Los árboles insertan en ella directamente,
+    // así que con índice es siempre un array ordenado.
+    SeleccionTopK seleccion;
+    topk_iniciar(&seleccion, mi_lista_hilo, k, ctx->arboles ? TOPK_ORDENADO : ctx->estrategia_topk);
+    double t_traza = traza_ahora();
+    long recorridas = 0;
+
+    if (ctx->compacto) recorrer_compacto_hilo(ctx, patron_objetivo, dia_idx, &seleccion, &recorridas);
+
+    if (ctx->arboles) {
+        // Cada árbol recibe las filas que ya son pasado y se consulta con el corte causal
+        #pragma omp for schedule(static, 1) nowait
+        for (int t = 0; t < ctx->num_arboles; t++) {
+            actualizar_arbol(ctx, t, dia_idx - 1);
+            vp_buscar(ctx->arboles[t], patron_objetivo, dia_idx - 1, mi_lista_hilo, k, contadores_vp);
+            contadores_vp->candidatas += candidatas_arbol(ctx, t, dia_idx - 1);
+        }
+    }
+
+    // Reparto estático del trabajo (el mismo que usó el primer toque de datos_locales)
+    #pragma omp for schedule(static) nowait
+    for (int i = 0; i < filas_recorrido; i++) {
+        int indice_global_fila = mi_offset_global + i;
+
+        // Solo miramos al pasado (evitar mirar el futuro o el mismo día)
+        if (indice_global_fila < dia_idx - 1) {
+            recorridas++;
+            if (poda) {
+                evaluar_fila_podada(poda, i, resumen_patron, &datos_locales[(long)i * stride], patron_objetivo,
+                                    columnas, &seleccion, indice_global_fila, contadores_hilo);
+                continue;
+            }
+            float dist = calcular_distancia_sq(&datos_locales[(long)i * stride], patron_objetivo, columnas);
+
+            // Intentar insertar en la lista de los mejores de este hilo
+            topk_insertar(&seleccion, indice_global_fila, dist);
+        }
+    }
+    topk_finalizar(&seleccion);
+    traza_registrar(TRAZA_RECORRIDO, t_traza);
+    traza_contar(TRAZA_FILAS_RECORRIDAS, recorridas);
+    traza_contar(TRAZA_CANDIDATOS_INSERTADOS, seleccion.insertados);
+}
+
+// Búsqueda aproximada del patrón del día en mis_top_k[k..2k) (la hace el hilo maestro)
+static void buscar_dia_lsh(ContextoPrediccion *ctx, const float *patron_objetivo, int dia_idx, VecinoInterno *mis_top_k) {
+    int k = ctx->k;
+    double t_temp_start = MPI_Wtime();
+    inicializar_lista(&mis_top_k[k], k);
+    ctx->lsh_evaluadas += lsh_buscar(ctx->lsh, patron_objetivo, dia_idx - 1, &mis_top_k[k], k,
+                                     ctx->marcas_lsh, dia_idx);
+    ctx->t_lsh += (MPI_Wtime() - t_temp_start);
+}
+
+// Búsqueda local de un día: región paralela sobre las filas (o los árboles) y fusión de las
+// listas de los hilos en 'mis_top_k'. Con --lsh la lista aproximada va en mis_top_k[k..2k).
+static void buscar_dia(ContextoPrediccion *ctx, const float *patron_objetivo, int dia_idx,
+                       VecinoInterno *buffer_hilos, VecinoInterno *mis_top_k) {
+    int k = ctx->k;
+    int max_hilos = omp_get_max_threads();
+    long separacion = separacion_listas_hilos(ctx->capacidad_topk);
+    ResumenPatron resumen_patron;
+
+    double t_temp_start = MPI_Wtime();
+    if (ctx->poda) poda_resumir_patron(ctx->poda, patron_objetivo, &resumen_patron);
+
+    // Región paralela OpenMP
+    #pragma omp parallel
+    {
+        ContadoresPoda contadores_hilo = {0};
+        ContadoresVP contadores_vp = {0};
+        buscar_dia_hilo(ctx, patron_objetivo, &resumen_patron, dia_idx,
+                        &buffer_hilos[omp_get_thread_num() * separacion], &contadores_hilo, &contadores_vp);
+
+        if (ctx->arboles) {
+            #pragma omp critical
+            sumar_contadores_vp(&ctx->contadores_vp, &contadores_vp);
+        }
+        if (ctx->poda) {
+            #pragma omp critical
+            poda_sumar_contadores(&ctx->contadores, &contadores_hilo);
+        }
+    } // Fin parallel
+
+    // Reducción local: Unificar los resultados de los hilos en 'mis_top_k'
+    double t_traza = traza_ahora();
+    fusionar_listas_hilos(buffer_hilos, max_hilos, separacion, k, mis_top_k);
+    traza_registrar(TRAZA_FUSION_HILOS, t_traza);
+    ctx->t_calculo += (MPI_Wtime() - t_temp_start);
+    if (ctx->arboles) ctx->t_consulta += (MPI_Wtime() - t_temp_start);
+
+    if (ctx->lsh) buscar_dia_lsh(ctx, patron_objetivo, dia_idx, mis_top_k);
+}
+
+// MASTER: predicción de un día a partir de sus listas globales y su bloque de filas
+static void procesar_dia(ContextoPrediccion *ctx, const VecinoInterno *mejores, const float *bloque) {
+    double t_traza = traza_ahora();
+    if (ctx->lsh) procesar_dia_lsh(ctx, mejores, &mejores[ctx->k], bloque);
+    else procesar_dia_master(ctx, mejores, bloque);
+    traza_registrar(TRAZA_PREDICCION, t_traza);
+}
+
+// Modo clásico: un Bcast, una región paralela y una reducción de top-K por cada día evaluado.
+// Ningún proceso tiene la matriz completa: el patrón lo difunde el dueño de su fila y las
+// filas que necesita el Master para predecir le llegan en una reducción aparte.
+static void bucle_por_dias(ContextoPrediccion *ctx) {
+    int k = ctx->k;
+    int columnas = ctx->columnas;
+
+    // Patrón alineado y con el relleno a 0, igual que las filas locales
+    float *patron_objetivo = reservar_filas_alineadas(1, ctx->stride);
+
+    // Buffer para guardar los K mejores de ESTE proceso (resultado de combinar hilos).
+    // Con --lsh le sigue la lista de la búsqueda aproximada y se reducen juntas.
+    int num_listas = ctx->lsh ? 2 : 1;
+    VecinoInterno *mis_top_k = (VecinoInterno *)malloc(num_listas * k * sizeof(VecinoInterno));
+
+    // K mejores globales (ya fusionados y ordenados): todos los procesos los necesitan
+    // para saber qué filas siguientes aportar
+    VecinoInterno *mejores = (VecinoInterno *)malloc(num_listas * k * sizeof(VecinoInterno));
+
+    // Bloque de filas del día (ver aportar_filas_dia) y su suma en el Master
+    long tam_bloque = (long)(num_listas * k + 1) * columnas;
+    float *mi_bloque = (float *)malloc(tam_bloque * sizeof(float));
+    float *bloque = NULL;
+    if (ctx->pid == MASTERPID) bloque = (float *)malloc(tam_bloque * sizeof(float));
+    if (mis_top_k == NULL || mejores == NULL || mi_bloque == NULL || (ctx->pid == MASTERPID && bloque == NULL)) {
+        fprintf(stderr, "[ERROR P%d] Sin memoria para las listas de vecinos\n", ctx->pid);
+        MPI_Abort(MPI_COMM_WORLD, EXIT_FAILURE);
+    }
+
+    // Preparar buffers para OpenMP
+    int max_hilos = omp_get_max_threads();
+    // Matriz temporal donde cada hilo dejará sus K mejores candidatos
+    VecinoInterno *buffer_hilos = (VecinoInterno *)malloc(max_hilos * separacion_listas_hilos(ctx->capacidad_topk) * sizeof(VecinoInterno));
+
+    double t_temp_start;
+
+    // --- BUCLE PRINCIPAL DE PREDICCIONES ---
+    for (int dia_idx = ctx->inicio_evaluacion; dia_idx < ctx->total_filas; dia_idx++) {
+
+        // 1. El dueño de la fila del día anterior prepara el patrón
+        int raiz_patron = preparar_patron(ctx, dia_idx, patron_objetivo);
 
         // 2. Difundir patrón (Comunicaciones)
         t_temp_start = MPI_Wtime();
-        MPI_Bcast(patron_objetivo, columnas, MPI_FLOAT, MASTERPID, MPI_COMM_WORLD);
-        t_acum_comunicacion += (MPI_Wtime() - t_temp_start);
+        double t_traza = traza_ahora();
+        MPI_Bcast(patron_objetivo, columnas, MPI_FLOAT, raiz_patron, ctx->comm);
+        traza_registrar(TRAZA_DIFUSION, t_traza);
+        ctx->t_comunicacion += (MPI_Wtime() - t_temp_start);
 
         // 3. CÁLCULO PARALELO LOCAL (Optimizado)
+        buscar_dia(ctx, patron_objetivo, dia_idx, buffer_hilos, mis_top_k);
+
+        // 4. REDUCCIÓN DE LOS TOP-K (Comunicaciones)
+        // Cada paso fusiona dos listas ordenadas: K vecinos por mensaje
         t_temp_start = MPI_Wtime();
-        int mi_offset_global = pid * (total_filas / num_procs); 
+        t_traza = traza_ahora();
+        MPI_Allreduce(mis_top_k, mejores, num_listas, ctx->tipos.tipo_lista, ctx->tipos.op_fusion, ctx->comm);
+        traza_registrar(TRAZA_REDUCCION_TOPK, t_traza);
 
-        // Región paralela OpenMP
-        #pragma omp parallel
-        {
-            int tid = omp_get_thread_num();
-            // Puntero al trozo de buffer de este hilo
-            VecinoInterno *mi_lista_hilo = &buffer_hilos[tid * k];
-
-            // Inicializar la lista del hilo con "distancia infinita"
-            for(int j=0; j<k; j++) {
-                mi_lista_hilo[j].dist_sq = FLT_MAX;
-                mi_lista_hilo[j].indice_dia = -1;
-            }
-
-            // Reparto estático del trabajo
-            #pragma omp for schedule(static) nowait
-            for (int i = 0; i < mis_filas; i++) {
-                int indice_global_fila = mi_offset_global + i;
-
-                // Solo miramos al pasado (evitar mirar el futuro o el mismo día)
-                if (indice_global_fila < dia_idx - 1) {
-                    float dist = calcular_distancia_sq(&datos_locales[i * columnas], patron_objetivo, columnas);
-                    
-                    // Intentar insertar en la lista de los mejores de este hilo
-                    insertar_vecino_ordenado(mi_lista_hilo, k, indice_global_fila, dist);
-                }
+        // 5. Cada proceso aporta las filas que tiene y el Master recibe el bloque completo
+        t_traza = traza_ahora();
+        aportar_filas_dia(ctx, mejores, num_listas * k, dia_idx, mi_bloque);
+        MPI_Reduce(mi_bloque, bloque, (int)tam_bloque, MPI_FLOAT, MPI_SUM, MASTERPID, ctx->comm);
+        traza_registrar(TRAZA_REUNION_FILAS, t_traza);
+        ctx->t_comunicacion += (MPI_Wtime() - t_temp_start);
+
+        // 6. MASTER PREDICE
+        if (ctx->pid == MASTERPID) procesar_dia(ctx, mejores, bloque);
+    }
+
+    free(patron_objetivo);
+    free(mis_top_k);
+    free(buffer_hilos);
+    free(mejores);
+    free(mi_bloque);
+    free(bloque);
+}
+
+// Modo persistente (--persistente): una sola región paralela para todo el bucle de días.
+// El hilo maestro (el único que llama a MPI, MPI_THREAD_FUNNELED) prepara y difunde el patrón,
+// fusiona las listas y hace las comunicaciones y la predicción; el resto del equipo solo se
+// sincroniza con dos barreras por día: se evita abrir y cerrar un equipo de hilos por día.
+static void bucle_persistente(ContextoPrediccion *ctx) {
+    int k = ctx->k;
+    int columnas = ctx->columnas;
+    int num_listas = ctx->lsh ? 2 : 1;
+    long tam_bloque = (long)(num_listas * k + 1) * columnas;
+    int max_hilos = omp_get_max_threads();
+    long separacion = separacion_listas_hilos(ctx->capacidad_topk);
+
+    float *patron_objetivo = reservar_filas_alineadas(1, ctx->stride);
+    VecinoInterno *mis_top_k = (VecinoInterno *)malloc(num_listas * k * sizeof(VecinoInterno));
+    VecinoInterno *mejores = (VecinoInterno *)malloc(num_listas * k * sizeof(VecinoInterno));
+    VecinoInterno *buffer_hilos = (VecinoInterno *)malloc(max_hilos * separacion * sizeof(VecinoInterno));
+    float *mi_bloque = (float *)malloc(tam_bloque * sizeof(float));
+    float *bloque = NULL;
+    if (ctx->pid == MASTERPID) bloque = (float *)malloc(tam_bloque * sizeof(float));
+    if (patron_objetivo == NULL || mis_top_k == NULL || mejores == NULL || buffer_hilos == NULL ||
+        mi_bloque == NULL || (ctx->pid == MASTERPID && bloque == NULL)) {
+        fprintf(stderr, "[ERROR P%d] Sin memoria para el modo persistente\n", ctx->pid);
+        MPI_Abort(MPI_COMM_WORLD, EXIT_FAILURE);
+    }
+    ResumenPatron resumen_patron;
+    double t_calculo_inicio = 0.0;
+
+    #pragma omp parallel
+    {
+        int tid = omp_get_thread_num();
+        ContadoresPoda contadores_hilo = {0};
+        ContadoresVP contadores_vp = {0};
+
+        for (int dia_idx = ctx->inicio_evaluacion; dia_idx < ctx->total_filas; dia_idx++) {
+            // 1. Maestro: patrón del día (difundido por el dueño de la fila) y su resumen
+            #pragma omp master
+            {
+                int raiz_patron = preparar_patron(ctx, dia_idx, patron_objetivo);
+                double t_temp_start = MPI_Wtime();
+                double t_traza = traza_ahora();
+                MPI_Bcast(patron_objetivo, columnas, MPI_FLOAT, raiz_patron, ctx->comm);
+                traza_registrar(TRAZA_DIFUSION, t_traza);
+                ctx->t_comunicacion += (MPI_Wtime() - t_temp_start);
+                t_calculo_inicio = MPI_Wtime();
+                if (ctx->poda) poda_resumir_patron(ctx->poda, patron_objetivo, &resumen_patron);
             }
-        } // Fin parallel
+            #pragma omp barrier
+
+            // 2. Todo el equipo: búsqueda local
+            buscar_dia_hilo(ctx, patron_objetivo, &resumen_patron, dia_idx, &buffer_hilos[tid * separacion],
+                            &contadores_hilo, &contadores_vp);
+            #pragma omp barrier
+
+            // 3. Maestro: fusión, comunicaciones y predicción. Los demás hilos esperan en la
+            //    barrera del día siguiente, antes de reiniciar sus listas.
+            #pragma omp master
+            {
+                double t_traza = traza_ahora();
+                fusionar_listas_hilos(buffer_hilos, max_hilos, separacion, k, mis_top_k);
+                traza_registrar(TRAZA_FUSION_HILOS, t_traza);
+                ctx->t_calculo += (MPI_Wtime() - t_calculo_inicio);
+                if (ctx->arboles) ctx->t_consulta += (MPI_Wtime() - t_calculo_inicio);
+                if (ctx->lsh) buscar_dia_lsh(ctx, patron_objetivo, dia_idx, mis_top_k);
+
+                double t_temp_start = MPI_Wtime();
+                t_traza = traza_ahora();
+                MPI_Allreduce(mis_top_k, mejores, num_listas, ctx->tipos.tipo_lista, ctx->tipos.op_fusion,
+                              ctx->comm);
+                traza_registrar(TRAZA_REDUCCION_TOPK, t_traza);
+                t_traza = traza_ahora();
+                aportar_filas_dia(ctx, mejores, num_listas * k, dia_idx, mi_bloque);
+                MPI_Reduce(mi_bloque, bloque, (int)tam_bloque, MPI_FLOAT, MPI_SUM, MASTERPID, ctx->comm);
+                traza_registrar(TRAZA_REUNION_FILAS, t_traza);
+                ctx->t_comunicacion += (MPI_Wtime() - t_temp_start);
+
+                if (ctx->pid == MASTERPID) procesar_dia(ctx, mejores, bloque);
+            }
+        }
+
+        if (ctx->arboles) {
+            #pragma omp critical
+            sumar_contadores_vp(&ctx->contadores_vp, &contadores_vp);
+        }
+        if (ctx->poda) {
+            #pragma omp critical
+            poda_sumar_contadores(&ctx->contadores, &contadores_hilo);
+        }
+    } // Fin parallel
+
+    free(patron_objetivo);
+    free(mis_top_k);
+    free(mejores);
+    free(buffer_hilos);
+    free(mi_bloque);
+    free(bloque);
+}
+
+// Espera una petición no bloqueante. En T_Comm solo cuenta la espera (latencia no oculta).
+// Si al llegar aquí ya había terminado, su latencia quedó oculta tras el cálculo.
+// En la traza la espera cuenta en el 'ambito' de la comunicación.
+static void esperar_peticion(ContextoPrediccion *ctx, MPI_Request *peticion, AmbitoTraza ambito) {
+    if (*peticion == MPI_REQUEST_NULL) return;
+    double t_espera = MPI_Wtime();
+    double t_traza = traza_ahora();
+    int terminada = 0;
+    MPI_Test(peticion, &terminada, MPI_STATUS_IGNORE);
+    if (!terminada) MPI_Wait(peticion, MPI_STATUS_IGNORE);
+    traza_registrar(ambito, t_traza);
+    ctx->t_comunicacion += MPI_Wtime() - t_espera;
+    ctx->peticiones[0]++;
+    if (terminada) ctx->peticiones[1]++;
+}
+
+// Prepara el patrón del día 'dia_idx' en su buffer (dia % 2) y lanza su difusión
+static void lanzar_patron(const ContextoPrediccion *ctx, int dia_idx, float **patrones, MPI_Request *peticiones) {
+    int b = dia_idx % 2;
+    int raiz_patron = preparar_patron(ctx, dia_idx, patrones[b]);
+    MPI_Ibcast(patrones[b], ctx->columnas, MPI_FLOAT, raiz_patron, ctx->comm, &peticiones[b]);
+}
+
+// Modo segmentado (--segmentado): el mismo cálculo que bucle_por_dias, pero las tres
+// comunicaciones de cada día son no bloqueantes y van desfasadas con doble buffer:
+//   - el patrón del día d+1 viaja (MPI_Ibcast) mientras se busca el día d;
+//   - la fusión de top-K del día d (MPI_Iallreduce) avanza mientras se busca el día d+1;
+//   - el bloque de filas del día d-1 (MPI_Ireduce) llega al Master mientras se busca el día d,
+//     y el Master predice el día d-2 con su bloque ya recibido.
+// Las predicciones son idénticas; solo cambia cuándo se espera a cada comunicación.
+static void bucle_segmentado(ContextoPrediccion *ctx) {
+    int k = ctx->k;
+    int columnas = ctx->columnas;
+    int inicio = ctx->inicio_evaluacion;
+    int fin = ctx->total_filas;
+    int num_listas = ctx->lsh ? 2 : 1;
+    int tam_listas = num_listas * k;
+    long tam_bloque = (long)(tam_listas + 1) * columnas;
+    int max_hilos = omp_get_max_threads();
+
+    // Doble buffer de cada etapa: índice = día % 2. Las listas globales se usan hasta la
+    // predicción (dos días después de lanzarse su fusión), así que llevan tres: día % 3.
+    float *patrones[2];
+    VecinoInterno *mis_top_k[2], *mejores[3];
+    float *mi_bloque[2], *bloque[2] = {NULL, NULL};
+    for (int b = 0; b < 3; b++) {
+        mejores[b] = (VecinoInterno *)malloc(tam_listas * sizeof(VecinoInterno));
+        if (mejores[b] == NULL) {
+            fprintf(stderr, "[ERROR P%d] Sin memoria para el modo segmentado\n", ctx->pid);
+            MPI_Abort(MPI_COMM_WORLD, EXIT_FAILURE);
+        }
+    }
+    for (int b = 0; b < 2; b++) {
+        patrones[b] = reservar_filas_alineadas(1, ctx->stride);
+        mis_top_k[b] = (VecinoInterno *)malloc(tam_listas * sizeof(VecinoInterno));
+        mi_bloque[b] = (float *)malloc(tam_bloque * sizeof(float));
+        if (ctx->pid == MASTERPID) bloque[b] = (float *)malloc(tam_bloque * sizeof(float));
+        if (patrones[b] == NULL || mis_top_k[b] == NULL || mi_bloque[b] == NULL ||
+            (ctx->pid == MASTERPID && bloque[b] == NULL)) {
+            fprintf(stderr, "[ERROR P%d] Sin memoria para el modo segmentado\n", ctx->pid);
+            MPI_Abort(MPI_COMM_WORLD, EXIT_FAILURE);
+        }
+    }
+    VecinoInterno *buffer_hilos = (VecinoInterno *)malloc(max_hilos * separacion_listas_hilos(ctx->capacidad_topk) * sizeof(VecinoInterno));
+
+    MPI_Request pet_patron[2] = {MPI_REQUEST_NULL, MPI_REQUEST_NULL};
+    MPI_Request pet_top_k[2] = {MPI_REQUEST_NULL, MPI_REQUEST_NULL};
+    MPI_Request pet_bloque[2] = {MPI_REQUEST_NULL, MPI_REQUEST_NULL};
+
+    lanzar_patron(ctx, inicio, patrones, pet_patron);
+
+    // Una iteración de más por cada etapa que va por detrás (fusión d-1, predicción d-2)
+    for (int dia_idx = inicio; dia_idx < fin + 2; dia_idx++) {
+        int b = dia_idx % 2;
+
+        // 1. Patrón del día d recibido; el del día d+1 sale ya
+        if (dia_idx < fin) {
+            esperar_peticion(ctx, &pet_patron[b], TRAZA_DIFUSION);
+            if (dia_idx + 1 < fin) lanzar_patron(ctx, dia_idx + 1, patrones, pet_patron);
+
+            // 2. Búsqueda local del día d y fusión global en segundo plano
+            buscar_dia(ctx, patrones[b], dia_idx, buffer_hilos, mis_top_k[b]);
+            MPI_Iallreduce(mis_top_k[b], mejores[dia_idx % 3], num_listas, ctx->tipos.tipo_lista, ctx->tipos.op_fusion,
+                           ctx->comm, &pet_top_k[b]);
+        }
+
+        // 3. Vecinos del día d-1 ya fusionados: cada proceso aporta sus filas al Master
+        int d1 = dia_idx - 1;
+        if (d1 >= inicio && d1 < fin) {
+            int b1 = d1 % 2;
+            esperar_peticion(ctx, &pet_top_k[b1], TRAZA_REDUCCION_TOPK);
+            aportar_filas_dia(ctx, mejores[d1 % 3], tam_listas, d1, mi_bloque[b1]);
+            MPI_Ireduce(mi_bloque[b1], bloque[b1], (int)tam_bloque, MPI_FLOAT, MPI_SUM, MASTERPID,
+                        ctx->comm, &pet_bloque[b1]);
+        }
 
-        // Reducción local: Unificar los resultados de los hilos en 'mis_top_k'
-        // Copiamos los candidatos del hilo 0 como base
-        for(int j=0; j<k; j++) {
-            mis_top_k[j] = buffer_hilos[0 * k + j];
+        // 4. Bloque del día d-2 completo: el Master predice mientras los demás siguen
+        int d2 = dia_idx - 2;
+        if (d2 >= inicio) {
+            int b2 = d2 % 2;
+            esperar_peticion(ctx, &pet_bloque[b2], TRAZA_REUNION_FILAS);
+            if (ctx->pid == MASTERPID) procesar_dia(ctx, mejores[d2 % 3], bloque[b2]);
         }
+    }
+
+    for (int b = 0; b < 2; b++) {
+        free(patrones[b]);
+        free(mis_top_k[b]);
+        free(mi_bloque[b]);
+        free(bloque[b]);
+    }
+    for (int b = 0; b < 3; b++) free(mejores[b]);
+    free(buffer_hilos);
+}
+
+// Modo por lotes: todos los patrones se difunden de una vez, cada proceso recorre sus filas
+// una sola vez contra el bloque completo de consultas y todos sus top-K se fusionan en un único MPI_Allreduce.
+// La consulta q corresponde al día (inicio_evaluacion + q) y su patrón es la fila anterior.
+static void bucle_lote(ContextoPrediccion *ctx) {
+    int k = ctx->k;
+    int columnas = ctx->columnas;
+    int stride = ctx->stride;
+    int mis_filas = ctx->mis_filas;
+    int mi_offset_global = ctx->mi_offset_global;
+    int num_consultas = ctx->num_predicciones;
+    int inicio = ctx->inicio_evaluacion;
+    float *datos_locales = ctx->datos_locales;
+    long tam_listas = (long)num_consultas * k;
+
+    // Patrones con el mismo stride y relleno que las filas locales
+    float *patrones = reservar_filas_alineadas(num_consultas, stride);
+    VecinoInterno *mis_top_k = (VecinoInterno *)malloc(tam_listas * sizeof(VecinoInterno));
+    VecinoInterno *mejores = (VecinoInterno *)malloc(tam_listas * sizeof(VecinoInterno));
+
+    // Cada hilo tiene una selección de K por consulta (con los árboles, arrays ordenados)
+    int max_hilos = omp_get_max_threads();
+    EstrategiaTopK estrategia = ctx->arboles ? TOPK_ORDENADO : ctx->estrategia_topk;
+    int capacidad = topk_capacidad(estrategia, k);
+    long separacion = separacion_listas_hilos(num_consultas * capacidad);
+    VecinoInterno *buffer_hilos = (VecinoInterno *)malloc(max_hilos * separacion * sizeof(VecinoInterno));
+    // Distancias de una fila contra todas las consultas (una tira por hilo)
+    float *dist_hilos = (float *)malloc((long)max_hilos * num_consultas * sizeof(float));
+    if (patrones == NULL || mis_top_k == NULL || mejores == NULL || buffer_hilos == NULL || dist_hilos == NULL) {
+        fprintf(stderr, "[ERROR] Sin memoria para el modo por lotes (%d consultas)\n", num_consultas);
+        MPI_Abort(MPI_COMM_WORLD, EXIT_FAILURE);
+    }
 
-        // Fusionamos con los de los demás hilos
-        for(int t=1; t<max_hilos; t++) {
-            VecinoInterno *lista_hilo = &buffer_hilos[t * k];
-            for(int j=0; j<k; j++) {
-                // Si el candidato es válido, intentamos insertarlo en la lista final del proceso
-                if(lista_hilo[j].dist_sq < FLT_MAX) {
-                    insertar_vecino_ordenado(mis_top_k, k, lista_hilo[j].indice_dia, lista_hilo[j].dist_sq);
+    // 1. Cada proceso pone los patrones de sus filas (filas inicio-1 .. total_filas-2) y deja el resto a 0
+    float *mis_patrones = reservar_filas_alineadas(num_consultas, stride);
+    if (mis_patrones == NULL) {
+        fprintf(stderr, "[ERROR] Sin memoria para el modo por lotes (%d consultas)\n", num_consultas);
+        MPI_Abort(MPI_COMM_WORLD, EXIT_FAILURE);
+    }
+    for (int q = 0; q < num_consultas; q++) {
+        int fila = inicio - 1 + q;
+        if (propietario_fila(fila, ctx->inicios, ctx->num_procs) != ctx->pid) continue;
+        long idx_patron = (long)(fila - mi_offset_global) * stride;
+        for (int j = 0; j < columnas; j++) mis_patrones[(long)q * stride + j] = datos_locales[idx_patron + j];
+    }
+
+    // 2. Una única reducción reúne el bloque de consultas en todos los procesos
+    double t_temp_start = MPI_Wtime();
+    double t_traza = traza_ahora();
+    MPI_Allreduce(mis_patrones, patrones, num_consultas * stride, MPI_FLOAT, MPI_SUM, ctx->comm);
+    traza_registrar(TRAZA_DIFUSION, t_traza);
+    ctx->t_comunicacion += (MPI_Wtime() - t_temp_start);
+    free(mis_patrones);
+
+    // 3. Una sola pasada por los datos locales contra todas las consultas
+    t_temp_start = MPI_Wtime();
+
+    // Con --poda cada consulta lleva su propio resumen y la fila se compara una a una
+    const ResumenPoda *poda = ctx->poda;
+    ResumenPatron *resumenes = NULL;
+    if (poda) {
+        resumenes = (ResumenPatron *)malloc(num_consultas * sizeof(ResumenPatron));
+        if (resumenes == NULL) {
+            fprintf(stderr, "[ERROR] Sin memoria para el modo por lotes (%d consultas)\n", num_consultas);
+            MPI_Abort(MPI_COMM_WORLD, EXIT_FAILURE);
+        }
+        #pragma omp parallel for schedule(static)
+        for (int q = 0; q < num_consultas; q++) poda_resumir_patron(poda, &patrones[(long)q * stride], &resumenes[q]);
+    }
+
+    int filas_recorrido = ctx->arboles ? 0 : mis_filas;
+    #pragma omp parallel
+    {
+        int tid = omp_get_thread_num();
+        VecinoInterno *listas_hilo = &buffer_hilos[tid * separacion];
+        float *dist = &dist_hilos[(long)tid * num_consultas];
+        ContadoresPoda contadores_hilo = {0};
+        SeleccionTopK *selecciones = (SeleccionTopK *)malloc(num_consultas * sizeof(SeleccionTopK));
+        if (selecciones == NULL) {
+            fprintf(stderr, "[ERROR] Sin memoria para el modo por lotes (%d consultas)\n", num_consultas);
+            MPI_Abort(MPI_COMM_WORLD, EXIT_FAILURE);
+        }
+        for (int q = 0; q < num_consultas; q++) topk_iniciar(&selecciones[q], &listas_hilo[(long)q * capacidad], k, estrategia);
+        double t_traza_hilo = traza_ahora();
+        long recorridas = 0;
+
+        if (ctx->arboles) {
+            // Árboles completos: cada consulta aplica su propio corte causal
+            ContadoresVP contadores_vp = {0};
+            #pragma omp for schedule(static, 1) nowait
+            for (int t = 0; t < ctx->num_arboles; t++) {
+                for (int q = 0; q < num_consultas; q++) {
+                    vp_buscar(ctx->arboles[t], &patrones[(long)q * stride], inicio + q - 1,
+                              &listas_hilo[(long)q * capacidad], k, &contadores_vp);
+                    contadores_vp.candidatas += candidatas_arbol(ctx, t, inicio + q - 1);
                 }
             }
+            #pragma omp critical
+            sumar_contadores_vp(&ctx->contadores_vp, &contadores_vp);
         }
-        t_acum_calculo += (MPI_Wtime() - t_temp_start); 
 
-        // 4. RECOLECCIÓN EN MASTER (Comunicaciones)
-        t_temp_start = MPI_Wtime();
-        // Cada proceso envía sus K mejores
-        MPI_Gather(mis_top_k, k * sizeof(VecinoInterno), MPI_BYTE,
-                   todos_candidatos, k * sizeof(VecinoInterno), MPI_BYTE,
-                   MASTERPID, MPI_COMM_WORLD);
-        t_acum_comunicacion += (MPI_Wtime() - t_temp_start);
-
-        // 5. MASTER PROCESA Y PREDICE
-        if (pid == MASTERPID) {
-            // Ordenar los (P * K) candidatos recibidos para quedarse con los K absolutos
-            qsort(todos_candidatos, num_procs * k, sizeof(VecinoInterno), comparar_vecinos);
-
-            // Calcular predicción (media de los K mejores)
-            for(int h=0; h<columnas; h++) prediccion[h] = 0.0f;
-            
-            for (int v = 0; v < k; v++) {
-                int dia_vecino = todos_candidatos[v].indice_dia;
-                // Ojo: Recuperamos el día SIGUIENTE al vecino
-                int idx_global_vecino_next = (dia_vecino + 1) * columnas;
-                for (int h = 0; h < columnas; h++) {
-                    prediccion[h] += datos_globales[idx_global_vecino_next + h];
+        #pragma omp for schedule(static) nowait
+        for (int i = 0; i < filas_recorrido; i++) {
+            int indice_global_fila = mi_offset_global + i;
+            const float *fila = &datos_locales[(long)i * stride];
+
+            // Corte causal: la fila solo es candidata para los días con indice_global_fila < dia_idx - 1,
+            // es decir, para las consultas q >= indice_global_fila - inicio + 2
+            int q_min = indice_global_fila - inicio + 2;
+            if (q_min < 0) q_min = 0;
+            if (q_min >= num_consultas) continue;
+            recorridas += num_consultas - q_min;
+
+            if (poda) {
+                for (int q = q_min; q < num_consultas; q++) {
+                    evaluar_fila_podada(poda, i, &resumenes[q], fila, &patrones[(long)q * stride], columnas,
+                                        &selecciones[q], indice_global_fila, &contadores_hilo);
                 }
+                continue;
             }
-            for (int h = 0; h < columnas; h++) prediccion[h] /= k;
 
-            // Calcular MAPE del día
-            float error_dia = 0.0f;
-            for (int h = 0; h < columnas; h++) {
-                float real = valores_reales[h];
-                if (fabs(real) > 1e-5) {
-                    error_dia += fabs(real - prediccion[h]) / fabs(real);
-                }
+            // La fila se carga una vez y se compara con todas sus consultas
+            calcular_distancias_multi(fila, &patrones[(long)q_min * stride], num_consultas - q_min, stride, columnas, dist);
+            for (int q = q_min; q < num_consultas; q++) {
+                topk_insertar(&selecciones[q], indice_global_fila, dist[q - q_min]);
             }
-            error_dia = (error_dia / columnas) * 100.0f;
-            mape_acumulado += error_dia;
+        }
+        long insertados = 0;
+        for (int q = 0; q < num_consultas; q++) {
+            topk_finalizar(&selecciones[q]);
+            insertados += selecciones[q].insertados;
+        }
+        free(selecciones);
+        traza_registrar(TRAZA_RECORRIDO, t_traza_hilo);
+        traza_contar(TRAZA_FILAS_RECORRIDAS, recorridas);
+        traza_contar(TRAZA_CANDIDATOS_INSERTADOS, insertados);
 
-            // Guardar en fichero (append)
-            FILE *f_pred = fopen("Predicciones.txt", "a");
-            if(f_pred) { 
-                for(int h=0; h<columnas; h++) fprintf(f_pred, "%.2f ", prediccion[h]); 
-                fprintf(f_pred, "\n"); 
-                fclose(f_pred); 
+        if (poda) {
+            #pragma omp critical
+            poda_sumar_contadores(&ctx->contadores, &contadores_hilo);
+        }
+    }
+    free(resumenes);
+
+    // Reducción local por consulta
+    t_traza = traza_ahora();
+    #pragma omp parallel for schedule(static)
+    for (int q = 0; q < num_consultas; q++) {
+        fusionar_listas_hilos(&buffer_hilos[(long)q * capacidad], max_hilos, separacion, k, &mis_top_k[(long)q * k]);
+    }
+    traza_registrar(TRAZA_FUSION_HILOS, t_traza);
+    ctx->t_calculo += (MPI_Wtime() - t_temp_start);
+    if (ctx->arboles) ctx->t_consulta += (MPI_Wtime() - t_temp_start);
+
+    // 3b. Búsqueda aproximada: las consultas se reparten entre hilos, cada uno con sus marcas
+    VecinoInterno *mis_top_k_aprox = NULL;
+    VecinoInterno *mejores_aprox = NULL;
+    if (ctx->lsh) {
+        mis_top_k_aprox = (VecinoInterno *)malloc(tam_listas * sizeof(VecinoInterno));
+        mejores_aprox = (VecinoInterno *)malloc(tam_listas * sizeof(VecinoInterno));
+        if (mis_top_k_aprox == NULL || mejores_aprox == NULL) {
+            fprintf(stderr, "[ERROR] Sin memoria para el modo por lotes (%d consultas)\n", num_consultas);
+            MPI_Abort(MPI_COMM_WORLD, EXIT_FAILURE);
+        }
+
+        t_temp_start = MPI_Wtime();
+        long evaluadas = 0;
+        #pragma omp parallel reduction(+:evaluadas)
+        {
+            int *marcas = &ctx->marcas_lsh[(long)omp_get_thread_num() * mis_filas];
+            #pragma omp for schedule(dynamic, 16)
+            for (int q = 0; q < num_consultas; q++) {
+                VecinoInterno *lista = &mis_top_k_aprox[(long)q * k];
+                inicializar_lista(lista, k);
+                evaluadas += lsh_buscar(ctx->lsh, &patrones[(long)q * stride], inicio + q - 1, lista, k, marcas, q);
             }
-            FILE *f_mape = fopen("MAPE.txt", "a");
-            if(f_mape) { fprintf(f_mape, "%.2f\n", error_dia); fclose(f_mape); }
         }
+        ctx->lsh_evaluadas += evaluadas;
+        ctx->t_lsh += (MPI_Wtime() - t_temp_start);
     }
 
-    // --- LIBERACIÓN DE MEMORIA ---
-    free(patron_objetivo);
-    free(valores_reales);
+    // 4. Una única reducción en árbol con los top-K de todas las consultas (una lista por consulta)
+    t_temp_start = MPI_Wtime();
+    t_traza = traza_ahora();
+    MPI_Allreduce(mis_top_k, mejores, num_consultas, ctx->tipos.tipo_lista, ctx->tipos.op_fusion, ctx->comm);
+    if (ctx->lsh) {
+        MPI_Allreduce(mis_top_k_aprox, mejores_aprox, num_consultas, ctx->tipos.tipo_lista, ctx->tipos.op_fusion,
+                      ctx->comm);
+    }
+    traza_registrar(TRAZA_REDUCCION_TOPK, t_traza);
+    ctx->t_comunicacion += (MPI_Wtime() - t_temp_start);
+
+    // 5. Bloques de filas de todas las consultas (exactos [, aproximados] y fila real) en una reducción
+    int num_listas = ctx->lsh ? 2 : 1;
+    long tam_bloque = (long)(num_listas * k + 1) * columnas;
+    float *mis_bloques = (float *)malloc(num_consultas * tam_bloque * sizeof(float));
+    float *bloques = NULL;
+    if (ctx->pid == MASTERPID) bloques = (float *)malloc(num_consultas * tam_bloque * sizeof(float));
+    VecinoInterno *listas_consulta = (VecinoInterno *)malloc(num_listas * k * sizeof(VecinoInterno));
+    if (mis_bloques == NULL || listas_consulta == NULL || (ctx->pid == MASTERPID && bloques == NULL)) {
+        fprintf(stderr, "[ERROR] Sin memoria para el modo por lotes (%d consultas)\n", num_consultas);
+        MPI_Abort(MPI_COMM_WORLD, EXIT_FAILURE);
+    }
+    t_traza = traza_ahora();
+    for (int q = 0; q < num_consultas; q++) {
+        for (int j = 0; j < k; j++) listas_consulta[j] = mejores[(long)q * k + j];
+        if (ctx->lsh) for (int j = 0; j < k; j++) listas_consulta[k + j] = mejores_aprox[(long)q * k + j];
+        aportar_filas_dia(ctx, listas_consulta, num_listas * k, inicio + q, &mis_bloques[q * tam_bloque]);
+    }
+    t_temp_start = MPI_Wtime();
+    MPI_Reduce(mis_bloques, bloques, (int)(num_consultas * tam_bloque), MPI_FLOAT, MPI_SUM, MASTERPID, ctx->comm);
+    traza_registrar(TRAZA_REUNION_FILAS, t_traza);
+    ctx->t_comunicacion += (MPI_Wtime() - t_temp_start);
+
+    // 6. Master predice cada día con sus K vecinos globales
+    if (ctx->pid == MASTERPID) {
+        t_traza = traza_ahora();
+        for (int q = 0; q < num_consultas; q++) {
+            if (ctx->lsh) procesar_dia_lsh(ctx, &mejores[(long)q * k], &mejores_aprox[(long)q * k], &bloques[q * tam_bloque]);
+            else procesar_dia_master(ctx, &mejores[(long)q * k], &bloques[q * tam_bloque]);
+        }
+        traza_registrar(TRAZA_PREDICCION, t_traza);
+    }
+    free(mis_top_k_aprox);
+    free(mejores_aprox);
+    free(listas_consulta);
+    free(mis_bloques);
+    free(bloques);
+
+    free(patrones);
+    free(dist_hilos);
     free(mis_top_k);
     free(buffer_hilos);
-    if (pid == MASTERPID) { free(todos_candidatos); free(prediccion); }
+    free(mejores);
+}
+
+// Último proceso en modo continuo: añade 'fila' al final de sus filas locales. El buffer
+// propio (ver bucle_continuo) dobla su capacidad cuando se llena, y los árboles y los
+// resúmenes de poda (y la copia compacta) se amplían con la fila sin reconstruirse.
+static void anexar_fila(ContextoPrediccion *ctx, float **propias, int *capacidad, const float *fila) {
+    int stride = ctx->stride;
+    if (ctx->mis_filas == *capacidad) {
+        int nueva = 2 * *capacidad;
+        float *ampliadas = reservar_filas_alineadas(nueva, stride);
+        if (ampliadas == NULL) {
+            fprintf(stderr, "[ERROR P%d] Sin memoria para ampliar el histórico (%d filas)\n", ctx->pid, nueva);
+            MPI_Abort(MPI_COMM_WORLD, EXIT_FAILURE);
+        }
+        memcpy(ampliadas, *propias, (size_t)ctx->mis_filas * stride * sizeof(float));
+        free(*propias);
+        *propias = ampliadas;
+        *capacidad = nueva;
+        ctx->datos_locales = ampliadas;
+        for (int t = 0; t < ctx->num_arboles; t++) ctx->arboles[t]->datos = ampliadas;
+    }
+
+    memcpy(&ctx->datos_locales[(long)ctx->mis_filas * stride], fila, (size_t)ctx->columnas * sizeof(float));
+    ctx->mis_filas++;
+    if (ctx->poda && poda_ampliar(ctx->poda, ctx->datos_locales, ctx->mis_filas, stride) != 0) {
+        fprintf(stderr, "[ERROR P%d] Sin memoria para los resúmenes de poda\n", ctx->pid);
+        MPI_Abort(MPI_COMM_WORLD, EXIT_FAILURE);
+    }
+    if (ctx->compacto && compacto_ampliar(ctx->compacto, ctx->datos_locales, ctx->mis_filas) != 0) {
+        fprintf(stderr, "[ERROR P%d] Sin memoria para la copia compacta\n", ctx->pid);
+        MPI_Abort(MPI_COMM_WORLD, EXIT_FAILURE);
+    }
+}
+
+// Modo continuo (--continuo): el histórico ya está repartido y los índices construidos; el
+// Master lee los días nuevos de uno en uno y cada uno se añade al final del último proceso,
+// que es el dueño de las filas más recientes (así el reparto sigue siendo por bloques y el
+// halo no cambia). Por petición: un Bcast con el día nuevo, que es también el patrón del
+// siguiente, la búsqueda local, la fusión de top-K y la reunión de las filas de los vecinos.
+// El Master responde en cuanto tiene la predicción y, cuando llega el día real, la evalúa.
+static void bucle_continuo(ContextoPrediccion *ctx) {
+    int k = ctx->k;
+    int columnas = ctx->columnas;
+    int ultimo = ctx->num_procs - 1;
+    const int *inicios_originales = ctx->inicios;
+    float *datos_originales = ctx->datos_locales;
+
+    // El reparto crece por el final: copia propia de 'inicios'
+    int *inicios = (int *)malloc((ctx->num_procs + 1) * sizeof(int));
+    float *patron = reservar_filas_alineadas(1, ctx->stride);
+    float *mensaje = (float *)malloc((columnas + 1) * sizeof(float));
+    VecinoInterno *mis_top_k = (VecinoInterno *)malloc(k * sizeof(VecinoInterno));
+    VecinoInterno *mejores = (VecinoInterno *)malloc(k * sizeof(VecinoInterno));
+    long tam_bloque = (long)(k + 1) * columnas;
+    float *mi_bloque = (float *)malloc(tam_bloque * sizeof(float));
+    float *bloque = (float *)malloc(tam_bloque * sizeof(float));
+    float *pendiente = (float *)malloc(columnas * sizeof(float));
+    int max_hilos = omp_get_max_threads();
+    VecinoInterno *buffer_hilos = (VecinoInterno *)malloc(max_hilos * separacion_listas_hilos(ctx->capacidad_topk) * sizeof(VecinoInterno));
+    if (inicios == NULL || patron == NULL || mensaje == NULL || mis_top_k == NULL || mejores == NULL ||
+        mi_bloque == NULL || bloque == NULL || pendiente == NULL || buffer_hilos == NULL) {
+        fprintf(stderr, "[ERROR P%d] Sin memoria para el modo continuo\n", ctx->pid);
+        MPI_Abort(MPI_COMM_WORLD, EXIT_FAILURE);
+    }
+    for (int p = 0; p <= ctx->num_procs; p++) inicios[p] = ctx->inicios[p];
+    ctx->inicios = inicios;
+
+    // El último proceso pasa sus filas a un buffer propio (las originales pueden ser un mapeo
+    // o la ventana compartida del nodo, que no crecen)
+    float *propias = NULL;
+    int capacidad = 0;
+    if (ctx->pid == ultimo) {
+        capacidad = 2 * ctx->mis_filas + 64;
+        propias = reservar_filas_alineadas(capacidad, ctx->stride);
+        if (propias == NULL) {
+            fprintf(stderr, "[ERROR P%d] Sin memoria para el histórico del modo continuo\n", ctx->pid);
+            MPI_Abort(MPI_COMM_WORLD, EXIT_FAILURE);
+        }
+        memcpy(propias, ctx->datos_locales, (size_t)ctx->mis_filas * ctx->stride * sizeof(float));
+        ctx->datos_locales = propias;
+        for (int t = 0; t < ctx->num_arboles; t++) ctx->arboles[t]->datos = propias;
+    }
+
+    // Patrón de la primera predicción: el último día del histórico
+    int raiz_patron = preparar_patron(ctx, ctx->total_filas, patron);
+    MPI_Bcast(patron, columnas, MPI_FLOAT, raiz_patron, ctx->comm);
+
+    FuenteContinua *fuente = NULL;
+    if (ctx->pid == MASTERPID) {
+        printf("[CONTINUO] Histórico de %d días listo; peticiones desde %s\n", ctx->total_filas, ctx->opciones->ruta_continuo);
+        fflush(stdout);
+        fuente = continuo_abrir(ctx->opciones->ruta_continuo);
+        if (fuente == NULL) {
+            fprintf(stderr, "[ERROR CONTINUO] No se pudo abrir la fuente %s\n", ctx->opciones->ruta_continuo);
+            MPI_Abort(MPI_COMM_WORLD, EXIT_FAILURE);
+        }
+    }
+    ctx->num_predicciones = 0;
+    int dia_pendiente = -1;
+
+    for (;;) {
+        // 1. El Master espera la siguiente petición y la difunde con el día nuevo (si lo hay)
+        double t_llegada = 0.0;
+        if (ctx->pid == MASTERPID) {
+            PeticionContinua peticion;
+            do {
+                peticion = continuo_leer(fuente, &mensaje[1], columnas);
+            } while (peticion == CONTINUO_INVALIDA);
+            t_llegada = MPI_Wtime();
+            mensaje[0] = (float)peticion;
+        }
+        double t_temp_start = MPI_Wtime();
+        double t_traza = traza_ahora();
+        MPI_Bcast(mensaje, columnas + 1, MPI_FLOAT, MASTERPID, ctx->comm);
+        traza_registrar(TRAZA_DIFUSION, t_traza);
+        ctx->t_comunicacion += (MPI_Wtime() - t_temp_start);
+        PeticionContinua peticion = (PeticionContinua)(int)mensaje[0];
+        if (peticion == CONTINUO_FIN) break;
+
+        // 2. Día nuevo: se evalúa la predicción que lo esperaba y se añade al histórico
+        if (peticion == CONTINUO_FILA) {
+            const float *fila = &mensaje[1];
+            if (ctx->pid == MASTERPID && dia_pendiente == ctx->total_filas) {
+                float error_dia = mape_dia(fila, pendiente, columnas);
+                ctx->mape_acumulado += error_dia;
+                ctx->dias_evaluados++;
+                double t_esc = MPI_Wtime();
+                if (ctx->escritor) escritor_encolar(ctx->escritor, pendiente, error_dia);
+                ctx->t_escritura += MPI_Wtime() - t_esc;
+            }
+            if (ctx->pid == ultimo) anexar_fila(ctx, &propias, &capacidad, fila);
+            inicios[ctx->num_procs]++;
+            ctx->total_filas++;
+            for (int j = 0; j < columnas; j++) patron[j] = fila[j];
+        }
+
+        // 3. Búsqueda del día siguiente al último conocido y fusión de los top-K
+        int dia_idx = ctx->total_filas;
+        buscar_dia(ctx, patron, dia_idx, buffer_hilos, mis_top_k);
+        t_temp_start = MPI_Wtime();
+        t_traza = traza_ahora();
+        MPI_Allreduce(mis_top_k, mejores, 1, ctx->tipos.tipo_lista, ctx->tipos.op_fusion, ctx->comm);
+        traza_registrar(TRAZA_REDUCCION_TOPK, t_traza);
+
+        // 4. Filas siguientes de los vecinos hacia el Master (no hay fila real: es el futuro)
+        t_traza = traza_ahora();
+        aportar_filas_dia(ctx, mejores, k, dia_idx, mi_bloque);
+        MPI_Reduce(mi_bloque, bloque, (int)tam_bloque, MPI_FLOAT, MPI_SUM, MASTERPID, ctx->comm);
+        traza_registrar(TRAZA_REUNION_FILAS, t_traza);
+        ctx->t_comunicacion += (MPI_Wtime() - t_temp_start);
+
+        // 5. El Master predice y responde
+        if (ctx->pid == MASTERPID) {
+            t_traza = traza_ahora();
+            calcular_prediccion(ctx, mejores, bloque, pendiente);
+            continuo_responder(fuente, dia_idx, pendiente, columnas);
+            latencias_anotar(&ctx->latencias, MPI_Wtime() - t_llegada);
+            traza_registrar(TRAZA_PREDICCION, t_traza);
+            dia_pendiente = dia_idx;
+        }
+        ctx->num_predicciones++;
+    }
+
+    if (ctx->pid == MASTERPID) continuo_cerrar(fuente);
+
+    ctx->inicios = inicios_originales;
+    ctx->datos_locales = datos_originales;
+    free(propias);
+    free(inicios);
+    free(patron);
+    free(mensaje);
+    free(mis_top_k);
+    free(mejores);
+    free(mi_bloque);
+    free(bloque);
+    free(pendiente);
+    free(buffer_hilos);
+}
+
+void ejecutar_predicciones(float *datos_locales, int mis_filas, int columnas, int stride, int k, 
+                           int num_procs, int pid, MPI_Comm comm, const int *inicios, int total_filas,
+                           const char* nombre_fichero, double t_lectura, double t_scatter,
+                           const OpcionesPrediccion *opciones, ResultadoPrediccion *resultado) {
+    
+    // Configuración del número de predicciones (últimas 1000 filas o menos si el fichero es pequeño)
+    int num_predicciones = 1000;
+    if (total_filas < num_predicciones + 24) {
+        num_predicciones = (total_filas > 50) ? 50 : 1;
+        if(pid == MASTERPID) printf("[AVISO] Fichero pequeño. Reduciendo predicciones a %d\n", num_predicciones);
+    }
+
+    ContextoPrediccion ctx = {0};
+    ctx.datos_locales = datos_locales;
+    ctx.mis_filas = mis_filas;
+    ctx.columnas = columnas;
+    ctx.stride = stride;
+    ctx.k = k;
+    ctx.num_procs = num_procs;
+    ctx.pid = pid;
+    ctx.comm = comm;
+    ctx.inicios = inicios;
+    ctx.total_filas = total_filas;
+    ctx.mi_offset_global = inicios[pid];
+    ctx.num_predicciones = num_predicciones;
+    ctx.inicio_evaluacion = total_filas - num_predicciones;
+    ctx.opciones = opciones;
+    ctx.estrategia_topk = topk_resolver(opciones->estrategia_topk, k, opciones->usar_poda);
+    ctx.capacidad_topk = topk_capacidad(ctx.estrategia_topk, k);
+    crear_tipos_vecinos(k, &ctx.tipos);
+
+    double tiempo_inicio = 0.0, tiempo_fin;
+    if (pid == MASTERPID) tiempo_inicio = MPI_Wtime();
+
+    // Modo continuo: los índices se construyen con todo el histórico y crecen con cada día
+    int continuo = opciones->ruta_continuo != NULL;
+    if (continuo && pid == MASTERPID) {
+        if (opciones->usar_lsh) printf("[AVISO] El índice LSH no admite filas nuevas; se ignora --lsh en modo continuo\n");
+        if (opciones->barrido_k) printf("[AVISO] --barrido no aplica al modo continuo; se ignora\n");
+        if (opciones->modo_lote || opciones->modo_segmentado || opciones->modo_persistente) {
+            printf("[AVISO] --continuo sustituye a los modos --lote, --segmentado y --persistente; se ignoran\n");
+        }
+    }
+
+    // Índice VP: en modo día solo con el histórico previo a la evaluación (el resto se
+    // inserta día a día); en modo lote con todas las filas y el corte en cada consulta
+    if (opciones->usar_indice) {
+        if (opciones->usar_poda && pid == MASTERPID) printf("[AVISO] --indice sustituye al recorrido lineal; se ignora --poda\n");
+        construir_indice(&ctx, (opciones->modo_lote || continuo) ? total_filas : ctx.inicio_evaluacion - 1);
+    }
+
+    // Índice LSH sobre todas las filas locales (colectiva: proyecciones y anchos comunes)
+    if (opciones->usar_lsh && !continuo) {
+        double t_lsh = MPI_Wtime();
+        ctx.lsh = lsh_construir(datos_locales, mis_filas, stride, columnas, ctx.mi_offset_global,
+                                opciones->lsh_tablas, opciones->lsh_hashes, opciones->lsh_ancho, ctx.comm);
+        ctx.t_construccion_lsh = MPI_Wtime() - t_lsh;
+        long num_marcas = (long)omp_get_max_threads() * (mis_filas > 0 ? mis_filas : 1);
+        ctx.marcas_lsh = (int *)malloc(num_marcas * sizeof(int));
+        if (ctx.marcas_lsh == NULL) {
+            fprintf(stderr, "[ERROR P%d] Sin memoria para el modo LSH\n", pid);
+            MPI_Abort(MPI_COMM_WORLD, EXIT_FAILURE);
+        }
+        for (long i = 0; i < num_marcas; i++) ctx.marcas_lsh[i] = -1;
+    }
+
+    // Resúmenes para la poda: se calculan una vez y sirven para todos los días
+    if (opciones->usar_poda && !opciones->usar_indice) {
+        double t_poda = MPI_Wtime();
+        ctx.poda = poda_construir(datos_locales, mis_filas, stride, columnas, opciones->segmentos_poda);
+        if (ctx.poda == NULL) {
+            fprintf(stderr, "[ERROR P%d] Sin memoria para los resúmenes de poda\n", pid);
+            MPI_Abort(MPI_COMM_WORLD, EXIT_FAILURE);
+        }
+        ctx.t_calculo += MPI_Wtime() - t_poda;
+    }
+
+    // Copia compacta para el recorrido lineal: día a día, segmentado, persistente y continuo
+    if (opciones->compacto != COMPACTO_NINGUNO) {
+        if (opciones->usar_indice || opciones->usar_poda || (opciones->modo_lote && !continuo)) {
+            if (pid == MASTERPID) printf("[AVISO] --compacto solo aplica al recorrido lineal (sin --poda, --indice ni --lote); se ignora\n");
+        } else {
+            double t_compacto = MPI_Wtime();
+            ctx.compacto = compacto_construir(datos_locales, mis_filas, stride, columnas, opciones->compacto);
+            ctx.k_compacto = COMPACTO_CANDIDATOS(k);
+            ctx.estrategia_compacto = topk_resolver(opciones->estrategia_topk, ctx.k_compacto, 0);
+            ctx.separacion_compacto = separacion_listas_hilos(topk_capacidad(ctx.estrategia_compacto, ctx.k_compacto));
+            ctx.candidatos_compacto = (VecinoInterno *)malloc(omp_get_max_threads() * ctx.separacion_compacto * sizeof(VecinoInterno));
+            if (ctx.compacto == NULL || ctx.candidatos_compacto == NULL) {
+                fprintf(stderr, "[ERROR P%d] Sin memoria para la copia compacta\n", pid);
+                MPI_Abort(MPI_COMM_WORLD, EXIT_FAILURE);
+            }
+            ctx.t_calculo += MPI_Wtime() - t_compacto;
+        }
+    }
+
+    if (pid == MASTERPID) {
+        ctx.prediccion = (float *)calloc(columnas, sizeof(float));
+
+        // Abrir (y truncar) los ficheros de salida una sola vez; el volcado va en segundo plano
+        double t_esc = MPI_Wtime();
+        ctx.escritor = escritor_crear(opciones->formato_salida, columnas, opciones->capacidad_salida);
+        if (ctx.escritor == NULL) fprintf(stderr, "[AVISO] Sin escritor de resultados, no se guardarán predicciones.\n");
+        ctx.t_escritura += MPI_Wtime() - t_esc;
+
+        if (opciones->barrido_k && !continuo) {
+            ctx.mape_por_k = (double *)calloc(k, sizeof(double));
+            ctx.suma_barrido = (float *)calloc(columnas, sizeof(float));
+            if (ctx.mape_por_k == NULL || ctx.suma_barrido == NULL) {
+                fprintf(stderr, "[ERROR] Sin memoria para el barrido de K\n");
+                MPI_Abort(MPI_COMM_WORLD, EXIT_FAILURE);
+            }
+        }
+    }
+
+    if (opciones->modo_lote && opciones->modo_segmentado && !continuo && pid == MASTERPID) {
+        printf("[AVISO] --lote ya agrupa las comunicaciones; se ignora --segmentado\n");
+    }
+    if (opciones->modo_persistente && (opciones->modo_lote || opciones->modo_segmentado) && !continuo && pid == MASTERPID) {
+        printf("[AVISO] --persistente solo aplica al modo dia; se ignora\n");
+    }
+    int persistente = opciones->modo_persistente && !opciones->modo_lote && !opciones->modo_segmentado && !continuo;
+    double t_preparacion = 0.0;     // Modo continuo: desde la carga hasta poder atender peticiones
+    if (continuo) {
+        if (pid == MASTERPID) t_preparacion = MPI_Wtime() - tiempo_inicio;
+        bucle_continuo(&ctx);
+        // Las estadísticas por día pasan a ser por petición
+        num_predicciones = (ctx.num_predicciones > 0) ? ctx.num_predicciones : 1;
+    } else if (opciones->modo_lote) bucle_lote(&ctx);
+    else if (opciones->modo_segmentado) bucle_segmentado(&ctx);
+    else if (opciones->modo_persistente) bucle_persistente(&ctx);
+    else bucle_por_dias(&ctx);
+    int segmentado = opciones->modo_segmentado && !opciones->modo_lote && !continuo;
+
+    // Vaciar el buffer de resultados pendiente y cerrar los ficheros
+    if (pid == MASTERPID) {
+        double t_esc = MPI_Wtime();
+        escritor_cerrar(ctx.escritor);
+        ctx.t_escritura += MPI_Wtime() - t_esc;
+        free(ctx.prediccion);
+    }
+
+    liberar_tipos_vecinos(&ctx.tipos);
 
     // --- RECOLECCIÓN DE ESTADÍSTICAS ---
     double total_calc_sum = 0.0;
     double total_comm_sum = 0.0;
-    MPI_Reduce(&t_acum_calculo, &total_calc_sum, 1, MPI_DOUBLE, MPI_SUM, MASTERPID, MPI_COMM_WORLD);
-    MPI_Reduce(&t_acum_comunicacion, &total_comm_sum, 1, MPI_DOUBLE, MPI_SUM, MASTERPID, MPI_COMM_WORLD);
+    long peticiones_total[2] = {0, 0};
+    MPI_Reduce(&ctx.t_calculo, &total_calc_sum, 1, MPI_DOUBLE, MPI_SUM, MASTERPID, ctx.comm);
+    MPI_Reduce(&ctx.t_comunicacion, &total_comm_sum, 1, MPI_DOUBLE, MPI_SUM, MASTERPID, ctx.comm);
+    if (segmentado) {
+        MPI_Reduce(ctx.peticiones, peticiones_total, 2, MPI_LONG, MPI_SUM, MASTERPID, ctx.comm);
+    }
+
+    // Contadores de poda de todos los procesos (mismo orden de campos que ContadoresPoda)
+    ContadoresPoda poda_total = {0};
+    if (ctx.poda) {
+        MPI_Reduce(&ctx.contadores, &poda_total, PODA_NUM_CONTADORES, MPI_LONG, MPI_SUM, MASTERPID, ctx.comm);
+        poda_liberar(ctx.poda);
+    }
+
+    // Estadísticas del índice: construcción (el proceso más lento), consultas y nodos visitados
+    ContadoresVP vp_total = {0};
+    double t_construccion_max = 0.0, t_consulta_sum = 0.0;
+    if (ctx.arboles) {
+        MPI_Reduce(&ctx.contadores_vp, &vp_total, 4, MPI_LONG, MPI_SUM, MASTERPID, ctx.comm);
+        MPI_Reduce(&ctx.t_construccion, &t_construccion_max, 1, MPI_DOUBLE, MPI_MAX, MASTERPID, ctx.comm);
+        MPI_Reduce(&ctx.t_consulta, &t_consulta_sum, 1, MPI_DOUBLE, MPI_SUM, MASTERPID, ctx.comm);
+        for (int t = 0; t < ctx.num_arboles; t++) vp_liberar(ctx.arboles[t]);
+        free(ctx.arboles);
+        free(ctx.siguiente_fila);
+    }
+
+    // Copia compacta: distancias float32 recalculadas, respaldos y la mayor cota de error
+    long compacto_total[2] = {0, 0};
+    double error_compacto = 0.0;
+    FormatoCompacto formato_compacto = ctx.compacto ? ctx.compacto->formato : COMPACTO_NINGUNO;
+    if (ctx.compacto) {
+        long locales[2] = {ctx.reordenadas_compacto, ctx.respaldos_compacto};
+        MPI_Reduce(locales, compacto_total, 2, MPI_LONG, MPI_SUM, MASTERPID, ctx.comm);
+        MPI_Reduce(&ctx.compacto->error, &error_compacto, 1, MPI_DOUBLE, MPI_MAX, MASTERPID, ctx.comm);
+        compacto_liberar(ctx.compacto);
+        free(ctx.candidatos_compacto);
+    }
+
+    // Estadísticas del modo aproximado
+    long lsh_evaluadas_total = 0;
+    double t_lsh_sum = 0.0, t_construccion_lsh_max = 0.0;
+    if (ctx.lsh) {
+        MPI_Reduce(&ctx.lsh_evaluadas, &lsh_evaluadas_total, 1, MPI_LONG, MPI_SUM, MASTERPID, ctx.comm);
+        MPI_Reduce(&ctx.t_lsh, &t_lsh_sum, 1, MPI_DOUBLE, MPI_SUM, MASTERPID, ctx.comm);
+        MPI_Reduce(&ctx.t_construccion_lsh, &t_construccion_lsh_max, 1, MPI_DOUBLE, MPI_MAX, MASTERPID, ctx.comm);
+        lsh_liberar(ctx.lsh);
+        free(ctx.marcas_lsh);
+    }
 
     if (pid == MASTERPID) {
         tiempo_fin = MPI_Wtime();
@@ -236,20 +1475,154 @@ void ejecutar_predicciones(float *datos_locales, int mis_filas, int columnas, in
         double tiempo_algoritmo = tiempo_fin - tiempo_inicio;
         double tiempo_total_absoluto = tiempo_algoritmo + t_lectura + t_scatter;
         
-        double mape_medio = mape_acumulado / num_predicciones;
+        // En modo continuo solo cuentan los días cuyo valor real ya llegó
+        double mape_medio = continuo ? ctx.mape_acumulado / (ctx.dias_evaluados > 0 ? ctx.dias_evaluados : 1)
+                                     : ctx.mape_acumulado / num_predicciones;
         double avg_calc = total_calc_sum / num_procs;
         double avg_comm = total_comm_sum / num_procs;
 
         printf("\n--- RESULTADOS (%s) ---\n", nombre_fichero);
         printf("Tiempo Total: %.4fs\n", tiempo_total_absoluto);
         printf("MAPE Medio: %.4f%%\n", mape_medio);
+
+        // Modo continuo: el arranque se paga una vez; cada petición cuesta solo su latencia
+        double lat_p50 = 0.0, lat_p95 = 0.0, lat_p99 = 0.0, lat_max = 0.0, t_arranque = 0.0;
+        if (continuo) {
+            t_arranque = t_lectura + t_scatter + t_preparacion;
+            lat_p50 = latencias_percentil(&ctx.latencias, 0.50) * 1e3;
+            lat_p95 = latencias_percentil(&ctx.latencias, 0.95) * 1e3;
+            lat_p99 = latencias_percentil(&ctx.latencias, 0.99) * 1e3;
+            lat_max = latencias_percentil(&ctx.latencias, 1.0) * 1e3;
+            printf("Continuo: arranque %.4fs, %ld peticiones (%d dias evaluados), latencia p50 %.3fms, p95 %.3fms, p99 %.3fms, max %.3fms\n",
+                   t_arranque, ctx.latencias.num, ctx.dias_evaluados, lat_p50, lat_p95, lat_p99, lat_max);
+        }
+
+        // Porcentaje de filas descartadas en cada etapa de la cascada
+        double pct_norma = 0.0, pct_paa = 0.0, pct_exacta = 0.0, pct_aceptadas = 0.0;
+        if (ctx.poda && poda_total.evaluadas > 0) {
+            double ev = (double)poda_total.evaluadas;
+            pct_norma = 100.0 * poda_total.podadas_norma / ev;
+            pct_paa = 100.0 * poda_total.podadas_paa / ev;
+            pct_exacta = 100.0 * poda_total.podadas_exacta / ev;
+            pct_aceptadas = 100.0 * poda_total.aceptadas / ev;
+            printf("Poda: %ld filas evaluadas -> norma %.2f%%, PAA %.2f%%, abandono %.2f%%, insertadas %.2f%%\n",
+                   poda_total.evaluadas, pct_norma, pct_paa, pct_exacta, pct_aceptadas);
+        }
         
+        // Índice frente a fuerza bruta: distancias calculadas por día en ambos casos
+        double nodos_dia = 0.0, dist_dia = 0.0, bf_dia = 0.0;
+        if (ctx.arboles) {
+            nodos_dia = (double)vp_total.nodos_visitados / num_predicciones;
+            dist_dia = (double)vp_total.distancias / num_predicciones;
+            bf_dia = (double)vp_total.candidatas / num_predicciones;
+            printf("Indice VP: construccion %.4fs, consultas %.4fs, %.1f nodos y %.1f distancias por dia (fuerza bruta: %.1f)\n",
+                   t_construccion_max, t_consulta_sum / num_procs, nodos_dia, dist_dia, bf_dia);
+        }
+
+        // Compacto: cuántas filas hubo que releer en float32 por día (el resto solo en 16 bits)
+        double reordenadas_dia = 0.0;
+        if (formato_compacto != COMPACTO_NINGUNO) {
+            reordenadas_dia = (double)compacto_total[0] / num_predicciones;
+            printf("Compacto (%s): error maximo %.4g, %.1f distancias float32 por dia, %ld respaldos\n",
+                   compacto_nombre(formato_compacto), error_compacto, reordenadas_dia, compacto_total[1]);
+        }
+
+        // Segmentado: T_Comm es solo la espera; las comunicaciones que ya habían terminado al
+        // esperarlas se hicieron por completo durante el cálculo
+        double pct_oculto = 0.0;
+        if (segmentado) {
+            if (peticiones_total[0] > 0) pct_oculto = 100.0 * peticiones_total[1] / peticiones_total[0];
+            printf("Segmentado: T_Comm expuesto %.4fs, %.1f%% de las comunicaciones ya habian terminado al esperarlas\n",
+                   avg_comm, pct_oculto);
+        }
+
+        // Aproximado frente a exacto en la misma ejecución
+        double recall = 0.0, mape_exacto = 0.0, candidatos_dia = 0.0;
+        if (ctx.lsh) {
+            // Filas que cumplen el corte causal en cada día (las que recorre la fuerza bruta)
+            long candidatas_bf = 0;
+            for (int d = ctx.inicio_evaluacion; d < total_filas; d++) candidatas_bf += d - 1;
+            recall = (double)ctx.aciertos_lsh / ((double)num_predicciones * k);
+            mape_exacto = ctx.mape_exacto / num_predicciones;
+            candidatos_dia = (double)lsh_evaluadas_total / num_predicciones;
+            printf("LSH (L=%d, M=%d, W=%.2f): recall@%d %.4f, MAPE exacto %.4f%% -> aproximado %.4f%% (%+.4f)\n",
+                   opciones->lsh_tablas, opciones->lsh_hashes, opciones->lsh_ancho, k, recall,
+                   mape_exacto, mape_medio, mape_medio - mape_exacto);
+            printf("LSH: %.1f distancias por dia (fuerza bruta: %.1f), construccion %.4fs, busqueda %.4fs (exacta %.4fs), %d dias con menos de K candidatos\n",
+                   candidatos_dia, (double)candidatas_bf / num_predicciones, t_construccion_lsh_max,
+                   t_lsh_sum / num_procs, avg_calc, ctx.dias_sin_candidatos);
+        }
+
+        // Barrido de k: tabla k -> MAPE y el mejor k como subproducto de la ejecución
+        int mejor_k = 0;
+        double mejor_mape = 0.0;
+        if (ctx.mape_por_k) {
+            FILE *fk = fopen("MAPE_por_k.txt", "w");
+            if (fk) fprintf(fk, "K MAPE\n");
+            printf("\n%-5s | %s\n", "K", "MAPE (%)");
+            for (int v = 0; v < k; v++) {
+                double mape_k = ctx.mape_por_k[v] / num_predicciones;
+                printf("%-5d | %.4f\n", v + 1, mape_k);
+                if (fk) fprintf(fk, "%d %.4f\n", v + 1, mape_k);
+                if (mejor_k == 0 || mape_k < mejor_mape) {
+                    mejor_k = v + 1;
+                    mejor_mape = mape_k;
+                }
+            }
+            if (fk) fclose(fk);
+            printf("Mejor K: %d (MAPE %.4f%%). Tabla en MAPE_por_k.txt\n", mejor_k, mejor_mape);
+
+            FILE *fb = fopen("best_k.txt", "w");
+            if (fb) {
+                fprintf(fb, "%d\n", mejor_k);
+                fclose(fb);
+            }
+            free(ctx.mape_por_k);
+            free(ctx.suma_barrido);
+        }
+
         FILE *f = fopen("Tiempo.txt", "a");
         if (f) {
-            fprintf(f, "Fichero: %s, K: %d, Procesos: %d, Hilos: %d, MAPE: %.2f%%, T_Total: %.4fs, T_Lectura: %.4fs, T_Scatter: %.4fs, T_Calc(Avg): %.4fs, T_Comm(Avg): %.4fs\n", 
+            fprintf(f, "Fichero: %s, K: %d, Procesos: %d, Hilos: %d, MAPE: %.2f%%, T_Total: %.4fs, T_Lectura: %.4fs, T_Scatter: %.4fs, T_Calc(Avg): %.4fs, T_Comm(Avg): %.4fs, T_Escritura: %.4fs, Modo: %s, Kernel: %s", 
                     nombre_fichero, k, num_procs, omp_get_max_threads(), mape_medio, 
-                    tiempo_total_absoluto, t_lectura, t_scatter, avg_calc, avg_comm);
+                    tiempo_total_absoluto, t_lectura, t_scatter, avg_calc, avg_comm, ctx.t_escritura,
+                    continuo ? "continuo" : (opciones->modo_lote ? "lote" : (segmentado ? "segmentado" : (persistente ? "persistente" : "dia"))),
+                    distancia_nombre_kernel());
+            fprintf(f, ", TopK: %s", topk_nombre(ctx.arboles ? TOPK_ORDENADO : ctx.estrategia_topk));
+            if (opciones->ponderar_distancia) fprintf(f, ", Prediccion: ponderada");
+            if (opciones->memoria_compartida) fprintf(f, ", Memoria: compartida");
+            if (formato_compacto != COMPACTO_NINGUNO) {
+                fprintf(f, ", Compacto: %s, Error_Max: %.4g, Reordenadas/dia: %.1f, Respaldos: %ld",
+                        compacto_nombre(formato_compacto), error_compacto, reordenadas_dia, compacto_total[1]);
+            }
+            if (segmentado) fprintf(f, ", Comm_Oculta: %.1f%%", pct_oculto);
+            if (continuo) {
+                fprintf(f, ", T_Arranque: %.4fs, Peticiones: %ld, Latencia(p50/p95/p99/max): %.3f/%.3f/%.3f/%.3fms",
+                        t_arranque, ctx.latencias.num, lat_p50, lat_p95, lat_p99, lat_max);
+            }
+            if (ctx.poda) {
+                fprintf(f, ", Poda(norma/PAA/abandono): %.2f%%/%.2f%%/%.2f%%", pct_norma, pct_paa, pct_exacta);
+            }
+            if (ctx.arboles) {
+                fprintf(f, ", Indice: VP, T_Construccion: %.4fs, T_Consulta(Avg): %.4fs, Nodos/dia: %.1f, Distancias/dia: %.1f, FuerzaBruta/dia: %.1f",
+                        t_construccion_max, t_consulta_sum / num_procs, nodos_dia, dist_dia, bf_dia);
+            }
+            if (ctx.lsh) {
+                fprintf(f, ", LSH: L=%d M=%d W=%.2f, Recall@K: %.4f, MAPE_Exacto: %.2f%%, Delta_MAPE: %+.4f, Distancias/dia: %.1f, T_LSH(Avg): %.4fs, T_Construccion_LSH: %.4fs",
+                        opciones->lsh_tablas, opciones->lsh_hashes, opciones->lsh_ancho, recall, mape_exacto,
+                        mape_medio - mape_exacto, candidatos_dia, t_lsh_sum / num_procs, t_construccion_lsh_max);
+            }
+            if (mejor_k > 0) fprintf(f, ", Barrido: K=1..%d, Mejor_K: %d (%.2f%%)", k, mejor_k, mejor_mape);
+            fprintf(f, "\n");
             fclose(f);
         }
+        if (resultado) {
+            resultado->t_total = tiempo_total_absoluto;
+            resultado->t_calculo = avg_calc;
+            resultado->t_comunicacion = avg_comm;
+            resultado->t_escritura = ctx.t_escritura;
+            resultado->mape = mape_medio;
+        }
+        latencias_liberar(&ctx.latencias);
     }
-}
\ No newline at end of file
+}
@@ -1,25 +1,36 @@
 #ifndef K_NN_H
 #define K_NN_H
 
-// Estructura interna para usar qsort
+#include <mpi.h>
+#include "opciones.h"
+#include "vecinos.h"
+
+// Resumen de una ejecución (solo lo rellena el Master)
 typedef struct {
-    int indice_dia;
-    float dist_sq; // Distance Squared
-} VecinoInterno;
+    double t_total;         // T_Total de Tiempo.txt (algoritmo + lectura + reparto)
+    double t_calculo;       // Media por proceso
+    double t_comunicacion;  // Media por proceso
+    double t_escritura;
+    double mape;
+} ResultadoPrediccion;
 
 // Función principal que orquesta todo el proceso
 void ejecutar_predicciones(
-    float *datos_locales,
+    float *datos_locales,   // mis_filas filas propias + las de calcular_filas_almacenadas()
     int mis_filas,
     int columnas,
+    int stride,             // Floats por fila en datos_locales (ver distancia_stride)
     int k,
     int num_procs,
     int pid,
-    float *datos_globales,
+    MPI_Comm comm,          // Procesos que participan (pid y num_procs son relativos a él)
+    const int *inicios,     // Reparto de filas (ver calcular_particion), num_procs + 1 entradas
     int total_filas,
     const char* nombre_fichero,
     double t_lectura,
-    double t_scatter
+    double t_scatter,
+    const OpcionesPrediccion *opciones,
+    ResultadoPrediccion *resultado  // NULL si no hace falta
 );
 
 #endif
\ No newline at end of file
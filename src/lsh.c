@@ -0,0 +1,194 @@
+/*
+ * src/lsh.c
+ * Índice LSH de proyecciones aleatorias para el modo aproximado.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include <mpi.h>
+#include <omp.h>
+#include "lsh.h"
+#include "distancia.h"
+
+#define LSH_SEMILLA 0x4B4E4E4C5348ULL
+
+// Par (clave, fila) para ordenar cada tabla
+typedef struct {
+    uint64_t clave;
+    int fila;
+} EntradaLSH;
+
+static void* reservar(size_t bytes) {
+    void *p = malloc(bytes);
+    if (p == NULL) {
+        fprintf(stderr, "[ERROR] Sin memoria para el índice LSH (%zu bytes)\n", bytes);
+        MPI_Abort(MPI_COMM_WORLD, EXIT_FAILURE);
+    }
+    return p;
+}
+
+// Generador xorshift64*: reproducible y idéntico en todos los procesos
+static uint64_t siguiente_aleatorio(uint64_t *estado) {
+    uint64_t x = *estado;
+    x ^= x >> 12;
+    x ^= x << 25;
+    x ^= x >> 27;
+    *estado = x;
+    return x * 0x2545F4914F6CDD1DULL;
+}
+
+static double uniforme(uint64_t *estado) {
+    return ((siguiente_aleatorio(estado) >> 11) + 0.5) * (1.0 / 9007199254740992.0);
+}
+
+// Normal estándar por Box-Muller
+static double normal(uint64_t *estado) {
+    double u1 = uniforme(estado), u2 = uniforme(estado);
+    return sqrt(-2.0 * log(u1)) * cos(6.283185307179586 * u2);
+}
+
+static inline float proyectar(const float *a, const float *v, int columnas) {
+    float suma = 0.0f;
+    for (int j = 0; j < columnas; j++) suma += a[j] * v[j];
+    return suma;
+}
+
+// Clave de 64 bits de la tabla t: mezcla de los 'hashes' cubos enteros
+static uint64_t clave_tabla(const IndiceLSH *ind, int t, const float *v) {
+    uint64_t clave = 0xCBF29CE484222325ULL;
+    for (int h = 0; h < ind->hashes; h++) {
+        int f = t * ind->hashes + h;
+        float p = proyectar(&ind->proyecciones[(long)f * ind->columnas], v, ind->columnas);
+        int64_t cubo = (int64_t)floorf((p + ind->desplazamientos[f]) / ind->anchos[f]);
+        clave ^= (uint64_t)cubo + 0x9E3779B97F4A7C15ULL + (clave << 6) + (clave >> 2);
+    }
+    return clave;
+}
+
+static int comparar_entradas(const void *a, const void *b) {
+    const EntradaLSH *x = (const EntradaLSH *)a, *y = (const EntradaLSH *)b;
+    if (x->clave != y->clave) return (x->clave < y->clave) ? -1 : 1;
+    return x->fila - y->fila;
+}
+
+IndiceLSH* lsh_construir(const float *datos, int filas, int stride, int columnas, int offset_global,
+                         int tablas, int hashes, float ancho, MPI_Comm comm) {
+    IndiceLSH *ind = (IndiceLSH *)reservar(sizeof(IndiceLSH));
+    int funciones = tablas * hashes;
+    ind->datos = datos;
+    ind->filas = filas;
+    ind->columnas = columnas;
+    ind->stride = stride;
+    ind->offset_global = offset_global;
+    ind->tablas = tablas;
+    ind->hashes = hashes;
+    ind->proyecciones = (float *)reservar((long)funciones * columnas * sizeof(float));
+    ind->desplazamientos = (float *)reservar(funciones * sizeof(float));
+    ind->anchos = (float *)reservar(funciones * sizeof(float));
+    ind->claves = (uint64_t *)reservar(((long)tablas * filas + 1) * sizeof(uint64_t));
+    ind->filas_ordenadas = (int *)reservar(((long)tablas * filas + 1) * sizeof(int));
+
+    uint64_t estado = LSH_SEMILLA;
+    for (long i = 0; i < (long)funciones * columnas; i++) ind->proyecciones[i] = (float)normal(&estado);
+
+    // Desviación típica global de cada proyección (suma y suma de cuadrados de todos los procesos)
+    double *momentos = (double *)calloc(2 * funciones + 1, sizeof(double));
+    double *momentos_globales = (double *)calloc(2 * funciones + 1, sizeof(double));
+    if (momentos == NULL || momentos_globales == NULL) {
+        fprintf(stderr, "[ERROR] Sin memoria para el índice LSH\n");
+        MPI_Abort(MPI_COMM_WORLD, EXIT_FAILURE);
+    }
+    for (int f = 0; f < funciones; f++) {
+        double suma = 0.0, suma_cuadrados = 0.0;
+        const float *a = &ind->proyecciones[(long)f * columnas];
+        #pragma omp parallel for schedule(static) reduction(+:suma, suma_cuadrados)
+        for (int i = 0; i < filas; i++) {
+            double p = proyectar(a, &datos[(long)i * stride], columnas);
+            suma += p;
+            suma_cuadrados += p * p;
+        }
+        momentos[2 * f] = suma;
+        momentos[2 * f + 1] = suma_cuadrados;
+    }
+    momentos[2 * funciones] = filas;
+    MPI_Allreduce(momentos, momentos_globales, 2 * funciones + 1, MPI_DOUBLE, MPI_SUM, comm);
+
+    double n = momentos_globales[2 * funciones];
+    for (int f = 0; f < funciones; f++) {
+        double media = (n > 0) ? momentos_globales[2 * f] / n : 0.0;
+        double varianza = (n > 0) ? momentos_globales[2 * f + 1] / n - media * media : 0.0;
+        double w = ancho * sqrt(varianza > 0.0 ? varianza : 0.0);
+        ind->anchos[f] = (w > 1e-12) ? (float)w : 1.0f;
+        ind->desplazamientos[f] = (float)(uniforme(&estado) * ind->anchos[f]);
+    }
+    free(momentos);
+    free(momentos_globales);
+
+    // Tablas: claves de todas las filas ordenadas, así cada cubo es un rango contiguo
+    EntradaLSH *entradas = (EntradaLSH *)reservar(((long)tablas * filas + 1) * sizeof(EntradaLSH));
+    #pragma omp parallel for schedule(static)
+    for (int i = 0; i < filas; i++) {
+        for (int t = 0; t < tablas; t++) {
+            EntradaLSH *e = &entradas[(long)t * filas + i];
+            e->clave = clave_tabla(ind, t, &datos[(long)i * stride]);
+            e->fila = i;
+        }
+    }
+    #pragma omp parallel for schedule(dynamic, 1)
+    for (int t = 0; t < tablas; t++) {
+        qsort(&entradas[(long)t * filas], filas, sizeof(EntradaLSH), comparar_entradas);
+    }
+    for (long i = 0; i < (long)tablas * filas; i++) {
+        ind->claves[i] = entradas[i].clave;
+        ind->filas_ordenadas[i] = entradas[i].fila;
+    }
+    free(entradas);
+    return ind;
+}
+
+// Primera posición de 'claves' (ordenadas) con valor >= clave
+static long buscar_inicio(const uint64_t *claves, long n, uint64_t clave) {
+    long lo = 0, hi = n;
+    while (lo < hi) {
+        long mitad = lo + (hi - lo) / 2;
+        if (claves[mitad] < clave) lo = mitad + 1;
+        else hi = mitad;
+    }
+    return lo;
+}
+
+long lsh_buscar(const IndiceLSH *ind, const float *patron, int corte_global,
+                VecinoInterno *lista, int k, int *marcas, int sello) {
+    long evaluadas = 0;
+    int corte = corte_global - ind->offset_global;
+
+    for (int t = 0; t < ind->tablas; t++) {
+        uint64_t clave = clave_tabla(ind, t, patron);
+        const uint64_t *claves = &ind->claves[(long)t * ind->filas];
+        const int *filas = &ind->filas_ordenadas[(long)t * ind->filas];
+
+        // Dentro de un cubo las filas van en orden creciente: al pasar el corte se para
+        for (long p = buscar_inicio(claves, ind->filas, clave); p < ind->filas && claves[p] == clave; p++) {
+            int fila = filas[p];
+            if (fila >= corte) break;
+            if (marcas[fila] == sello) continue;
+            marcas[fila] = sello;
+
+            float dist = calcular_distancia_sq(&ind->datos[(long)fila * ind->stride], patron, ind->columnas);
+            insertar_vecino_ordenado(lista, k, ind->offset_global + fila, dist);
+            evaluadas++;
+        }
+    }
+    return evaluadas;
+}
+
+void lsh_liberar(IndiceLSH *ind) {
+    if (ind == NULL) return;
+    free(ind->proyecciones);
+    free(ind->desplazamientos);
+    free(ind->anchos);
+    free(ind->claves);
+    free(ind->filas_ordenadas);
+    free(ind);
+}
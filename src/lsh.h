@@ -0,0 +1,48 @@
+#ifndef LSH_H
+#define LSH_H
+
+#include <stdint.h>
+#include <mpi.h>
+#include "vecinos.h"
+
+// Búsqueda aproximada con LSH de proyecciones aleatorias (E2LSH):
+//   h(v) = floor((a·v + b) / w),  a ~ N(0, I),  b ~ U[0, w)
+// Cada tabla concatena 'hashes' funciones; una fila es candidata si coincide con el patrón
+// en todas las funciones de al menos una tabla. Los candidatos se reordenan con la
+// distancia exacta, así que el error solo viene de los vecinos que no colisionan.
+//
+// Mandos de precisión:
+//   tablas  -> más tablas = más candidatos y más recall (más memoria y tiempo)
+//   hashes  -> más funciones por tabla = cubos más pequeños, menos candidatos
+//   ancho   -> w en unidades de la desviación típica de cada proyección
+
+typedef struct {
+    const float *datos;      // Filas locales (no se copian)
+    int filas;
+    int columnas;
+    int stride;
+    int offset_global;
+    int tablas;
+    int hashes;
+    float *proyecciones;     // (tablas * hashes) x columnas
+    float *desplazamientos;  // b de cada función
+    float *anchos;           // w de cada función
+    uint64_t *claves;        // Por tabla: claves de las filas ordenadas
+    int *filas_ordenadas;    // Por tabla: fila local de cada clave
+} IndiceLSH;
+
+// Colectiva sobre 'comm': todos los procesos usan las mismas proyecciones (semilla fija)
+// y los mismos anchos, calculados con la desviación típica global de cada proyección.
+IndiceLSH* lsh_construir(const float *datos, int filas, int stride, int columnas, int offset_global,
+                         int tablas, int hashes, float ancho, MPI_Comm comm);
+
+// Mejora 'lista' con las filas que colisionan con el patrón y cumplen el corte causal.
+// 'marcas' (una entrada por fila local, inicializada a -1) evita repetir filas entre tablas;
+// 'sello' debe ser distinto en cada consulta que use las mismas marcas.
+// Devuelve el número de distancias exactas calculadas.
+long lsh_buscar(const IndiceLSH *indice, const float *patron, int corte_global,
+                VecinoInterno *lista, int k, int *marcas, int sello);
+
+void lsh_liberar(IndiceLSH *indice);
+
+#endif
@@ -9,9 +9,37 @@
 #include <omp.h>
 #include "utils.h"
 #include "k_nn.h"
+#include "opciones.h"
+#include "dataset_bin.h"
+#include "distancia.h"
+#include "afinidad.h"
+#include "traza.h"
+#include "memoria_nodo.h"
+#include "experimentos.h"
 
 #define MASTERPID 0
 
+// --memoria-compartida: crea la ventana de cada nodo. Si los procesos de algún nodo no tienen
+// rangos consecutivos se desactiva la opción y se sigue con una copia por proceso.
+static int preparar_ventana(VentanaNodo *ventana, const int *inicios, int stride, int pid,
+                            OpcionesPrediccion *opciones) {
+    if (!opciones->memoria_compartida) return 0;
+    if (ventana_nodo_crear(ventana, inicios, stride, MPI_COMM_WORLD) != 0) {
+        if (pid == MASTERPID) {
+            printf("[MEMORIA] Los procesos de un nodo no tienen rangos consecutivos: se usa una copia por proceso\n");
+        }
+        opciones->memoria_compartida = 0;
+        return 0;
+    }
+    if (pid == MASTERPID) {
+        int procs_nodo;
+        MPI_Comm_size(ventana->comm_nodo, &procs_nodo);
+        printf("[MEMORIA] Ventana compartida: %d nodo(s), %d proceso(s) en el del Master, %.1f MB en ese nodo\n",
+               ventana->num_nodos, procs_nodo, (double)ventana->num_filas * stride * sizeof(float) / (1024.0 * 1024.0));
+    }
+    return 1;
+}
+
 int main(int argc, char *argv[]) {
     
     int pid, prn, provided;
@@ -24,7 +52,9 @@ int main(int argc, char *argv[]) {
     // Variables del problema
     int filas_totales = 0, col_h = 0;
     int filas_por_proceso = 0;
-    int elems_por_proceso = 0;
+    int stride = 0;          // Floats por fila local (columnas + relleno SIMD)
+    int filas_almacenadas = 0; // Filas propias + halo
+    int *inicios = NULL;     // Reparto: el proceso p tiene las filas [inicios[p], inicios[p+1])
     
     float *datos_globales = NULL;
     float *datos_locales = NULL;
@@ -35,8 +65,27 @@ int main(int argc, char *argv[]) {
     MPI_Comm_size(MPI_COMM_WORLD, &prn);
 
     // Validación argumentos
-    if (argc != 5) {
-        if (pid == MASTERPID) printf("Uso: ./prediccion <K> <fichero> <procesos> <hilos>\n");
+    OpcionesPrediccion opciones;
+    opciones_por_defecto(&opciones);
+
+    // Matriz de experimentos: solo opciones, las configuraciones vienen en el fichero
+    if (argc >= 2 && argv[1][0] == '-' && argv[1][1] == '-') {
+        if (parsear_opciones(&opciones, argc, argv, 1, pid) == 0 && opciones.ruta_experimentos) {
+            ejecutar_experimentos(&opciones, pid, prn);
+        } else if (pid == MASTERPID) {
+            printf("Uso: ./prediccion --experimentos=FICHERO [opciones]\n");
+            imprimir_uso_opciones();
+        }
+        MPI_Finalize();
+        return 0;
+    }
+
+    if (argc < 5 || parsear_opciones(&opciones, argc, argv, 5, pid) != 0) {
+        if (pid == MASTERPID) {
+            printf("Uso: ./prediccion <K> <fichero> <procesos> <hilos> [opciones]\n");
+            printf("     ./prediccion --experimentos=FICHERO [opciones]\n");
+            imprimir_uso_opciones();
+        }
         MPI_Finalize();
         return 0;
     }
@@ -47,73 +96,201 @@ int main(int argc, char *argv[]) {
 
     omp_set_num_threads(num_hilos);
 
-    // ======================================================
-    // 1. LECTURA DE DATOS (Cronometrada)
-    // ======================================================
-    t1 = MPI_Wtime(); // Start crono lectura
-    if (pid == MASTERPID) {
-        datos_globales = leer_fichero(ruta_fichero, &filas_totales, &col_h, pid);
-    }
-    t2 = MPI_Wtime(); // Stop crono lectura
-    t_lectura = t2 - t1;
+    // Fijar los hilos antes de tocar los datos (el primer toque decide dónde quedan las páginas)
+    aplicar_afinidad(opciones.afinidad, MPI_COMM_WORLD);
+    traza_iniciar(opciones.prefijo_traza != NULL, omp_get_max_threads(), MPI_COMM_WORLD);
 
-    // ======================================================
-    // 2. DIFUSIÓN DE METADATOS
-    // ======================================================
-    MPI_Bcast(&filas_totales, 1, MPI_INT, MASTERPID, MPI_COMM_WORLD);
-    MPI_Bcast(&col_h, 1, MPI_INT, MASTERPID, MPI_COMM_WORLD);
+    // ¿Dataset binario? (lo decide el Master mirando la cabecera)
+    int es_binario = 0;
+    if (pid == MASTERPID) es_binario = es_dataset_binario(ruta_fichero);
+    MPI_Bcast(&es_binario, 1, MPI_INT, MASTERPID, MPI_COMM_WORLD);
 
-    // ======================================================
-    // 3. CÁLCULO DEL REPARTO
-    // ======================================================
-    filas_por_proceso = filas_totales / prn;
-    elems_por_proceso = filas_por_proceso * col_h;
+    // Si se usa mmap, los datos no son de malloc y se liberan con munmap
+    void *mapeo_local = NULL;
+    size_t tam_mapeo_local = 0;
 
-    // ======================================================
-    // 4. RESERVA DE MEMORIA LOCAL
-    // ======================================================
-    datos_locales = (float *)malloc(elems_por_proceso * sizeof(float));
-    if (datos_locales == NULL && elems_por_proceso > 0) {
-        perror("Error malloc local");
-        MPI_Abort(MPI_COMM_WORLD, EXIT_FAILURE);
-    }
+    // Con --memoria-compartida los datos están en la ventana del nodo
+    VentanaNodo ventana;
+    int usar_ventana = 0;
 
-    // ======================================================
-    // 5. DISTRIBUCIÓN (Scatter Cronometrado)
-    // ======================================================
-    t1 = MPI_Wtime(); // Start crono scatter
-    MPI_Scatter(datos_globales,              
-                elems_por_proceso,           
-                MPI_FLOAT,                   
-                datos_locales,               
-                elems_por_proceso,           
-                MPI_FLOAT,                   
-                MASTERPID, 
-                MPI_COMM_WORLD);
-    t2 = MPI_Wtime(); // Stop crono scatter
-    t_scatter = t2 - t1;
+    if (es_binario) {
+        // ======================================================
+        // 1-5. CARGA PARALELA DEL FORMATO BINARIO
+        // Cada proceso lee solo sus filas (y el halo): no hay parseo, ni Scatter, ni matriz global.
+        // ======================================================
+        t1 = MPI_Wtime();
+        CabeceraDataset cab;
+        int cab_ok = 0;
+        if (pid == MASTERPID) cab_ok = (leer_cabecera_dataset(ruta_fichero, &cab) == 0);
+        MPI_Bcast(&cab_ok, 1, MPI_INT, MASTERPID, MPI_COMM_WORLD);
+        if (!cab_ok) MPI_Abort(MPI_COMM_WORLD, EXIT_FAILURE);
+        MPI_Bcast(&cab, sizeof(cab), MPI_BYTE, MASTERPID, MPI_COMM_WORLD);
+
+        filas_totales = (int)cab.filas;
+        col_h = (int)cab.columnas;
+        stride = distancia_stride(col_h);
+        distancia_inicializar(col_h, opciones.simd);
+        double t_traza = traza_ahora();
+        inicios = preparar_reparto(filas_totales, col_h, stride, opciones.reparto == REPARTO_PONDERADO, MPI_COMM_WORLD);
+        traza_registrar(TRAZA_REPARTO, t_traza);
+        int fila_inicio = inicios[pid];
+        filas_por_proceso = inicios[pid+1] - inicios[pid];
+        filas_almacenadas = calcular_filas_almacenadas(inicios, prn, pid);
+
+        // El mapeo ya comparte las páginas de la caché entre los procesos del nodo
+        if (opciones.memoria_compartida && opciones.usar_mmap && stride == col_h) {
+            if (pid == MASTERPID) printf("[MEMORIA] Con --mmap los procesos del nodo ya comparten el fichero; se ignora --memoria-compartida\n");
+            opciones.memoria_compartida = 0;
+        }
+        usar_ventana = preparar_ventana(&ventana, inicios, stride, pid, &opciones);
+
+        t_traza = traza_ahora();
+        if (usar_ventana) {
+            // Cada proceso lee sus filas directamente en su tramo de la ventana (el último del
+            // nodo también el halo); después todo el nodo las ve
+            datos_locales = ventana_nodo_filas_proceso(&ventana, inicios, pid, stride);
+            leer_filas_dataset_en(ruta_fichero, &cab, fila_inicio, ventana_nodo_filas_a_cargar(&ventana, inicios, prn, pid),
+                                  stride, MPI_COMM_WORLD, datos_locales);
+            ventana_nodo_sincronizar(&ventana);
+        } else if (opciones.usar_mmap && stride == col_h) {
+            // Sin relleno necesario (columnas múltiplo del ancho SIMD): se usa el mapeo tal cual
+            // (cubre hasta el final del fichero, así que el halo ya está)
+            datos_locales = mapear_filas_dataset(ruta_fichero, &cab, fila_inicio, &mapeo_local, &tam_mapeo_local);
+        } else {
+            if (opciones.usar_mmap && pid == MASTERPID) {
+                printf("[IO] %d columnas no es múltiplo de %d: se leen las filas con relleno en lugar de mapearlas\n",
+                       col_h, DISTANCIA_ANCHO);
+            }
+            datos_locales = leer_filas_dataset(ruta_fichero, &cab, fila_inicio, filas_almacenadas, stride, MPI_COMM_WORLD);
+        }
+        traza_registrar(TRAZA_LECTURA, t_traza);
+
+        // Verificación del checksum: cada proceso aporta el de sus filas
+        uint64_t parcial = 0;
+        for (int i = 0; i < filas_por_proceso; i++) {
+            parcial += checksum_dataset(&datos_locales[(long)i * stride], col_h, (long)(fila_inicio + i) * col_h);
+        }
+        uint64_t total = 0;
+        MPI_Reduce(&parcial, &total, 1, MPI_UINT64_T, MPI_SUM, MASTERPID, MPI_COMM_WORLD);
+        if (pid == MASTERPID) {
+            if (total != cab.checksum) {
+                fprintf(stderr, "[ERROR IO] Checksum incorrecto en %s\n", ruta_fichero);
+                MPI_Abort(MPI_COMM_WORLD, EXIT_FAILURE);
+            }
+            printf("[IO] Dataset binario %s: %d filas x %d columnas (%s, checksum OK)\n",
+                   ruta_fichero, filas_totales, col_h,
+                   usar_ventana ? "MPI_File_read_at_all en la ventana del nodo" :
+                   opciones.usar_mmap ? "mmap" : "MPI_File_read_at_all");
+        }
+        t2 = MPI_Wtime();
+        t_lectura = t2 - t1;
+    } else {
+        // ======================================================
+        // 1. LECTURA DE DATOS (Cronometrada)
+        // ======================================================
+        t1 = MPI_Wtime(); // Start crono lectura
+        if (pid == MASTERPID) {
+            datos_globales = leer_fichero(ruta_fichero, &filas_totales, &col_h, pid);
+        }
+        t2 = MPI_Wtime(); // Stop crono lectura
+        t_lectura = t2 - t1;
+
+        // ======================================================
+        // 2. DIFUSIÓN DE METADATOS
+        // ======================================================
+        MPI_Bcast(&filas_totales, 1, MPI_INT, MASTERPID, MPI_COMM_WORLD);
+        MPI_Bcast(&col_h, 1, MPI_INT, MASTERPID, MPI_COMM_WORLD);
+
+        // ======================================================
+        // 3. CÁLCULO DEL REPARTO (con --reparto=ponderado incluye la calibración)
+        // ======================================================
+        stride = distancia_stride(col_h);
+        distancia_inicializar(col_h, opciones.simd);
+        t1 = MPI_Wtime();
+        double t_traza = traza_ahora();
+        inicios = preparar_reparto(filas_totales, col_h, stride, opciones.reparto == REPARTO_PONDERADO, MPI_COMM_WORLD);
+        traza_registrar(TRAZA_REPARTO, t_traza);
+        t_scatter = MPI_Wtime() - t1;
+        filas_por_proceso = inicios[pid+1] - inicios[pid];
+        usar_ventana = preparar_ventana(&ventana, inicios, stride, pid, &opciones);
+
+        if (usar_ventana) {
+            // ======================================================
+            // 4-5. DISTRIBUCIÓN POR NODOS (--memoria-compartida)
+            // Solo el líder de cada nodo recibe, directamente en la ventana, las filas de todo su
+            // nodo; el resto de procesos recorre su tramo en el sitio (sin Scatter ni halo).
+            // ======================================================
+            t1 = MPI_Wtime();
+            t_traza = traza_ahora();
+            ventana_nodo_repartir(&ventana, datos_globales, col_h, stride);
+            traza_registrar(TRAZA_REPARTO, t_traza);
+            t_scatter += MPI_Wtime() - t1;
+            datos_locales = ventana_nodo_filas_proceso(&ventana, inicios, pid, stride);
+
+            free(datos_globales);
+            datos_globales = NULL;
+        } else {
+            // ======================================================
+            // 4. RESERVA DE MEMORIA LOCAL (alineada y con relleno SIMD)
+            // ======================================================
+            filas_almacenadas = calcular_filas_almacenadas(inicios, prn, pid);
+            // Primer toque en paralelo: cada hilo sitúa las páginas de las filas que recorrerá
+            datos_locales = reservar_filas_primer_toque(filas_almacenadas, stride);
+            if (datos_locales == NULL) {
+                perror("Error malloc local");
+                MPI_Abort(MPI_COMM_WORLD, EXIT_FAILURE);
+            }
+
+            // ======================================================
+            // 5. DISTRIBUCIÓN (Scatterv + halo, cronometrado)
+            // ======================================================
+            t1 = MPI_Wtime(); // Start crono scatter
+            t_traza = traza_ahora();
+            repartir_filas(datos_globales, datos_locales, col_h, stride, inicios, MPI_COMM_WORLD);
+            t2 = MPI_Wtime(); // Stop crono scatter
+            traza_registrar(TRAZA_REPARTO, t_traza);
+            t_scatter += t2 - t1;
+
+            free(datos_globales);
+            datos_globales = NULL;
+        }
+    }
 
     // ======================================================
     // 6. LÓGICA DEL ALGORITMO
     // ======================================================
+
+    // El kernel de distancia (según la CPU o el forzado con --simd) se eligió antes del reparto
+    if (pid == MASTERPID) printf("[SIMD] Kernel de distancia: %s (stride %d)\n", distancia_nombre_kernel(), stride);
     
     // Pasamos los tiempos medidos a la función principal
     ejecutar_predicciones(
         datos_locales, 
         filas_por_proceso, 
         col_h, 
+        stride,
         k_vecinos, 
         prn, 
         pid, 
-        datos_globales, 
+        MPI_COMM_WORLD,
+        inicios,
         filas_totales,
         ruta_fichero,
         t_lectura,  // <--- Nuevo
-        t_scatter   // <--- Nuevo
+        t_scatter,  // <--- Nuevo
+        &opciones,
+        NULL
     );
 
-    if (datos_globales) free(datos_globales);
-    if (datos_locales) free(datos_locales);
+    if (opciones.prefijo_traza) {
+        traza_exportar(opciones.prefijo_traza, MPI_COMM_WORLD);
+        traza_liberar();
+    }
+
+    if (usar_ventana) ventana_nodo_liberar(&ventana);
+    else if (mapeo_local) liberar_mapeo_dataset(mapeo_local, tam_mapeo_local);
+    else if (datos_locales) free(datos_locales);
+    free(inicios);
 
     MPI_Finalize();
     return 0;
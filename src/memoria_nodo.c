@@ -0,0 +1,138 @@
+/*
+ * src/memoria_nodo.c
+ * Ventana de memoria compartida con las filas de todos los procesos de un nodo.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <mpi.h>
+#include <omp.h>
+#include "memoria_nodo.h"
+#include "utils.h"
+
+#define MASTERPID 0
+
+int ventana_nodo_crear(VentanaNodo *v, const int *inicios, int stride, MPI_Comm comm) {
+    int pid, num_procs;
+    MPI_Comm_rank(comm, &pid);
+    MPI_Comm_size(comm, &num_procs);
+    memset(v, 0, sizeof(*v));
+    v->comm_lideres = MPI_COMM_NULL;
+
+    MPI_Comm_split_type(comm, MPI_COMM_TYPE_SHARED, pid, MPI_INFO_NULL, &v->comm_nodo);
+    int pid_nodo, procs_nodo;
+    MPI_Comm_rank(v->comm_nodo, &pid_nodo);
+    MPI_Comm_size(v->comm_nodo, &procs_nodo);
+
+    // El tramo del nodo es contiguo solo si sus procesos tienen rangos consecutivos
+    MPI_Allreduce(&pid, &v->primer_proceso, 1, MPI_INT, MPI_MIN, v->comm_nodo);
+    MPI_Allreduce(&pid, &v->ultimo_proceso, 1, MPI_INT, MPI_MAX, v->comm_nodo);
+    int consecutivos = (v->ultimo_proceso - v->primer_proceso + 1 == procs_nodo);
+    int todos_consecutivos;
+    MPI_Allreduce(&consecutivos, &todos_consecutivos, 1, MPI_INT, MPI_LAND, comm);
+    if (!todos_consecutivos) {
+        MPI_Comm_free(&v->comm_nodo);
+        return -1;
+    }
+
+    MPI_Comm_split(comm, pid_nodo == 0 ? 0 : MPI_UNDEFINED, pid, &v->comm_lideres);
+    if (pid_nodo == 0) MPI_Comm_size(v->comm_lideres, &v->num_nodos);
+    MPI_Bcast(&v->num_nodos, 1, MPI_INT, 0, v->comm_nodo);
+
+    // Filas del nodo más el halo (la primera del nodo siguiente) si no es el último
+    v->fila_inicio = inicios[v->primer_proceso];
+    v->num_filas = inicios[v->ultimo_proceso + 1] - v->fila_inicio;
+    if (v->ultimo_proceso < num_procs - 1) v->num_filas++;
+
+    // Toda la memoria la aporta el líder; el resto consulta su dirección en su propio espacio
+    MPI_Aint bytes = (pid_nodo == 0) ? (MPI_Aint)(v->num_filas > 0 ? v->num_filas : 1) * stride * sizeof(float) : 0;
+    float *base = NULL;
+    int err = MPI_Win_allocate_shared(bytes, sizeof(float), MPI_INFO_NULL, v->comm_nodo, &base, &v->ventana);
+    if (err != MPI_SUCCESS) {
+        fprintf(stderr, "[ERROR P%d] No se pudo reservar la ventana compartida (%ld bytes)\n", pid, (long)bytes);
+        MPI_Abort(MPI_COMM_WORLD, EXIT_FAILURE);
+    }
+    MPI_Aint tam;
+    int tam_desp;
+    MPI_Win_shared_query(v->ventana, 0, &tam, &tam_desp, &v->filas);
+
+    // Época pasiva durante toda la vida de la ventana: la sincronización la hace
+    // ventana_nodo_sincronizar (MPI_Win_sync + barrera)
+    MPI_Win_lock_all(MPI_MODE_NOCHECK, v->ventana);
+
+    // Primer toque: cada proceso pone a 0 sus filas (y el último del nodo, el halo) con el
+    // mismo reparto estático que usará el recorrido, así las páginas quedan junto a sus hilos
+    float *mis_filas = ventana_nodo_filas_proceso(v, inicios, pid, stride);
+    long num_mis_filas = ventana_nodo_filas_a_cargar(v, inicios, num_procs, pid);
+    #pragma omp parallel for schedule(static)
+    for (long i = 0; i < num_mis_filas; i++) memset(&mis_filas[i * stride], 0, (size_t)stride * sizeof(float));
+    ventana_nodo_sincronizar(v);
+    return 0;
+}
+
+float* ventana_nodo_filas_proceso(const VentanaNodo *v, const int *inicios, int pid, int stride) {
+    return v->filas + (long)(inicios[pid] - v->fila_inicio) * stride;
+}
+
+int ventana_nodo_filas_a_cargar(const VentanaNodo *v, const int *inicios, int num_procs, int pid) {
+    if (pid == v->ultimo_proceso) return calcular_filas_almacenadas(inicios, num_procs, pid);
+    return inicios[pid+1] - inicios[pid];
+}
+
+void ventana_nodo_repartir(VentanaNodo *v, const float *datos_globales, int columnas, int stride) {
+    if (v->comm_lideres != MPI_COMM_NULL) {
+        int pid_lider;
+        MPI_Comm_rank(v->comm_lideres, &pid_lider);
+
+        // El Master (líder 0) necesita el tramo de cada nodo sin el halo: Scatterv no permite
+        // que dos tramos lean la misma posición del buffer de envío
+        int es_ultimo_nodo = (pid_lider == v->num_nodos - 1);
+        int filas_nodo = v->num_filas - (es_ultimo_nodo ? 0 : 1);
+        int tramo[2] = {v->fila_inicio, filas_nodo};
+        int *tramos = NULL, *elems_envio = NULL, *desplazamientos = NULL;
+        if (pid_lider == MASTERPID) {
+            tramos = (int *)malloc(2 * v->num_nodos * sizeof(int));
+            elems_envio = (int *)malloc(v->num_nodos * sizeof(int));
+            desplazamientos = (int *)malloc(v->num_nodos * sizeof(int));
+            if (tramos == NULL || elems_envio == NULL || desplazamientos == NULL) {
+                perror("Error malloc reparto entre nodos");
+                MPI_Abort(MPI_COMM_WORLD, EXIT_FAILURE);
+            }
+        }
+        MPI_Gather(tramo, 2, MPI_INT, tramos, 2, MPI_INT, MASTERPID, v->comm_lideres);
+        if (pid_lider == MASTERPID) {
+            for (int n = 0; n < v->num_nodos; n++) {
+                desplazamientos[n] = tramos[2*n] * columnas;
+                elems_envio[n] = tramos[2*n + 1] * columnas;
+            }
+        }
+
+        // Cada líder recibe directamente en la ventana, con el relleno SIMD de cada fila
+        MPI_Datatype tipo_fila = crear_tipo_fila(columnas, stride);
+        MPI_Scatterv(datos_globales, elems_envio, desplazamientos, MPI_FLOAT,
+                     v->filas, filas_nodo, tipo_fila, MASTERPID, v->comm_lideres);
+        MPI_Type_free(&tipo_fila);
+
+        // El halo (primera fila del nodo siguiente) se intercambia entre líderes, como entre procesos
+        intercambiar_halo(v->filas, filas_nodo, columnas, stride, pid_lider, v->num_nodos, v->comm_lideres);
+        free(tramos);
+        free(elems_envio);
+        free(desplazamientos);
+    }
+    ventana_nodo_sincronizar(v);
+}
+
+void ventana_nodo_sincronizar(VentanaNodo *v) {
+    MPI_Win_sync(v->ventana);
+    MPI_Barrier(v->comm_nodo);
+    MPI_Win_sync(v->ventana);
+}
+
+void ventana_nodo_liberar(VentanaNodo *v) {
+    MPI_Win_unlock_all(v->ventana);
+    MPI_Win_free(&v->ventana);
+    if (v->comm_lideres != MPI_COMM_NULL) MPI_Comm_free(&v->comm_lideres);
+    MPI_Comm_free(&v->comm_nodo);
+    v->filas = NULL;
+}
@@ -0,0 +1,47 @@
+#ifndef MEMORIA_NODO_H
+#define MEMORIA_NODO_H
+
+#include <mpi.h>
+
+// Dataset en memoria compartida por nodo (--memoria-compartida).
+// Los procesos de un mismo nodo (MPI_Comm_split_type con MPI_COMM_TYPE_SHARED) guardan sus
+// filas en una única ventana MPI_Win_allocate_shared: cada proceso recorre su tramo en el
+// sitio, sin copia propia, y el halo es simplemente la fila siguiente de la ventana. Entre
+// nodos solo viaja el tramo de cada nodo, que recibe su primer proceso (el líder).
+// Requiere que los procesos de cada nodo tengan rangos consecutivos (reparto por bloques).
+
+typedef struct {
+    MPI_Comm comm_nodo;     // Procesos que comparten memoria con este
+    MPI_Comm comm_lideres;  // Primer proceso de cada nodo (MPI_COMM_NULL en el resto)
+    MPI_Win ventana;
+    float *filas;           // Primera fila del nodo (la memoria la aporta el líder)
+    int fila_inicio;        // Fila global de filas[0]
+    int num_filas;          // Filas del nodo en la ventana, halo incluido
+    int primer_proceso;     // Rangos globales del primer y del último proceso del nodo
+    int ultimo_proceso;
+    int num_nodos;
+} VentanaNodo;
+
+// Colectiva sobre 'comm': agrupa los procesos por nodo, reserva la ventana de cada nodo y cada
+// proceso pone a 0 sus filas (primer toque con el reparto estático de sus hilos).
+// Devuelve 0 si todo es correcto, o -1 en todos los procesos si algún nodo no tiene rangos
+// consecutivos (en ese caso no queda nada reservado).
+int ventana_nodo_crear(VentanaNodo *v, const int *inicios, int stride, MPI_Comm comm);
+
+// Filas del proceso 'pid' (las propias seguidas del halo) dentro de la ventana de su nodo
+float* ventana_nodo_filas_proceso(const VentanaNodo *v, const int *inicios, int pid, int stride);
+
+// Filas que debe cargar 'pid' en la ventana: las propias, más el halo si es el último del nodo
+int ventana_nodo_filas_a_cargar(const VentanaNodo *v, const int *inicios, int num_procs, int pid);
+
+// Colectiva: el Master (datos_globales, filas * columnas sin relleno) envía a cada líder el
+// tramo de su nodo con un Scatterv entre líderes, y los líderes se pasan el halo.
+// Incluye la sincronización del nodo.
+void ventana_nodo_repartir(VentanaNodo *v, const float *datos_globales, int columnas, int stride);
+
+// Colectiva en el nodo: tras escribir en la ventana, hace visibles los datos a todos sus procesos
+void ventana_nodo_sincronizar(VentanaNodo *v);
+
+void ventana_nodo_liberar(VentanaNodo *v);
+
+#endif
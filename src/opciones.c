@@ -0,0 +1,184 @@
+/*
+ * src/opciones.c
+ * Parseo de las opciones "--nombre=valor" que acompañan a los argumentos posicionales.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "opciones.h"
+
+#define MASTERPID 0
+
+void opciones_por_defecto(OpcionesPrediccion *op) {
+    op->formato_salida = SALIDA_TEXTO;
+    op->capacidad_salida = 1024;
+    op->modo_lote = 0;
+    op->modo_segmentado = 0;
+    op->modo_persistente = 0;
+    op->afinidad = AFINIDAD_NINGUNA;
+    op->usar_mmap = 0;
+    op->memoria_compartida = 0;
+    op->simd = SIMD_AUTO;
+    op->compacto = COMPACTO_NINGUNO;
+    op->usar_poda = 0;
+    op->segmentos_poda = 4;
+    op->usar_indice = 0;
+    op->usar_lsh = 0;
+    op->lsh_tablas = 8;
+    op->lsh_hashes = 4;
+    op->lsh_ancho = 1.0f;
+    op->barrido_k = 0;
+    op->reparto = REPARTO_EQUITATIVO;
+    op->estrategia_topk = TOPK_AUTO;
+    op->ponderar_distancia = 0;
+    op->prefijo_traza = NULL;
+    op->ruta_continuo = NULL;
+    op->ruta_experimentos = NULL;
+}
+
+// Si 'arg' empieza por 'nombre=' devuelve un puntero al valor, si no NULL
+static const char* valor_opcion(const char *arg, const char *nombre) {
+    size_t n = strlen(nombre);
+    if (strncmp(arg, nombre, n) == 0 && arg[n] == '=') return arg + n + 1;
+    return NULL;
+}
+
+int parsear_opciones(OpcionesPrediccion *op, int argc, char *argv[], int inicio, int pid) {
+    for (int i = inicio; i < argc; i++) {
+        const char *arg = argv[i];
+        const char *valor;
+
+        if ((valor = valor_opcion(arg, "--salida")) != NULL) {
+            if (strcmp(valor, "texto") == 0) op->formato_salida = SALIDA_TEXTO;
+            else if (strcmp(valor, "binario") == 0) op->formato_salida = SALIDA_BINARIA;
+            else {
+                if (pid == MASTERPID) fprintf(stderr, "[ERROR] Formato de salida desconocido: %s\n", valor);
+                return -1;
+            }
+        } else if ((valor = valor_opcion(arg, "--buffer-salida")) != NULL) {
+            op->capacidad_salida = atoi(valor);
+            if (op->capacidad_salida < 1) op->capacidad_salida = 1;
+        } else if ((valor = valor_opcion(arg, "--simd")) != NULL) {
+            if (strcmp(valor, "auto") == 0) op->simd = SIMD_AUTO;
+            else if (strcmp(valor, "escalar") == 0) op->simd = SIMD_ESCALAR;
+            else if (strcmp(valor, "avx2") == 0) op->simd = SIMD_AVX2;
+            else if (strcmp(valor, "avx512") == 0) op->simd = SIMD_AVX512;
+            else {
+                if (pid == MASTERPID) fprintf(stderr, "[ERROR] Nivel SIMD desconocido: %s\n", valor);
+                return -1;
+            }
+        } else if ((valor = valor_opcion(arg, "--compacto")) != NULL) {
+            if (strcmp(valor, "int16") == 0) op->compacto = COMPACTO_INT16;
+            else if (strcmp(valor, "fp16") == 0) op->compacto = COMPACTO_FP16;
+            else if (strcmp(valor, "no") == 0) op->compacto = COMPACTO_NINGUNO;
+            else {
+                if (pid == MASTERPID) fprintf(stderr, "[ERROR] Formato compacto desconocido: %s\n", valor);
+                return -1;
+            }
+        } else if ((valor = valor_opcion(arg, "--reparto")) != NULL) {
+            if (strcmp(valor, "equitativo") == 0) op->reparto = REPARTO_EQUITATIVO;
+            else if (strcmp(valor, "ponderado") == 0) op->reparto = REPARTO_PONDERADO;
+            else {
+                if (pid == MASTERPID) fprintf(stderr, "[ERROR] Reparto desconocido: %s\n", valor);
+                return -1;
+            }
+        } else if ((valor = valor_opcion(arg, "--topk")) != NULL) {
+            if (strcmp(valor, "auto") == 0) op->estrategia_topk = TOPK_AUTO;
+            else if (strcmp(valor, "ordenado") == 0) op->estrategia_topk = TOPK_ORDENADO;
+            else if (strcmp(valor, "monticulo") == 0) op->estrategia_topk = TOPK_MONTICULO;
+            else if (strcmp(valor, "seleccion") == 0) op->estrategia_topk = TOPK_SELECCION;
+            else {
+                if (pid == MASTERPID) fprintf(stderr, "[ERROR] Estrategia top-k desconocida: %s\n", valor);
+                return -1;
+            }
+        } else if (strcmp(arg, "--ponderar") == 0) {
+            op->ponderar_distancia = 1;
+        } else if (strcmp(arg, "--traza") == 0) {
+            op->prefijo_traza = "traza";
+        } else if ((valor = valor_opcion(arg, "--traza")) != NULL) {
+            op->prefijo_traza = valor;
+        } else if ((valor = valor_opcion(arg, "--continuo")) != NULL) {
+            op->ruta_continuo = valor;
+        } else if ((valor = valor_opcion(arg, "--experimentos")) != NULL) {
+            op->ruta_experimentos = valor;
+        } else if ((valor = valor_opcion(arg, "--poda-segmentos")) != NULL) {
+            op->segmentos_poda = atoi(valor);
+            if (op->segmentos_poda < 1) op->segmentos_poda = 1;
+            op->usar_poda = 1;
+        } else if (strcmp(arg, "--poda") == 0) {
+            op->usar_poda = 1;
+        } else if ((valor = valor_opcion(arg, "--lsh-tablas")) != NULL) {
+            op->lsh_tablas = atoi(valor);
+            if (op->lsh_tablas < 1) op->lsh_tablas = 1;
+            op->usar_lsh = 1;
+        } else if ((valor = valor_opcion(arg, "--lsh-hashes")) != NULL) {
+            op->lsh_hashes = atoi(valor);
+            if (op->lsh_hashes < 1) op->lsh_hashes = 1;
+            op->usar_lsh = 1;
+        } else if ((valor = valor_opcion(arg, "--lsh-ancho")) != NULL) {
+            op->lsh_ancho = (float)atof(valor);
+            if (op->lsh_ancho <= 0.0f) {
+                if (pid == MASTERPID) fprintf(stderr, "[ERROR] El ancho LSH debe ser positivo: %s\n", valor);
+                return -1;
+            }
+            op->usar_lsh = 1;
+        } else if (strcmp(arg, "--lsh") == 0) {
+            op->usar_lsh = 1;
+        } else if (strcmp(arg, "--barrido") == 0) {
+            op->barrido_k = 1;
+        } else if (strcmp(arg, "--indice") == 0) {
+            op->usar_indice = 1;
+        } else if (strcmp(arg, "--lote") == 0) {
+            op->modo_lote = 1;
+        } else if ((valor = valor_opcion(arg, "--afinidad")) != NULL) {
+            if (strcmp(valor, "ninguna") == 0) op->afinidad = AFINIDAD_NINGUNA;
+            else if (strcmp(valor, "compacta") == 0) op->afinidad = AFINIDAD_COMPACTA;
+            else if (strcmp(valor, "dispersa") == 0) op->afinidad = AFINIDAD_DISPERSA;
+            else {
+                if (pid == MASTERPID) fprintf(stderr, "[ERROR] Afinidad desconocida: %s\n", valor);
+                return -1;
+            }
+        } else if (strcmp(arg, "--persistente") == 0) {
+            op->modo_persistente = 1;
+        } else if (strcmp(arg, "--segmentado") == 0) {
+            op->modo_segmentado = 1;
+        } else if (strcmp(arg, "--mmap") == 0) {
+            op->usar_mmap = 1;
+        } else if (strcmp(arg, "--memoria-compartida") == 0) {
+            op->memoria_compartida = 1;
+        } else {
+            if (pid == MASTERPID) fprintf(stderr, "[ERROR] Opción desconocida: %s\n", arg);
+            return -1;
+        }
+    }
+    return 0;
+}
+
+void imprimir_uso_opciones(void) {
+    printf("Opciones:\n");
+    printf("  --salida=texto|binario   Formato de Predicciones/MAPE (por defecto texto)\n");
+    printf("  --buffer-salida=N        Días en el buffer del escritor en segundo plano (por defecto 1024)\n");
+    printf("  --lote                   Evalúa todos los días en una sola pasada (1 Allreduce de patrones + 1 Allreduce de top-K + 1 Reduce de filas)\n");
+    printf("  --segmentado             Día a día con Ibcast/Iallreduce/Ireduce solapados con el cálculo\n");
+    printf("  --persistente            Día a día con una sola región paralela (barreras en vez de un equipo por día)\n");
+    printf("  --afinidad=ninguna|compacta|dispersa  Fija cada hilo a una CPU (compacta: consecutivas por proceso)\n");
+    printf("  --mmap                   Con dataset binario: mapear el fichero en vez de leerlo con MPI-IO\n");
+    printf("  --memoria-compartida     Una copia de los datos por nodo (MPI_Win_allocate_shared) en vez de una por proceso\n");
+    printf("  --simd=auto|escalar|avx2|avx512  Kernel de distancia (por defecto el mejor de la CPU)\n");
+    printf("  --compacto=int16|fp16    Recorrido sobre una copia de 16 bits por valor y reordenación exacta en float32 (mismos vecinos)\n");
+    printf("  --reparto=equitativo|ponderado  Filas por proceso iguales o según el rendimiento medido\n");
+    printf("  --topk=auto|ordenado|monticulo|seleccion  Selección de los K mejores (auto: ordenado hasta K=%d, después monticulo con --poda y seleccion sin ella)\n", TOPK_K_ORDENADO);
+    printf("  --ponderar               Predicción ponderada por el inverso de la distancia de cada vecino\n");
+    printf("  --traza[=prefijo]        Tiempos por fase, proceso e hilo en <prefijo>.json y <prefijo>_chrome.json (por defecto 'traza')\n");
+    printf("  --continuo=RUTA          Tras cargar el histórico, lee días nuevos de un FIFO/fichero ('-' = stdin) o de unix:/socket y responde con la predicción del siguiente\n");
+    printf("  --experimentos=FICHERO   Sin argumentos posicionales: ejecuta la matriz de FICHERO (ficheros K procesos hilos) en un solo lanzamiento\n");
+    printf("  --poda                   Descarta filas con cotas inferiores y abandono temprano (mismos vecinos)\n");
+    printf("  --poda-segmentos=N       Segmentos de la cota PAA (por defecto 4, máximo 16; implica --poda)\n");
+    printf("  --indice                 Búsqueda exacta con un VP-tree por hilo en lugar del recorrido lineal\n");
+    printf("  --barrido                Trata K como máximo: MAPE de cada k <= K en MAPE_por_k.txt y best_k.txt\n");
+    printf("  --lsh                    Predice con vecinos aproximados (LSH) y mide recall y MAPE frente a los exactos\n");
+    printf("  --lsh-tablas=L           Tablas hash (por defecto 8; más tablas = más recall)\n");
+    printf("  --lsh-hashes=M           Funciones por tabla (por defecto 4; más funciones = menos candidatos)\n");
+    printf("  --lsh-ancho=W            Ancho de cubo en desviaciones típicas (por defecto 1.0)\n");
+}
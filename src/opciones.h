@@ -0,0 +1,65 @@
+#ifndef OPCIONES_H
+#define OPCIONES_H
+
+#include "distancia.h"
+#include "vecinos.h"
+#include "compacto.h"
+
+// Formato de los ficheros de resultados (Predicciones / MAPE)
+typedef enum {
+    SALIDA_TEXTO = 0,   // Predicciones.txt y MAPE.txt (formato histórico)
+    SALIDA_BINARIA      // Predicciones.bin y MAPE.bin (float32 en crudo con cabecera)
+} FormatoSalida;
+
+// Reparto de filas entre procesos
+typedef enum {
+    REPARTO_EQUITATIVO = 0, // Mismo número de filas (±1) por proceso
+    REPARTO_PONDERADO       // Filas en proporción al rendimiento medido al arrancar
+} TipoReparto;
+
+// Fijación de hilos a CPUs (ver afinidad.h)
+typedef enum {
+    AFINIDAD_NINGUNA = 0,   // La decide el sistema operativo
+    AFINIDAD_COMPACTA,      // Hilos de un proceso en CPUs consecutivas
+    AFINIDAD_DISPERSA       // Hilos de un proceso repartidos entre las CPUs del nodo
+} TipoAfinidad;
+
+// Opciones de ejecución que no forman parte de los 4 argumentos posicionales.
+// Se pasan como "--nombre=valor" detrás de <hilos>.
+typedef struct {
+    FormatoSalida formato_salida;
+    int capacidad_salida;       // Días que caben en el buffer circular del escritor
+    int modo_lote;              // 1: todas las consultas en una sola pasada distribuida
+    int modo_segmentado;        // 1: día a día con comunicaciones no bloqueantes solapadas
+    int modo_persistente;       // 1: día a día con una sola región paralela para todo el bucle
+    TipoAfinidad afinidad;      // Fijación de los hilos a CPUs
+    int usar_mmap;              // Dataset binario: mapear en lugar de MPI_File_read_at_all
+    int memoria_compartida;     // Una copia del dataset por nodo en una ventana compartida
+    NivelSimd simd;             // Kernel de distancia (SIMD_AUTO = detección en tiempo de ejecución)
+    FormatoCompacto compacto;   // Recorrido lineal sobre una copia de 16 bits + reordenación exacta
+    int usar_poda;              // Cascada de cotas inferiores + abandono temprano (resultado exacto)
+    int segmentos_poda;         // Segmentos de la cota PAA
+    int usar_indice;            // VP-tree por hilo en lugar del recorrido lineal
+    int usar_lsh;               // Predicción con vecinos aproximados (LSH) + comparación con los exactos
+    int lsh_tablas;
+    int lsh_hashes;             // Funciones hash concatenadas por tabla
+    float lsh_ancho;            // Ancho de cubo en desviaciones típicas de la proyección
+    int barrido_k;              // 1: K es el máximo y se calcula el MAPE de todos los k <= K
+    TipoReparto reparto;
+    EstrategiaTopK estrategia_topk; // Selección de los K mejores en el recorrido lineal
+    int ponderar_distancia;     // 1: media ponderada por el inverso de la distancia
+    const char *prefijo_traza;  // --traza: prefijo de los ficheros de traza (NULL: sin traza)
+    const char *ruta_continuo;  // --continuo: FIFO, fichero o "unix:socket" con los días nuevos (NULL: sin modo continuo)
+    const char *ruta_experimentos; // --experimentos: fichero con la matriz de configuraciones (ver experimentos.h)
+} OpcionesPrediccion;
+
+// Rellena 'op' con los valores por defecto
+void opciones_por_defecto(OpcionesPrediccion *op);
+
+// Parsea argv[inicio..argc-1]. Devuelve 0 si todo es correcto, -1 si hay una opción desconocida.
+int parsear_opciones(OpcionesPrediccion *op, int argc, char *argv[], int inicio, int pid);
+
+// Imprime la ayuda de las opciones (solo tiene sentido en el Master)
+void imprimir_uso_opciones(void);
+
+#endif
@@ -0,0 +1,95 @@
+/*
+ * src/poda.c
+ * Precálculo de las cotas inferiores (normas y medias por segmento) usadas para
+ * descartar filas sin calcular su distancia completa.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include <omp.h>
+#include "poda.h"
+
+// Normas y medias en double para que el único error relevante sea el del float guardado
+static void resumir_vector(const float *v, int columnas, int segmentos, const int *limites,
+                           double *norma, float *medias) {
+    double suma_cuadrados = 0.0;
+    for (int s = 0; s < segmentos; s++) {
+        double suma = 0.0;
+        for (int j = limites[s]; j < limites[s + 1]; j++) {
+            suma += v[j];
+            suma_cuadrados += (double)v[j] * v[j];
+        }
+        medias[s] = (float)(suma / (limites[s + 1] - limites[s]));
+    }
+    (void)columnas;
+    *norma = sqrt(suma_cuadrados);
+}
+
+ResumenPoda* poda_construir(const float *datos, int filas, int stride, int columnas, int segmentos) {
+    if (segmentos < 1) segmentos = 1;
+    if (segmentos > PODA_MAX_SEGMENTOS) segmentos = PODA_MAX_SEGMENTOS;
+    if (segmentos > columnas) segmentos = columnas;
+
+    ResumenPoda *r = (ResumenPoda *)calloc(1, sizeof(ResumenPoda));
+    if (r == NULL) return NULL;
+    r->filas = filas;
+    r->capacidad = filas > 0 ? filas : 1;
+    r->columnas = columnas;
+    r->segmentos = segmentos;
+    for (int s = 0; s <= segmentos; s++) r->limites[s] = (int)((long)s * columnas / segmentos);
+
+    r->normas = (double *)malloc((filas > 0 ? filas : 1) * sizeof(double));
+    r->medias = (float *)malloc((long)(filas > 0 ? filas : 1) * segmentos * sizeof(float));
+    if (r->normas == NULL || r->medias == NULL) {
+        poda_liberar(r);
+        return NULL;
+    }
+
+    #pragma omp parallel for schedule(static)
+    for (int i = 0; i < filas; i++) {
+        resumir_vector(&datos[(long)i * stride], columnas, segmentos, r->limites,
+                       &r->normas[i], &r->medias[(long)i * segmentos]);
+    }
+    return r;
+}
+
+void poda_liberar(ResumenPoda *r) {
+    if (r == NULL) return;
+    free(r->normas);
+    free(r->medias);
+    free(r);
+}
+
+int poda_ampliar(ResumenPoda *r, const float *datos, int filas, int stride) {
+    if (filas > r->capacidad) {
+        // Capacidad doble: añadir una fila cuesta O(1) amortizado
+        int capacidad = 2 * r->capacidad;
+        if (capacidad < filas) capacidad = filas;
+        double *normas = (double *)realloc(r->normas, capacidad * sizeof(double));
+        if (normas == NULL) return -1;
+        r->normas = normas;
+        float *medias = (float *)realloc(r->medias, (long)capacidad * r->segmentos * sizeof(float));
+        if (medias == NULL) return -1;
+        r->medias = medias;
+        r->capacidad = capacidad;
+    }
+    for (int i = r->filas; i < filas; i++) {
+        resumir_vector(&datos[(long)i * stride], r->columnas, r->segmentos, r->limites,
+                       &r->normas[i], &r->medias[(long)i * r->segmentos]);
+    }
+    r->filas = filas;
+    return 0;
+}
+
+void poda_resumir_patron(const ResumenPoda *r, const float *patron, ResumenPatron *rp) {
+    resumir_vector(patron, r->columnas, r->segmentos, r->limites, &rp->norma, rp->medias);
+}
+
+void poda_sumar_contadores(ContadoresPoda *total, const ContadoresPoda *parcial) {
+    total->evaluadas += parcial->evaluadas;
+    total->podadas_norma += parcial->podadas_norma;
+    total->podadas_paa += parcial->podadas_paa;
+    total->podadas_exacta += parcial->podadas_exacta;
+    total->aceptadas += parcial->aceptadas;
+}
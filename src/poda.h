@@ -0,0 +1,76 @@
+#ifndef PODA_H
+#define PODA_H
+
+#include <math.h>
+
+// Cascada de poda exacta para el recorrido de fuerza bruta:
+//   1. Cota de normas:  (|a| - |b|)^2 <= |a - b|^2              (8 bytes por fila)
+//   2. Cota PAA:        sum_s L_s * (media_a_s - media_b_s)^2 <= |a - b|^2  (S floats por fila)
+//   3. Distancia exacta con abandono temprano contra el K-ésimo mejor actual.
+// Las cotas se multiplican por (1 - PODA_MARGEN) antes de comparar, para cubrir el error de
+// redondeo del kernel float32: una fila solo se descarta si su distancia calculada tampoco
+// habría entrado en la lista, así que los vecinos son exactamente los de la fuerza bruta.
+
+#define PODA_MARGEN 1e-4
+#define PODA_MAX_SEGMENTOS 16
+
+// Resúmenes precalculados de las filas locales
+typedef struct {
+    int filas;
+    int capacidad;                        // Filas que caben en normas/medias (ver poda_ampliar)
+    int columnas;
+    int segmentos;
+    int limites[PODA_MAX_SEGMENTOS + 1];  // Columnas [limites[s], limites[s+1]) forman el segmento s
+    double *normas;                       // filas
+    float *medias;                        // filas * segmentos
+} ResumenPoda;
+
+// Resumen de un patrón de consulta (mismo formato que una fila)
+typedef struct {
+    double norma;
+    float medias[PODA_MAX_SEGMENTOS];
+} ResumenPatron;
+
+// Cuántas filas se descartan en cada etapa
+typedef struct {
+    long evaluadas;        // Filas que pasan el corte causal
+    long podadas_norma;
+    long podadas_paa;
+    long podadas_exacta;   // Descartadas por la distancia con abandono temprano
+    long aceptadas;        // Insertadas en la lista del hilo
+} ContadoresPoda;
+
+#define PODA_NUM_CONTADORES 5
+
+// Calcula normas y medias por segmento de las filas (en paralelo con OpenMP)
+ResumenPoda* poda_construir(const float *datos, int filas, int stride, int columnas, int segmentos);
+void poda_liberar(ResumenPoda *r);
+
+// Añade los resúmenes de las filas [r->filas, filas) de 'datos' (modo continuo). Devuelve 0 si
+// todo va bien, -1 si no hay memoria (el resumen queda como estaba).
+int poda_ampliar(ResumenPoda *r, const float *datos, int filas, int stride);
+
+void poda_resumir_patron(const ResumenPoda *r, const float *patron, ResumenPatron *rp);
+
+void poda_sumar_contadores(ContadoresPoda *total, const ContadoresPoda *parcial);
+
+// Cota inferior por normas de la fila 'i'
+static inline double poda_cota_norma(const ResumenPoda *r, long i, const ResumenPatron *rp) {
+    double d = r->normas[i] - rp->norma;
+    return d * d * (1.0 - PODA_MARGEN);
+}
+
+// Cota inferior PAA de la fila 'i'. A cada diferencia de medias se le resta el posible
+// error de redondeo de guardarlas en float antes de elevarla al cuadrado.
+static inline double poda_cota_paa(const ResumenPoda *r, long i, const ResumenPatron *rp) {
+    const float *m = &r->medias[i * r->segmentos];
+    double cota = 0.0;
+    for (int s = 0; s < r->segmentos; s++) {
+        double d = fabs((double)m[s] - (double)rp->medias[s]);
+        d -= (fabs((double)m[s]) + fabs((double)rp->medias[s])) * 1.2e-7;
+        if (d > 0.0) cota += (r->limites[s + 1] - r->limites[s]) * d * d;
+    }
+    return cota * (1.0 - PODA_MARGEN);
+}
+
+#endif
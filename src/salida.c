@@ -0,0 +1,164 @@
+/*
+ * src/salida.c
+ * Escritura de Predicciones y MAPE con un hilo en segundo plano.
+ * Antes se hacía fopen/fclose en modo append por cada día predicho; ahora los ficheros
+ * se abren una vez, con un buffer de stdio grande, y se vuelcan por bloques.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "salida.h"
+#include "traza.h"
+
+#define TAM_BUFFER_STDIO (1 << 20)
+
+// Vuelca 'n' días consecutivos del buffer circular empezando en 'inicio'
+static void volcar_bloque(EscritorResultados *e, int inicio, int n) {
+    const float *pred = &e->predicciones[(long)inicio * e->columnas];
+    const float *mape = &e->mapes[inicio];
+
+    if (e->formato == SALIDA_BINARIA) {
+        if (e->f_pred) fwrite(pred, sizeof(float), (size_t)n * e->columnas, e->f_pred);
+        if (e->f_mape) fwrite(mape, sizeof(float), (size_t)n, e->f_mape);
+        return;
+    }
+
+    // Formato de texto idéntico al original: "%.2f " por valor y salto de línea por día
+    if (e->f_pred) {
+        for (int d = 0; d < n; d++) {
+            for (int h = 0; h < e->columnas; h++) fprintf(e->f_pred, "%.2f ", pred[d * e->columnas + h]);
+            fputc('\n', e->f_pred);
+        }
+    }
+    if (e->f_mape) {
+        for (int d = 0; d < n; d++) fprintf(e->f_mape, "%.2f\n", mape[d]);
+    }
+}
+
+// Bucle del hilo escritor: espera datos, los vuelca fuera del cerrojo y libera el hueco
+static void* hilo_escritor(void *arg) {
+    EscritorResultados *e = (EscritorResultados *)arg;
+
+    pthread_mutex_lock(&e->cerrojo);
+    for (;;) {
+        while (e->ocupados == 0 && !e->terminar) pthread_cond_wait(&e->hay_datos, &e->cerrojo);
+        if (e->ocupados == 0 && e->terminar) break;
+
+        int inicio = e->cabeza;
+        int n = e->ocupados;
+        pthread_mutex_unlock(&e->cerrojo);
+
+        // El productor no toca estos huecos hasta que descontemos 'ocupados'
+        int tramo = (inicio + n <= e->capacidad) ? n : e->capacidad - inicio;
+        double t_traza = traza_ahora();
+        volcar_bloque(e, inicio, tramo);
+        if (tramo < n) volcar_bloque(e, 0, n - tramo);
+        if (traza_activa) traza_anotar(TRAZA_ESCRITURA, t_traza, omp_get_wtime(), TRAZA_HILO_ESCRITOR);
+
+        pthread_mutex_lock(&e->cerrojo);
+        e->cabeza = (inicio + n) % e->capacidad;
+        e->ocupados -= n;
+        e->escritos += n;
+        pthread_cond_signal(&e->hay_hueco);
+    }
+    pthread_mutex_unlock(&e->cerrojo);
+    return NULL;
+}
+
+static FILE* abrir_salida(const char *nombre, const char *modo, int columnas) {
+    FILE *f = fopen(nombre, modo);
+    if (f == NULL) {
+        fprintf(stderr, "[AVISO] No se pudo abrir %s, no se guardarán esos resultados.\n", nombre);
+        return NULL;
+    }
+    setvbuf(f, NULL, _IOFBF, TAM_BUFFER_STDIO);
+    if (modo[1] == 'b') {
+        // Reservamos la cabecera; el número de filas se completa al cerrar
+        CabeceraSalida cab = { SALIDA_MAGIC, SALIDA_VERSION, 0, columnas };
+        fwrite(&cab, sizeof(cab), 1, f);
+    }
+    return f;
+}
+
+static void cerrar_salida(FILE *f, FormatoSalida formato, int filas, int columnas) {
+    if (f == NULL) return;
+    if (formato == SALIDA_BINARIA) {
+        CabeceraSalida cab = { SALIDA_MAGIC, SALIDA_VERSION, filas, columnas };
+        fflush(f);
+        fseek(f, 0, SEEK_SET);
+        fwrite(&cab, sizeof(cab), 1, f);
+    }
+    fclose(f);
+}
+
+EscritorResultados* escritor_crear(FormatoSalida formato, int columnas, int capacidad) {
+    EscritorResultados *e = (EscritorResultados *)calloc(1, sizeof(EscritorResultados));
+    if (e == NULL) return NULL;
+
+    e->formato = formato;
+    e->columnas = columnas;
+    e->capacidad = (capacidad > 0) ? capacidad : 1;
+    e->predicciones = (float *)malloc((size_t)e->capacidad * columnas * sizeof(float));
+    e->mapes = (float *)malloc((size_t)e->capacidad * sizeof(float));
+    if (e->predicciones == NULL || e->mapes == NULL) {
+        free(e->predicciones); free(e->mapes); free(e);
+        return NULL;
+    }
+
+    if (formato == SALIDA_BINARIA) {
+        e->f_pred = abrir_salida("Predicciones.bin", "wb", columnas);
+        e->f_mape = abrir_salida("MAPE.bin", "wb", 1);
+    } else {
+        e->f_pred = abrir_salida("Predicciones.txt", "w", columnas);
+        e->f_mape = abrir_salida("MAPE.txt", "w", 1);
+    }
+
+    pthread_mutex_init(&e->cerrojo, NULL);
+    pthread_cond_init(&e->hay_datos, NULL);
+    pthread_cond_init(&e->hay_hueco, NULL);
+    if (pthread_create(&e->hilo, NULL, hilo_escritor, e) != 0) {
+        fprintf(stderr, "[ERROR] No se pudo crear el hilo escritor.\n");
+        cerrar_salida(e->f_pred, formato, 0, columnas);
+        cerrar_salida(e->f_mape, formato, 0, 1);
+        pthread_mutex_destroy(&e->cerrojo);
+        pthread_cond_destroy(&e->hay_datos);
+        pthread_cond_destroy(&e->hay_hueco);
+        free(e->predicciones); free(e->mapes); free(e);
+        return NULL;
+    }
+    return e;
+}
+
+void escritor_encolar(EscritorResultados *e, const float *prediccion, float mape) {
+    pthread_mutex_lock(&e->cerrojo);
+    while (e->ocupados == e->capacidad) pthread_cond_wait(&e->hay_hueco, &e->cerrojo);
+
+    int hueco = (e->cabeza + e->ocupados) % e->capacidad;
+    memcpy(&e->predicciones[(long)hueco * e->columnas], prediccion, e->columnas * sizeof(float));
+    e->mapes[hueco] = mape;
+    e->ocupados++;
+
+    pthread_cond_signal(&e->hay_datos);
+    pthread_mutex_unlock(&e->cerrojo);
+}
+
+void escritor_cerrar(EscritorResultados *e) {
+    if (e == NULL) return;
+
+    pthread_mutex_lock(&e->cerrojo);
+    e->terminar = 1;
+    pthread_cond_signal(&e->hay_datos);
+    pthread_mutex_unlock(&e->cerrojo);
+    pthread_join(e->hilo, NULL);
+
+    cerrar_salida(e->f_pred, e->formato, e->escritos, e->columnas);
+    cerrar_salida(e->f_mape, e->formato, e->escritos, 1);
+
+    pthread_mutex_destroy(&e->cerrojo);
+    pthread_cond_destroy(&e->hay_datos);
+    pthread_cond_destroy(&e->hay_hueco);
+    free(e->predicciones);
+    free(e->mapes);
+    free(e);
+}
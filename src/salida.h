@@ -0,0 +1,52 @@
+#ifndef SALIDA_H
+#define SALIDA_H
+
+#include <stdio.h>
+#include <pthread.h>
+#include "opciones.h"
+
+// Cabecera de los ficheros binarios de resultados (Predicciones.bin / MAPE.bin)
+#define SALIDA_MAGIC   0x504E4E4B  // "KNNP" en little-endian
+#define SALIDA_VERSION 1
+
+typedef struct {
+    int magic;
+    int version;
+    int filas;      // Días escritos (se actualiza al cerrar)
+    int columnas;   // Valores por día (1 en MAPE.bin)
+} CabeceraSalida;
+
+// Escritor de resultados en segundo plano.
+// El Master encola cada día en un buffer circular y un hilo aparte lo vuelca a disco,
+// así los ficheros se abren una sola vez y las llamadas al sistema no frenan el bucle de cálculo.
+typedef struct {
+    FormatoSalida formato;
+    int columnas;
+    int capacidad;          // Días que caben en el buffer circular
+
+    float *predicciones;    // capacidad * columnas
+    float *mapes;           // capacidad
+    int cabeza;             // Siguiente día a escribir
+    int ocupados;           // Días pendientes en el buffer
+    int terminar;           // El productor ya no va a encolar más
+    int escritos;
+
+    FILE *f_pred;
+    FILE *f_mape;
+
+    pthread_t hilo;
+    pthread_mutex_t cerrojo;
+    pthread_cond_t hay_datos;
+    pthread_cond_t hay_hueco;
+} EscritorResultados;
+
+// Abre los ficheros (truncándolos) y arranca el hilo escritor. Devuelve NULL si falla.
+EscritorResultados* escritor_crear(FormatoSalida formato, int columnas, int capacidad);
+
+// Copia la predicción del día y su MAPE al buffer (bloquea solo si el buffer está lleno)
+void escritor_encolar(EscritorResultados *e, const float *prediccion, float mape);
+
+// Espera a que se vacíe el buffer, cierra los ficheros y libera el escritor
+void escritor_cerrar(EscritorResultados *e);
+
+#endif
@@ -0,0 +1,371 @@
+/*
+ * src/traza.c
+ * Instrumentación por ámbitos con un buffer por hilo y exportación a JSON y Chrome trace.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdarg.h>
+#include <math.h>
+#include "traza.h"
+
+#define MASTERPID 0
+#define TRAZA_EVENTOS_INICIALES 1024
+
+static const char *nombres_ambitos[TRAZA_NUM_AMBITOS] = {
+    "lectura", "parseo", "reparto", "difusion", "recorrido",
+    "fusion_hilos", "reduccion_topk", "reunion_filas", "prediccion", "escritura"
+};
+
+static const char *nombres_contadores[TRAZA_NUM_CONTADORES] = {
+    "filas_recorridas", "candidatos_insertados"
+};
+
+typedef struct {
+    double inicio;          // Segundos desde el origen de la traza
+    double duracion;
+    int ambito;
+} EventoTraza;
+
+// Un buffer por hilo, cada uno en sus propias líneas de caché
+typedef struct {
+    EventoTraza *eventos;
+    long num_eventos;
+    long capacidad;
+    long contadores[TRAZA_NUM_CONTADORES];
+} __attribute__((aligned(64))) BufferTraza;
+
+int traza_activa = 0;
+
+static BufferTraza *buffers = NULL;
+static int num_buffers = 0;     // Hilos OpenMP + el escritor (el último)
+static double origen = 0.0;
+static int error_memoria = 0;
+
+void traza_iniciar(int activa, int max_hilos, MPI_Comm comm) {
+    traza_activa = 0;
+    if (!activa) return;
+
+    num_buffers = max_hilos + 1;
+    buffers = (BufferTraza *)aligned_alloc(64, num_buffers * sizeof(BufferTraza));
+    if (buffers == NULL) {
+        fprintf(stderr, "[ERROR] Sin memoria para la traza\n");
+        MPI_Abort(MPI_COMM_WORLD, EXIT_FAILURE);
+    }
+    memset(buffers, 0, num_buffers * sizeof(BufferTraza));
+
+    MPI_Barrier(comm);
+    origen = omp_get_wtime();
+    traza_activa = 1;
+}
+
+static BufferTraza* buffer_hilo(int hilo) {
+    if (hilo == TRAZA_HILO_ESCRITOR) return &buffers[num_buffers - 1];
+    if (hilo < 0 || hilo >= num_buffers - 1) return NULL;
+    return &buffers[hilo];
+}
+
+void traza_anotar(AmbitoTraza ambito, double inicio, double fin, int hilo) {
+    BufferTraza *b = buffer_hilo(hilo);
+    if (b == NULL) return;
+    if (b->num_eventos == b->capacidad) {
+        long nueva = (b->capacidad > 0) ? 2 * b->capacidad : TRAZA_EVENTOS_INICIALES;
+        EventoTraza *eventos = (EventoTraza *)realloc(b->eventos, nueva * sizeof(EventoTraza));
+        if (eventos == NULL) {
+            // Se pierden los eventos siguientes de este hilo, no la ejecución
+            error_memoria = 1;
+            return;
+        }
+        b->eventos = eventos;
+        b->capacidad = nueva;
+    }
+    EventoTraza *e = &b->eventos[b->num_eventos++];
+    e->inicio = inicio - origen;
+    e->duracion = fin - inicio;
+    e->ambito = (int)ambito;
+}
+
+void traza_sumar(ContadorTraza contador, long valor, int hilo) {
+    BufferTraza *b = buffer_hilo(hilo);
+    if (b != NULL) b->contadores[contador] += valor;
+}
+
+// Texto que crece según se escribe (los fragmentos JSON de cada proceso)
+typedef struct {
+    char *datos;
+    size_t longitud;
+    size_t capacidad;
+} TextoTraza;
+
+static void texto_anadir(TextoTraza *t, const char *formato, ...) {
+    va_list args;
+    va_start(args, formato);
+    va_list copia;
+    va_copy(copia, args);
+    int n = vsnprintf(NULL, 0, formato, copia);
+    va_end(copia);
+
+    if (n > 0 && t->longitud + n + 1 > t->capacidad) {
+        size_t nueva = (t->capacidad > 0) ? t->capacidad : 4096;
+        while (nueva < t->longitud + n + 1) nueva *= 2;
+        char *datos = (char *)realloc(t->datos, nueva);
+        if (datos == NULL) {
+            fprintf(stderr, "[ERROR] Sin memoria para exportar la traza\n");
+            MPI_Abort(MPI_COMM_WORLD, EXIT_FAILURE);
+        }
+        t->datos = datos;
+        t->capacidad = nueva;
+    }
+    if (n > 0) {
+        vsnprintf(t->datos + t->longitud, t->capacidad - t->longitud, formato, args);
+        t->longitud += n;
+    }
+    va_end(args);
+}
+
+static int comparar_double(const void *a, const void *b) {
+    double x = *(const double *)a, y = *(const double *)b;
+    return (x > y) - (x < y);
+}
+
+// Percentil por rango más cercano sobre valores ya ordenados
+static double percentil(const double *ordenados, long n, double p) {
+    long idx = (long)ceil(p * n) - 1;
+    if (idx < 0) idx = 0;
+    if (idx >= n) idx = n - 1;
+    return ordenados[idx];
+}
+
+// Estadísticas de los hilos de este proceso. En 'totales' deja, por ámbito, el tiempo del hilo
+// que más acumula (el que marca el ritmo del proceso).
+static void fragmento_proceso(int pid, TextoTraza *t, double *totales) {
+    long max_eventos = 0;
+    for (int h = 0; h < num_buffers; h++) {
+        if (buffers[h].num_eventos > max_eventos) max_eventos = buffers[h].num_eventos;
+    }
+    double *duraciones = (double *)malloc((max_eventos > 0 ? max_eventos : 1) * sizeof(double));
+    if (duraciones == NULL) {
+        fprintf(stderr, "[ERROR P%d] Sin memoria para exportar la traza\n", pid);
+        MPI_Abort(MPI_COMM_WORLD, EXIT_FAILURE);
+    }
+    for (int a = 0; a < TRAZA_NUM_AMBITOS; a++) totales[a] = 0.0;
+
+    texto_anadir(t, "    {\"pid\": %d, \"hilos\": [", pid);
+    int primero_hilo = 1;
+    for (int h = 0; h < num_buffers; h++) {
+        const BufferTraza *b = &buffers[h];
+        int con_contadores = 0;
+        for (int c = 0; c < TRAZA_NUM_CONTADORES; c++) con_contadores |= (b->contadores[c] != 0);
+        if (b->num_eventos == 0 && !con_contadores) continue;
+
+        if (h == num_buffers - 1) texto_anadir(t, "%s\n      {\"hilo\": \"escritor\", \"ambitos\": {", primero_hilo ? "" : ",");
+        else texto_anadir(t, "%s\n      {\"hilo\": %d, \"ambitos\": {", primero_hilo ? "" : ",", h);
+        primero_hilo = 0;
+
+        int primero_ambito = 1;
+        for (int a = 0; a < TRAZA_NUM_AMBITOS; a++) {
+            long n = 0;
+            double total = 0.0;
+            for (long e = 0; e < b->num_eventos; e++) {
+                if (b->eventos[e].ambito != a) continue;
+                duraciones[n++] = b->eventos[e].duracion;
+                total += b->eventos[e].duracion;
+            }
+            if (n == 0) continue;
+            qsort(duraciones, n, sizeof(double), comparar_double);
+            if (total > totales[a]) totales[a] = total;
+            texto_anadir(t, "%s\n        \"%s\": {\"n\": %ld, \"total\": %.6f, \"min\": %.6f, \"max\": %.6f, "
+                         "\"p50\": %.6f, \"p95\": %.6f, \"p99\": %.6f}",
+                         primero_ambito ? "" : ",", nombres_ambitos[a], n, total, duraciones[0], duraciones[n - 1],
+                         percentil(duraciones, n, 0.50), percentil(duraciones, n, 0.95), percentil(duraciones, n, 0.99));
+            primero_ambito = 0;
+        }
+        texto_anadir(t, "}, \"contadores\": {");
+        for (int c = 0; c < TRAZA_NUM_CONTADORES; c++) {
+            texto_anadir(t, "%s\"%s\": %ld", c ? ", " : "", nombres_contadores[c], b->contadores[c]);
+        }
+        texto_anadir(t, "}}");
+    }
+    texto_anadir(t, "\n    ]}");
+    free(duraciones);
+}
+
+// Eventos de este proceso en formato Chrome trace ("X": intervalo completo, en microsegundos)
+static void fragmento_chrome(int pid, TextoTraza *t) {
+    texto_anadir(t, "  {\"name\": \"process_name\", \"ph\": \"M\", \"pid\": %d, \"args\": {\"name\": \"P%d\"}}", pid, pid);
+    for (int h = 0; h < num_buffers; h++) {
+        const BufferTraza *b = &buffers[h];
+        if (b->num_eventos == 0) continue;
+        int tid = h;
+        if (h == num_buffers - 1) {
+            texto_anadir(t, ",\n  {\"name\": \"thread_name\", \"ph\": \"M\", \"pid\": %d, \"tid\": %d, \"args\": {\"name\": \"escritor\"}}",
+                         pid, tid);
+        } else {
+            texto_anadir(t, ",\n  {\"name\": \"thread_name\", \"ph\": \"M\", \"pid\": %d, \"tid\": %d, \"args\": {\"name\": \"hilo %d\"}}",
+                         pid, tid, h);
+        }
+        for (long e = 0; e < b->num_eventos; e++) {
+            const EventoTraza *ev = &b->eventos[e];
+            texto_anadir(t, ",\n  {\"name\": \"%s\", \"ph\": \"X\", \"pid\": %d, \"tid\": %d, \"ts\": %.3f, \"dur\": %.3f}",
+                         nombres_ambitos[ev->ambito], pid, tid, ev->inicio * 1e6, ev->duracion * 1e6);
+        }
+    }
+}
+
+// Reúne en el Master (con '\0' al final) los fragmentos de todos los procesos
+static char* reunir_texto(const TextoTraza *t, int pid, int num_procs, int **longitudes, MPI_Comm comm) {
+    int mi_longitud = (int)t->longitud;
+    int *desplazamientos = NULL;
+    char *todo = NULL;
+    if (pid == MASTERPID) {
+        *longitudes = (int *)malloc(num_procs * sizeof(int));
+        desplazamientos = (int *)malloc(num_procs * sizeof(int));
+        if (*longitudes == NULL || desplazamientos == NULL) {
+            fprintf(stderr, "[ERROR] Sin memoria para reunir la traza\n");
+            MPI_Abort(MPI_COMM_WORLD, EXIT_FAILURE);
+        }
+    }
+    MPI_Gather(&mi_longitud, 1, MPI_INT, pid == MASTERPID ? *longitudes : NULL, 1, MPI_INT, MASTERPID, comm);
+
+    long total = 0;
+    if (pid == MASTERPID) {
+        for (int p = 0; p < num_procs; p++) {
+            desplazamientos[p] = (int)total;
+            total += (*longitudes)[p];
+        }
+        todo = (char *)malloc(total + 1);
+        if (todo == NULL) {
+            fprintf(stderr, "[ERROR] Sin memoria para reunir la traza\n");
+            MPI_Abort(MPI_COMM_WORLD, EXIT_FAILURE);
+        }
+        todo[total] = '\0';
+    }
+    MPI_Gatherv(t->datos, mi_longitud, MPI_CHAR, todo, pid == MASTERPID ? *longitudes : NULL, desplazamientos,
+                MPI_CHAR, MASTERPID, comm);
+    free(desplazamientos);
+    return todo;
+}
+
+void traza_exportar(const char *prefijo, MPI_Comm comm) {
+    if (!traza_activa) return;
+    traza_activa = 0;
+
+    int pid, num_procs;
+    MPI_Comm_rank(comm, &pid);
+    MPI_Comm_size(comm, &num_procs);
+
+    TextoTraza estadisticas = {0}, chrome = {0};
+    double totales[TRAZA_NUM_AMBITOS];
+    fragmento_proceso(pid, &estadisticas, totales);
+    fragmento_chrome(pid, &chrome);
+
+    double *totales_procesos = NULL;
+    if (pid == MASTERPID) {
+        totales_procesos = (double *)malloc((long)num_procs * TRAZA_NUM_AMBITOS * sizeof(double));
+        if (totales_procesos == NULL) {
+            fprintf(stderr, "[ERROR] Sin memoria para reunir la traza\n");
+            MPI_Abort(MPI_COMM_WORLD, EXIT_FAILURE);
+        }
+    }
+    MPI_Gather(totales, TRAZA_NUM_AMBITOS, MPI_DOUBLE, totales_procesos, TRAZA_NUM_AMBITOS, MPI_DOUBLE, MASTERPID, comm);
+
+    int *longitudes_est = NULL, *longitudes_chrome = NULL;
+    char *todo_est = reunir_texto(&estadisticas, pid, num_procs, &longitudes_est, comm);
+    char *todo_chrome = reunir_texto(&chrome, pid, num_procs, &longitudes_chrome, comm);
+    free(estadisticas.datos);
+    free(chrome.datos);
+
+    int errores = 0;
+    MPI_Reduce(&error_memoria, &errores, 1, MPI_INT, MPI_MAX, MASTERPID, comm);
+
+    if (pid == MASTERPID) {
+        char nombre[1024];
+        snprintf(nombre, sizeof(nombre), "%s.json", prefijo);
+        FILE *f = fopen(nombre, "w");
+        // Resumen por pantalla: el reparto del recorrido entre procesos
+        double desequilibrio_recorrido = 0.0;
+        int lento_recorrido = -1;
+        if (f) {
+            fprintf(f, "{\n  \"procesos\": %d,\n  \"hilos\": %d,\n  \"ambitos\": {", num_procs, num_buffers - 1);
+            int primero = 1;
+            for (int a = 0; a < TRAZA_NUM_AMBITOS; a++) {
+                // Reparto del ámbito entre procesos: el desequilibrio es el más lento frente a la media
+                double minimo = 0.0, maximo = 0.0, suma = 0.0;
+                int mas_lento = 0;
+                for (int p = 0; p < num_procs; p++) {
+                    double v = totales_procesos[(long)p * TRAZA_NUM_AMBITOS + a];
+                    if (p == 0 || v < minimo) minimo = v;
+                    if (p == 0 || v > maximo) {
+                        maximo = v;
+                        mas_lento = p;
+                    }
+                    suma += v;
+                }
+                if (maximo == 0.0) continue;
+                double media = suma / num_procs;
+                double desequilibrio = maximo / media;
+                fprintf(f, "%s\n    \"%s\": {\"por_proceso\": [", primero ? "" : ",", nombres_ambitos[a]);
+                for (int p = 0; p < num_procs; p++) {
+                    fprintf(f, "%s%.6f", p ? ", " : "", totales_procesos[(long)p * TRAZA_NUM_AMBITOS + a]);
+                }
+                fprintf(f, "], \"min\": %.6f, \"max\": %.6f, \"media\": %.6f, \"desequilibrio\": %.4f, \"mas_lento\": %d}",
+                        minimo, maximo, media, desequilibrio, mas_lento);
+                primero = 0;
+                if (a == TRAZA_RECORRIDO) {
+                    desequilibrio_recorrido = desequilibrio;
+                    lento_recorrido = mas_lento;
+                }
+            }
+            fprintf(f, "\n  },\n  \"detalle\": [\n");
+            // Los fragmentos van seguidos: se separan con comas en el límite de cada proceso
+            long pos = 0;
+            for (int p = 0; p < num_procs; p++) {
+                fprintf(f, "%s%.*s", p ? ",\n" : "", longitudes_est[p], &todo_est[pos]);
+                pos += longitudes_est[p];
+            }
+            fprintf(f, "\n  ]\n}\n");
+            fclose(f);
+        } else {
+            fprintf(stderr, "[AVISO] No se pudo escribir %s\n", nombre);
+        }
+
+        char nombre_chrome[1024];
+        snprintf(nombre_chrome, sizeof(nombre_chrome), "%s_chrome.json", prefijo);
+        FILE *fc = fopen(nombre_chrome, "w");
+        if (fc) {
+            fprintf(fc, "{\"displayTimeUnit\": \"ms\", \"traceEvents\": [\n");
+            long pos = 0;
+            for (int p = 0; p < num_procs; p++) {
+                fprintf(fc, "%s%.*s", p ? ",\n" : "", longitudes_chrome[p], &todo_chrome[pos]);
+                pos += longitudes_chrome[p];
+            }
+            fprintf(fc, "\n]}\n");
+            fclose(fc);
+        } else {
+            fprintf(stderr, "[AVISO] No se pudo escribir %s\n", nombre_chrome);
+        }
+
+        printf("[TRAZA] %s y %s", nombre, nombre_chrome);
+        if (lento_recorrido >= 0) {
+            printf(" (recorrido: desequilibrio %.2f entre procesos, el mas lento es P%d)",
+                   desequilibrio_recorrido, lento_recorrido);
+        }
+        printf("\n");
+        if (errores) fprintf(stderr, "[AVISO] La traza está incompleta: faltó memoria para algunos eventos\n");
+
+        free(totales_procesos);
+        free(longitudes_est);
+        free(longitudes_chrome);
+    }
+    free(todo_est);
+    free(todo_chrome);
+}
+
+void traza_liberar(void) {
+    for (int h = 0; h < num_buffers; h++) free(buffers[h].eventos);
+    free(buffers);
+    buffers = NULL;
+    num_buffers = 0;
+    traza_activa = 0;
+}
@@ -0,0 +1,65 @@
+#ifndef TRAZA_H
+#define TRAZA_H
+
+#include <mpi.h>
+#include <omp.h>
+
+// Instrumentación de las fases del programa (--traza). Cada hilo apunta en su propio buffer
+// los intervalos de cada ámbito y sus contadores; al final traza_exportar() los reúne en el
+// Master y escribe:
+//   <prefijo>.json         estadísticas por proceso y por hilo (n, total, min, max, p50/p95/p99)
+//                          y, por ámbito, el reparto entre procesos (desequilibrio y el más lento)
+//   <prefijo>_chrome.json  línea de tiempo para chrome://tracing o Perfetto (un pid por proceso,
+//                          un tid por hilo)
+// Sin --traza cada punto de medida es una comprobación de traza_activa.
+
+typedef enum {
+    TRAZA_LECTURA = 0,      // Lectura del fichero (texto o binario)
+    TRAZA_PARSEO,           // Texto -> float
+    TRAZA_REPARTO,          // Reparto de filas (Scatterv + halo, o calibración)
+    TRAZA_DIFUSION,         // Patrón del día (o bloque de patrones en --lote)
+    TRAZA_RECORRIDO,        // Búsqueda local de cada hilo
+    TRAZA_FUSION_HILOS,     // Fusión de las listas de los hilos
+    TRAZA_REDUCCION_TOPK,   // Fusión de los top-K entre procesos
+    TRAZA_REUNION_FILAS,    // Filas de los vecinos hacia el Master
+    TRAZA_PREDICCION,       // Predicción y MAPE (Master)
+    TRAZA_ESCRITURA,        // Volcado de resultados (hilo escritor)
+    TRAZA_NUM_AMBITOS
+} AmbitoTraza;
+
+typedef enum {
+    TRAZA_FILAS_RECORRIDAS = 0,     // Filas comparadas con el patrón (cumplen el corte causal)
+    TRAZA_CANDIDATOS_INSERTADOS,    // Filas que entraron en la lista de K del hilo
+    TRAZA_NUM_CONTADORES
+} ContadorTraza;
+
+// Hilo del escritor de resultados (no es un hilo OpenMP): tiene su propio buffer
+#define TRAZA_HILO_ESCRITOR (-1)
+
+extern int traza_activa;
+
+// Colectiva: prepara un buffer por hilo OpenMP (y otro para el escritor) y fija el origen de
+// tiempos tras una barrera, así las líneas de tiempo de los procesos quedan alineadas
+void traza_iniciar(int activa, int max_hilos, MPI_Comm comm);
+
+void traza_anotar(AmbitoTraza ambito, double inicio, double fin, int hilo);
+void traza_sumar(ContadorTraza contador, long valor, int hilo);
+
+// Colectiva: reúne las trazas en el Master y escribe los dos ficheros
+void traza_exportar(const char *prefijo, MPI_Comm comm);
+void traza_liberar(void);
+
+static inline double traza_ahora(void) {
+    return traza_activa ? omp_get_wtime() : 0.0;
+}
+
+// Cierra un intervalo empezado en 'inicio' (valor de traza_ahora) en el hilo que llama
+static inline void traza_registrar(AmbitoTraza ambito, double inicio) {
+    if (traza_activa) traza_anotar(ambito, inicio, omp_get_wtime(), omp_get_thread_num());
+}
+
+static inline void traza_contar(ContadorTraza contador, long valor) {
+    if (traza_activa) traza_sumar(contador, valor, omp_get_thread_num());
+}
+
+#endif
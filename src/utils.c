@@ -1,11 +1,208 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <stdint.h>
 #include <mpi.h>
+#include <omp.h>
 #include "utils.h"
+#include "distancia.h"
+#include "traza.h"
 
 #define MASTERPID 0
 
+// Trozos por hilo en el parseo paralelo (más de uno para equilibrar líneas de distinta longitud)
+#define TROZOS_POR_HILO 8
+// Máximo de líneas erróneas que se listan antes de resumir
+#define MAX_ERRORES_LISTADOS 5
+
+// Potencias de 10 exactas en float (5^10 < 2^24)
+static const float POT10[11] = { 1e0f, 1e1f, 1e2f, 1e3f, 1e4f, 1e5f, 1e6f, 1e7f, 1e8f, 1e9f, 1e10f };
+
+static inline int es_separador(char c) {
+    return c == ',' || c == ' ' || c == '\t' || c == '\r';
+}
+
+static inline int es_digito(char c) {
+    return c >= '0' && c <= '9';
+}
+
+// Conversión rápida para la forma "[-]ddddd.d" del CSV.
+// Si la mantisa entera cabe en 24 bits y hay como mucho 10 decimales, m / 10^d es una única
+// división IEEE entre dos valores exactos: da el mismo float correctamente redondeado que strtof.
+// Cualquier otra forma (exponente, demasiados dígitos, inf/nan...) pasa por strtof.
+// Devuelve el puntero tras el número o NULL si el campo no es un número válido.
+__attribute__((optimize("no-reciprocal-math")))
+static const char* parsear_float(const char *p, const char *fin, float *valor) {
+    const char *q = p;
+    int negativo = 0;
+    if (q < fin && (*q == '-' || *q == '+')) { negativo = (*q == '-'); q++; }
+
+    uint32_t mantisa = 0;
+    int digitos = 0, decimales = 0;
+    while (q < fin && es_digito(*q) && digitos < 10) { mantisa = mantisa * 10 + (uint32_t)(*q - '0'); digitos++; q++; }
+    if (q < fin && *q == '.') {
+        q++;
+        while (q < fin && es_digito(*q) && digitos < 10) { mantisa = mantisa * 10 + (uint32_t)(*q - '0'); digitos++; decimales++; q++; }
+    }
+
+    if (digitos > 0 && digitos < 10 && mantisa < (1u << 24) && decimales <= 10 && (q == fin || es_separador(*q))) {
+        float v = (float)mantisa / POT10[decimales];
+        *valor = negativo ? -v : v;
+        return q;
+    }
+
+    // Fallback estricto: strtof debe consumir el campo completo
+    char *endptr;
+    *valor = strtof(p, &endptr);
+    if (endptr == p || endptr > fin || (endptr < fin && !es_separador(*endptr))) return NULL;
+    return endptr;
+}
+
+// Devuelve 1 si la línea [ini, fin) solo tiene separadores (línea en blanco)
+static int linea_vacia(const char *ini, const char *fin) {
+    for (const char *c = ini; c < fin; c++) if (!es_separador(*c)) return 0;
+    return 1;
+}
+
+int parsear_linea(const char *ini, const char *fin, float *destino, int columnas) {
+    int campos = 0;
+    const char *c = ini;
+    while (c < fin) {
+        if (es_separador(*c)) { c++; continue; }
+        float v;
+        const char *sig = parsear_float(c, fin, &v);
+        if (sig == NULL) return -1;
+        if (destino && campos < columnas) destino[campos] = v;
+        campos++;
+        c = sig;
+    }
+    return campos;
+}
+
+// Estado de cada trozo del parseo paralelo
+typedef struct {
+    const char *ini, *fin;   // Rango de bytes (empieza y termina en límite de línea)
+    long filas;              // Filas no vacías del trozo (pasada 1)
+    long lineas;             // Líneas del trozo, incluidas las vacías (para los mensajes)
+    long primera_fila;       // Fila global de su primera línea (prefijo de 'filas')
+    long primera_linea;      // Línea del fichero de su primera línea (1 = cabecera)
+    long errores;            // Líneas con columnas incorrectas o campos no numéricos
+    long fila_error[MAX_ERRORES_LISTADOS];
+    long linea_error[MAX_ERRORES_LISTADOS];
+    int campos_error[MAX_ERRORES_LISTADOS];
+} TrozoTexto;
+
+// Parseo multihilo del cuerpo del fichero (todo lo que va tras la cabecera).
+// 1) Se parte el buffer en trozos alineados a saltos de línea.
+// 2) Cada hilo cuenta las filas de sus trozos; un prefijo da la fila de inicio de cada trozo.
+// 3) Cada hilo parsea sus trozos directamente en su hueco de 'datos'.
+// Devuelve 0 si el contenido coincide con la cabecera, -1 si no (los errores ya se han impreso).
+static int parsear_cuerpo_paralelo(const char *texto, const char *fin_texto, float *datos,
+                                   int filas, int columnas, int *num_trozos_usados) {
+    long longitud = fin_texto - texto;
+    int num_trozos = omp_get_max_threads() * TROZOS_POR_HILO;
+    if (longitud < (long)num_trozos * 4096) num_trozos = (int)(longitud / 4096) + 1;
+
+    TrozoTexto *trozos = (TrozoTexto *)calloc(num_trozos, sizeof(TrozoTexto));
+    if (trozos == NULL) {
+        perror("Error en malloc para trozos de parseo");
+        MPI_Abort(MPI_COMM_WORLD, EXIT_FAILURE);
+    }
+
+    // Límites: cada trozo empieza justo después de un '\n' (o al principio del texto)
+    for (int t = 0; t < num_trozos; t++) {
+        const char *corte = texto + (longitud * t) / num_trozos;
+        if (t > 0) {
+            const char *nl = memchr(corte - 1, '\n', fin_texto - (corte - 1));
+            corte = nl ? nl + 1 : fin_texto;
+        }
+        trozos[t].ini = corte;
+        if (t > 0) trozos[t - 1].fin = corte;
+    }
+    trozos[num_trozos - 1].fin = fin_texto;
+
+    // Pasada 1: contar filas no vacías de cada trozo
+    #pragma omp parallel for schedule(dynamic, 1)
+    for (int t = 0; t < num_trozos; t++) {
+        long n = 0, lineas = 0;
+        const char *c = trozos[t].ini;
+        while (c < trozos[t].fin) {
+            const char *nl = memchr(c, '\n', trozos[t].fin - c);
+            const char *fin_linea = nl ? nl : trozos[t].fin;
+            if (!linea_vacia(c, fin_linea)) n++;
+            lineas++;
+            c = fin_linea + 1;
+        }
+        trozos[t].filas = n;
+        trozos[t].lineas = lineas;
+    }
+
+    long filas_fichero = 0, linea = 2;
+    for (int t = 0; t < num_trozos; t++) {
+        trozos[t].primera_fila = filas_fichero;
+        trozos[t].primera_linea = linea;
+        filas_fichero += trozos[t].filas;
+        linea += trozos[t].lineas;
+    }
+
+    // Pasada 2: parsear cada línea en su fila preasignada
+    #pragma omp parallel for schedule(dynamic, 1)
+    for (int t = 0; t < num_trozos; t++) {
+        long fila = trozos[t].primera_fila;
+        long linea_actual = trozos[t].primera_linea;
+        const char *c = trozos[t].ini;
+        while (c < trozos[t].fin && fila < filas) {
+            const char *nl = memchr(c, '\n', trozos[t].fin - c);
+            const char *fin_linea = nl ? nl : trozos[t].fin;
+            if (!linea_vacia(c, fin_linea)) {
+                int campos = parsear_linea(c, fin_linea, &datos[fila * columnas], columnas);
+                if (campos != columnas) {
+                    if (trozos[t].errores < MAX_ERRORES_LISTADOS) {
+                        trozos[t].fila_error[trozos[t].errores] = fila;
+                        trozos[t].linea_error[trozos[t].errores] = linea_actual;
+                        trozos[t].campos_error[trozos[t].errores] = campos;
+                    }
+                    trozos[t].errores++;
+                }
+                fila++;
+            }
+            linea_actual++;
+            c = fin_linea + 1;
+        }
+    }
+
+    // Informe de discrepancias con la cabecera
+    int ok = 1;
+    long errores_totales = 0, listados = 0;
+    for (int t = 0; t < num_trozos; t++) {
+        for (long e = 0; e < trozos[t].errores && e < MAX_ERRORES_LISTADOS && listados < MAX_ERRORES_LISTADOS; e++, listados++) {
+            if (trozos[t].campos_error[e] < 0) {
+                fprintf(stderr, "[ERROR IO] Fila %ld (línea %ld): campo no numérico\n",
+                        trozos[t].fila_error[e], trozos[t].linea_error[e]);
+            } else {
+                fprintf(stderr, "[ERROR IO] Fila %ld (línea %ld): %d columnas, la cabecera indica %d\n",
+                        trozos[t].fila_error[e], trozos[t].linea_error[e], trozos[t].campos_error[e], columnas);
+            }
+        }
+        errores_totales += trozos[t].errores;
+    }
+    if (errores_totales > 0) {
+        fprintf(stderr, "[ERROR IO] %ld filas no coinciden con la cabecera (%d columnas)\n", errores_totales, columnas);
+        ok = 0;
+    }
+    if (filas_fichero < filas) {
+        fprintf(stderr, "[ERROR IO] La cabecera indica %d filas pero el fichero solo tiene %ld\n", filas, filas_fichero);
+        ok = 0;
+    } else if (filas_fichero > filas) {
+        fprintf(stderr, "[ADVERTENCIA] El fichero tiene %ld filas, se ignoran las %ld que sobran respecto a la cabecera\n",
+                filas_fichero, filas_fichero - filas);
+    }
+
+    *num_trozos_usados = num_trozos;
+    free(trozos);
+    return ok ? 0 : -1;
+}
+
 /* * Implementación robusta con MPI I/O para cumplir requisitos del enunciado.
  * Estrategia:
  * 1. Usar MPI_File_open/get_size/read para cargar todo el fichero a un buffer.
@@ -20,6 +217,7 @@ float* leer_fichero(const char* nombre_fichero, int* filas_totales, int* columna
         
         MPI_File fh;
         int err;
+        double t_traza = traza_ahora();
 
         // 1. Abrir el fichero con MPI_File_open
         // Usamos MPI_COMM_SELF porque, en esta estrategia, solo el Master lee.
@@ -57,6 +255,7 @@ float* leer_fichero(const char* nombre_fichero, int* filas_totales, int* columna
 
         // 5. Cerrar el fichero (Ya tenemos los datos en RAM)
         MPI_File_close(&fh);
+        traza_registrar(TRAZA_LECTURA, t_traza);
 
         printf("[IO] Fichero cargado en memoria con MPI_File_read (%lld bytes).\n", (long long)filesize);
 
@@ -84,37 +283,26 @@ float* leer_fichero(const char* nombre_fichero, int* filas_totales, int* columna
             MPI_Abort(MPI_COMM_WORLD, EXIT_FAILURE);
         }
 
-        // C. Leer los datos
-        // El formato es CSV o separado por espacios/saltos. strtof maneja ambos.
-        // Avanzamos el cursor saltando cualquier carácter no numérico inicial si es necesario
-        
-        long leidos = 0;
-        while (leidos < total_elementos && *cursor != '\0') {
-            // strtof salta automáticamente espacios en blanco (espacios, tabs, newlines)
-            // pero NO salta comas automáticamente en todas las implementaciones si no hay espacio.
-            // Truco: Si encontramos una coma, la saltamos manualmente.
-            if (*cursor == ',' || *cursor == ' ' || *cursor == '\n' || *cursor == '\r') {
-                cursor++;
-                continue;
-            }
-            
-            // Intentar leer un float
-            datos[leidos] = strtof(cursor, &endptr);
-            
-            if (cursor == endptr) {
-                // No se pudo leer número (fin de fichero o basura)
-                break;
-            }
-            
-            cursor = endptr; // Avanzar al siguiente
-            leidos++;
-        }
+        // C. Leer los datos (parseo paralelo por trozos de líneas)
+        // La cabecera termina en el primer salto de línea
+        char *fin_texto = buffer_texto + filesize;
+        char *nl = memchr(cursor, '\n', fin_texto - cursor);
+        cursor = nl ? nl + 1 : fin_texto;
+
+        double t_parseo = MPI_Wtime();
+        t_traza = traza_ahora();
+        int num_trozos = 0;
+        int ret = parsear_cuerpo_paralelo(cursor, fin_texto, datos, *filas_totales, *columnas_totales, &num_trozos);
+        traza_registrar(TRAZA_PARSEO, t_traza);
+        t_parseo = MPI_Wtime() - t_parseo;
 
-        if (leidos != total_elementos) {
-            fprintf(stderr, "[ADVERTENCIA] Se esperaban %ld datos, pero se leyeron %ld.\n", total_elementos, leidos);
-        } else {
-            printf("[IO] Parseo completado exitosamente.\n");
+        if (ret != 0) {
+            free(buffer_texto);
+            free(datos);
+            MPI_Abort(MPI_COMM_WORLD, EXIT_FAILURE);
         }
+        printf("[IO] Parseo completado exitosamente (%d hilos, %d trozos, %.4fs).\n",
+               omp_get_max_threads(), num_trozos, t_parseo);
 
         // Liberar el buffer de texto gigante, ya no hace falta
         free(buffer_texto);
@@ -123,6 +311,156 @@ float* leer_fichero(const char* nombre_fichero, int* filas_totales, int* columna
     return datos;
 }
 
+void calcular_particion(int total_filas, int num_procs, const double *pesos, int *inicios) {
+    inicios[0] = 0;
+    if (pesos == NULL) {
+        int base = total_filas / num_procs;
+        int resto = total_filas % num_procs;
+        for (int p = 0; p < num_procs; p++) inicios[p+1] = inicios[p] + base + (p < resto ? 1 : 0);
+        return;
+    }
+
+    // Una fila garantizada por proceso (el halo la necesita) y el resto en proporción al peso,
+    // redondeando por la suma acumulada para que el total cuadre exactamente
+    int minimo = (total_filas >= num_procs) ? 1 : 0;
+    int repartibles = total_filas - minimo * num_procs;
+    double suma_pesos = 0.0;
+    for (int p = 0; p < num_procs; p++) suma_pesos += (pesos[p] > 0.0) ? pesos[p] : 0.0;
+
+    double acumulado = 0.0;
+    for (int p = 0; p < num_procs; p++) {
+        double peso = (pesos[p] > 0.0) ? pesos[p] : 0.0;
+        acumulado += (suma_pesos > 0.0) ? peso / suma_pesos : 1.0 / num_procs;
+        long hasta = (p == num_procs - 1) ? repartibles : (long)(acumulado * repartibles + 0.5);
+        if (hasta > repartibles) hasta = repartibles;
+        inicios[p+1] = (int)hasta + minimo * (p + 1);
+        if (inicios[p+1] < inicios[p] + minimo) inicios[p+1] = inicios[p] + minimo;
+    }
+}
+
+#define CALIBRACION_FILAS 4096
+#define CALIBRACION_SEGUNDOS 0.02
+
+void calibrar_pesos_reparto(int columnas, int stride, MPI_Comm comm, double *pesos) {
+    float *bloque = reservar_filas_alineadas(CALIBRACION_FILAS + 1, stride);
+    if (bloque == NULL) {
+        fprintf(stderr, "[ERROR] Sin memoria para la calibración del reparto\n");
+        MPI_Abort(MPI_COMM_WORLD, EXIT_FAILURE);
+    }
+    // Datos sintéticos deterministas: el coste del kernel no depende de los valores
+    for (int i = 0; i <= CALIBRACION_FILAS; i++) {
+        for (int j = 0; j < columnas; j++) bloque[(long)i * stride + j] = (float)((i * 31 + j * 7) % 97);
+    }
+    const float *patron = &bloque[(long)CALIBRACION_FILAS * stride];
+
+    // Todos empiezan a la vez, así los procesos que comparten núcleo se estorban como en el cálculo real
+    MPI_Barrier(comm);
+    double t_inicio = MPI_Wtime(), t_transcurrido = 0.0;
+    long filas_recorridas = 0;
+    volatile float sumidero = 0.0f;  // Evita que el compilador descarte las distancias
+    do {
+        float suma = 0.0f;
+        #pragma omp parallel for schedule(static) reduction(+:suma)
+        for (int i = 0; i < CALIBRACION_FILAS; i++) suma += calcular_distancia_sq(&bloque[(long)i * stride], patron, columnas);
+        sumidero += suma;
+        filas_recorridas += CALIBRACION_FILAS;
+        t_transcurrido = MPI_Wtime() - t_inicio;
+    } while (t_transcurrido < CALIBRACION_SEGUNDOS);
+    free(bloque);
+
+    double rendimiento = filas_recorridas / t_transcurrido;
+    MPI_Allgather(&rendimiento, 1, MPI_DOUBLE, pesos, 1, MPI_DOUBLE, comm);
+}
+
+int* preparar_reparto(int filas_totales, int columnas, int stride, int ponderado, MPI_Comm comm) {
+    int pid, prn;
+    MPI_Comm_rank(comm, &pid);
+    MPI_Comm_size(comm, &prn);
+    int *inicios = (int *)malloc((prn + 1) * sizeof(int));
+    double *pesos = NULL;
+    if (ponderado && prn > 1) pesos = (double *)malloc(prn * sizeof(double));
+    if (inicios == NULL || (ponderado && prn > 1 && pesos == NULL)) {
+        fprintf(stderr, "[ERROR P%d] Sin memoria para el reparto\n", pid);
+        MPI_Abort(MPI_COMM_WORLD, EXIT_FAILURE);
+    }
+    if (pesos) calibrar_pesos_reparto(columnas, stride, comm, pesos);
+    calcular_particion(filas_totales, prn, pesos, inicios);
+
+    if (pesos && pid == MASTERPID) {
+        printf("[REPARTO] Ponderado por rendimiento:");
+        for (int p = 0; p < prn; p++) printf(" P%d=%d filas (%.0f filas/s)", p, inicios[p+1] - inicios[p], pesos[p]);
+        printf("\n");
+    }
+    free(pesos);
+    return inicios;
+}
+
+void repartir_filas(const float *datos_globales, float *datos_locales, int columnas, int stride,
+                    const int *inicios, MPI_Comm comm) {
+    int pid, prn;
+    MPI_Comm_rank(comm, &pid);
+    MPI_Comm_size(comm, &prn);
+
+    // Cada proceso recibe sus filas directamente en el hueco con relleno (tipo_fila)
+    MPI_Datatype tipo_fila = crear_tipo_fila(columnas, stride);
+    int *elems_envio = (int *)malloc(prn * sizeof(int));
+    int *desplazamientos = (int *)malloc(prn * sizeof(int));
+    if (elems_envio == NULL || desplazamientos == NULL) {
+        perror("Error malloc reparto");
+        MPI_Abort(MPI_COMM_WORLD, EXIT_FAILURE);
+    }
+    for (int p = 0; p < prn; p++) {
+        elems_envio[p] = (inicios[p+1] - inicios[p]) * columnas;
+        desplazamientos[p] = inicios[p] * columnas;
+    }
+    int filas_proceso = inicios[pid+1] - inicios[pid];
+    MPI_Scatterv(datos_globales, elems_envio, desplazamientos, MPI_FLOAT,
+                 datos_locales, filas_proceso, tipo_fila, MASTERPID, comm);
+
+    // Cada proceso recibe el halo del siguiente; con esto el Master ya no necesita la matriz completa
+    intercambiar_halo(datos_locales, filas_proceso, columnas, stride, pid, prn, comm);
+    MPI_Type_free(&tipo_fila);
+    free(elems_envio);
+    free(desplazamientos);
+}
+
+int calcular_filas_almacenadas(const int *inicios, int num_procs, int pid) {
+    int num_filas = inicios[pid+1] - inicios[pid];
+    return (pid < num_procs - 1) ? num_filas + 1 : num_filas;
+}
+
+int propietario_fila(int fila, const int *inicios, int num_procs) {
+    // Búsqueda binaria del último proceso con inicio <= fila (los vacíos se saltan)
+    int lo = 0, hi = num_procs - 1;
+    while (lo < hi) {
+        int mitad = (lo + hi + 1) / 2;
+        if (inicios[mitad] <= fila) lo = mitad;
+        else hi = mitad - 1;
+    }
+    return lo;
+}
+
+void intercambiar_halo(float *datos_locales, int num_filas, int columnas, int stride,
+                       int pid, int num_procs, MPI_Comm comm) {
+    MPI_Datatype tipo_fila = crear_tipo_fila(columnas, stride);
+    int anterior = (pid > 0) ? pid - 1 : MPI_PROC_NULL;
+    int siguiente = (pid < num_procs - 1) ? pid + 1 : MPI_PROC_NULL;
+    // La primera fila propia va al anterior; la del siguiente se guarda detrás de las propias
+    MPI_Sendrecv(datos_locales, 1, tipo_fila, anterior, 0,
+                 &datos_locales[(long)num_filas * stride], 1, tipo_fila, siguiente, 0,
+                 comm, MPI_STATUS_IGNORE);
+    MPI_Type_free(&tipo_fila);
+}
+
+MPI_Datatype crear_tipo_fila(int columnas, int stride) {
+    MPI_Datatype contiguo, tipo_fila;
+    MPI_Type_contiguous(columnas, MPI_FLOAT, &contiguo);
+    MPI_Type_create_resized(contiguo, 0, (MPI_Aint)stride * sizeof(float), &tipo_fila);
+    MPI_Type_commit(&tipo_fila);
+    MPI_Type_free(&contiguo);
+    return tipo_fila;
+}
+
 // Función auxiliar (ya estaba definida en .h)
 void guardar_resultados(const char* nombre_fichero, float* predicciones, int filas, int columnas) {
     // Evitar warnings de compilador por variables no usadas
@@ -7,6 +7,47 @@
 // Devuelve un puntero al array con TODOS los datos (solo en Master, NULL en esclavos)
 float* leer_fichero(const char* nombre_fichero, int* filas_totales, int* columnas_totales, int pid);
 
+// Parsea la línea [ini, fin) en 'destino' (si no es NULL), con el mismo redondeo que
+// leer_fichero. Devuelve el número de campos encontrados, o -1 si algún campo no es numérico.
+int parsear_linea(const char *ini, const char *fin, float *destino, int columnas);
+
+// Reparto de filas entre procesos: el proceso p tiene las filas [inicios[p], inicios[p+1]).
+// 'inicios' tiene num_procs + 1 entradas y cubre todas las filas. Sin pesos (NULL) el reparto
+// es equitativo (los primeros total % num_procs procesos tienen una fila más); con pesos cada
+// proceso recibe filas en proporción a su peso, con al menos una fila si hay suficientes.
+void calcular_particion(int total_filas, int num_procs, const double *pesos, int *inicios);
+
+// Colectiva: mide las filas por segundo que recorre cada proceso con el kernel de distancia
+// elegido (y todos sus hilos) sobre un bloque sintético, y deja en 'pesos' (num_procs
+// entradas, iguales en todos los procesos) el rendimiento de cada uno.
+void calibrar_pesos_reparto(int columnas, int stride, MPI_Comm comm, double *pesos);
+
+// Colectiva sobre 'comm': reparto de filas (inicios, tamaño de 'comm' + 1 entradas), equitativo
+// o en proporción al rendimiento medido en cada proceso. Requiere el kernel de distancia ya elegido.
+int* preparar_reparto(int filas_totales, int columnas, int stride, int ponderado, MPI_Comm comm);
+
+// Colectiva sobre 'comm': el Master envía a cada proceso sus filas de 'datos_globales' (sin
+// relleno) con MPI_Scatterv y después se intercambia el halo. 'datos_locales' debe tener
+// calcular_filas_almacenadas() filas de 'stride' floats.
+void repartir_filas(const float *datos_globales, float *datos_locales, int columnas, int stride,
+                    const int *inicios, MPI_Comm comm);
+
+// Filas que guarda en memoria el proceso 'pid': las suyas más la primera del siguiente proceso
+// (halo), para tener el día posterior de cualquiera de sus filas (el último no la necesita)
+int calcular_filas_almacenadas(const int *inicios, int num_procs, int pid);
+
+// Proceso que tiene 'fila' como propia
+int propietario_fila(int fila, const int *inicios, int num_procs);
+
+// Colectiva: cada proceso recibe en la fila 'num_filas' de sus datos locales la primera fila
+// del proceso siguiente (el último no recibe nada)
+void intercambiar_halo(float *datos_locales, int num_filas, int columnas, int stride,
+                       int pid, int num_procs, MPI_Comm comm);
+
+// Tipo MPI de una fila: 'columnas' floats contiguos con extensión de 'stride' floats.
+// Permite recibir (Scatter / MPI-IO) directamente en el formato con relleno SIMD.
+MPI_Datatype crear_tipo_fila(int columnas, int stride);
+
 // Función auxiliar para guardar resultados (opcional, pero útil para el final)
 void guardar_resultados(const char* nombre_fichero, float* predicciones, int filas, int columnas);
 
@@ -0,0 +1,231 @@
+/*
+ * src/vecinos.c
+ * Listas ordenadas de los K mejores vecinos: inserción, fusión y reducción MPI.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stddef.h>
+#include <mpi.h>
+#include "vecinos.h"
+
+// Función para comparar vecinos (necesaria para el qsort final de los pocos candidatos)
+int comparar_vecinos(const void *a, const void *b) {
+    const VecinoInterno *va = (const VecinoInterno *)a;
+    const VecinoInterno *vb = (const VecinoInterno *)b;
+    if (vecino_precede(va->dist_sq, va->indice_dia, vb->dist_sq, vb->indice_dia)) return -1;
+    if (vecino_precede(vb->dist_sq, vb->indice_dia, va->dist_sq, va->indice_dia)) return 1;
+    return 0;
+}
+
+// Función auxiliar para mantener la lista de los K mejores vecinos ordenada.
+// Desplaza elementos solo si encontramos un vecino mejor que el peor de nuestra lista.
+void insertar_vecino_ordenado(VecinoInterno *lista, int k, int indice_global, float distancia) {
+    // Si es peor que el último de la lista, no hacemos nada
+    if (!vecino_precede(distancia, indice_global, lista[k-1].dist_sq, lista[k-1].indice_dia)) return;
+
+    // Inserción ordenada (de atrás hacia adelante)
+    int i = k - 2;
+    while (i >= 0 && vecino_precede(distancia, indice_global, lista[i].dist_sq, lista[i].indice_dia)) {
+        lista[i+1] = lista[i]; // Desplazar a la derecha
+        i--;
+    }
+    // Insertar el nuevo vecino
+    lista[i+1].indice_dia = indice_global;
+    lista[i+1].dist_sq = distancia;
+}
+
+void fusionar_top_k(const VecinoInterno *a, const VecinoInterno *b, int k, VecinoInterno *salida) {
+    int i = 0, j = 0;
+    for (int n = 0; n < k; n++) {
+        if (vecino_precede(b[j].dist_sq, b[j].indice_dia, a[i].dist_sq, a[i].indice_dia)) salida[n] = b[j++];
+        else salida[n] = a[i++];
+    }
+}
+
+// Reducción local: unificar en 'destino' las listas de los 'num_hilos' hilos con el mismo
+// kernel de fusión que usa la reducción MPI entre procesos
+void fusionar_listas_hilos(const VecinoInterno *buffer_hilos, int num_hilos, long separacion, int k,
+                           VecinoInterno *destino) {
+    // Copiamos los candidatos del hilo 0 como base
+    for (int j = 0; j < k; j++) destino[j] = buffer_hilos[j];
+    if (num_hilos == 1) return;
+
+    VecinoInterno *tmp = (VecinoInterno *)malloc(k * sizeof(VecinoInterno));
+    if (tmp == NULL) {
+        fprintf(stderr, "[ERROR] Sin memoria para fusionar las listas de los hilos\n");
+        MPI_Abort(MPI_COMM_WORLD, EXIT_FAILURE);
+    }
+    // Fusionamos con los de los demás hilos
+    for (int t = 1; t < num_hilos; t++) {
+        fusionar_top_k(destino, &buffer_hilos[t * separacion], k, tmp);
+        for (int j = 0; j < k; j++) destino[j] = tmp[j];
+    }
+    free(tmp);
+}
+
+EstrategiaTopK topk_resolver(EstrategiaTopK pedida, int k, int umbral_exacto) {
+    if (pedida != TOPK_AUTO) return pedida;
+    if (k <= TOPK_K_ORDENADO) return TOPK_ORDENADO;
+    return umbral_exacto ? TOPK_MONTICULO : TOPK_SELECCION;
+}
+
+int topk_capacidad(EstrategiaTopK estrategia, int k) {
+    return (estrategia == TOPK_SELECCION) ? 2 * k : k;
+}
+
+const char* topk_nombre(EstrategiaTopK estrategia) {
+    switch (estrategia) {
+        case TOPK_ORDENADO: return "ordenado";
+        case TOPK_MONTICULO: return "monticulo";
+        case TOPK_SELECCION: return "seleccion";
+        default: return "auto";
+    }
+}
+
+void topk_iniciar(SeleccionTopK *s, VecinoInterno *datos, int k, EstrategiaTopK estrategia) {
+    s->datos = datos;
+    s->k = k;
+    s->usados = 0;
+    s->estrategia = estrategia;
+    s->peor_dist = FLT_MAX;
+    s->peor_indice = -1;
+    s->insertados = 0;
+    // Array ordenado y montículo empiezan llenos de "distancia infinita" (todos iguales,
+    // así que también es un montículo válido); la selección empieza vacía
+    if (estrategia != TOPK_SELECCION) {
+        for (int j = 0; j < k; j++) {
+            datos[j].dist_sq = FLT_MAX;
+            datos[j].indice_dia = -1;
+        }
+    }
+}
+
+// Montículo de máximos: en la raíz está el peor de los K
+void topk_monticulo_sustituir(SeleccionTopK *s, int indice, float distancia) {
+    VecinoInterno *m = s->datos;
+    int k = s->k;
+    int i = 0;
+    for (;;) {
+        int hijo = 2 * i + 1;
+        if (hijo >= k) break;
+        if (hijo + 1 < k && vecino_precede(m[hijo].dist_sq, m[hijo].indice_dia, m[hijo+1].dist_sq, m[hijo+1].indice_dia)) {
+            hijo++;
+        }
+        if (!vecino_precede(distancia, indice, m[hijo].dist_sq, m[hijo].indice_dia)) break;
+        m[i] = m[hijo];
+        i = hijo;
+    }
+    m[i].indice_dia = indice;
+    m[i].dist_sq = distancia;
+    s->peor_dist = m[0].dist_sq;
+    s->peor_indice = m[0].indice_dia;
+}
+
+static void intercambiar(VecinoInterno *a, VecinoInterno *b) {
+    VecinoInterno t = *a;
+    *a = *b;
+    *b = t;
+}
+
+// Selección parcial (Hoare): deja en v[n] el elemento de rango n, con los anteriores
+// a él delante y los posteriores detrás (sin orden dentro de cada lado)
+static void seleccionar_rango(VecinoInterno *v, int num, int n) {
+    int lo = 0, hi = num - 1;
+    while (lo < hi) {
+        // Pivote: mediana de tres
+        int mitad = lo + (hi - lo) / 2;
+        if (vecino_precede(v[mitad].dist_sq, v[mitad].indice_dia, v[lo].dist_sq, v[lo].indice_dia)) intercambiar(&v[mitad], &v[lo]);
+        if (vecino_precede(v[hi].dist_sq, v[hi].indice_dia, v[lo].dist_sq, v[lo].indice_dia)) intercambiar(&v[hi], &v[lo]);
+        if (vecino_precede(v[hi].dist_sq, v[hi].indice_dia, v[mitad].dist_sq, v[mitad].indice_dia)) intercambiar(&v[hi], &v[mitad]);
+        VecinoInterno pivote = v[mitad];
+
+        int i = lo, j = hi;
+        while (i <= j) {
+            while (vecino_precede(v[i].dist_sq, v[i].indice_dia, pivote.dist_sq, pivote.indice_dia)) i++;
+            while (vecino_precede(pivote.dist_sq, pivote.indice_dia, v[j].dist_sq, v[j].indice_dia)) j--;
+            if (i <= j) {
+                intercambiar(&v[i], &v[j]);
+                i++;
+                j--;
+            }
+        }
+        if (n <= j) hi = j;
+        else if (n >= i) lo = i;
+        else return;
+    }
+}
+
+// Deja los K mejores del buffer en datos[0..K) y el umbral en el K-ésimo
+static void topk_compactar(SeleccionTopK *s) {
+    seleccionar_rango(s->datos, s->usados, s->k - 1);
+    s->usados = s->k;
+    s->peor_dist = s->datos[s->k - 1].dist_sq;
+    s->peor_indice = s->datos[s->k - 1].indice_dia;
+}
+
+void topk_seleccion_anadir(SeleccionTopK *s, int indice, float distancia) {
+    s->datos[s->usados].indice_dia = indice;
+    s->datos[s->usados].dist_sq = distancia;
+    if (++s->usados == 2 * s->k) topk_compactar(s);
+}
+
+void topk_finalizar(SeleccionTopK *s) {
+    if (s->estrategia == TOPK_ORDENADO) return;
+    if (s->estrategia == TOPK_SELECCION) {
+        if (s->usados > s->k) topk_compactar(s);
+        for (int j = s->usados; j < s->k; j++) {
+            s->datos[j].dist_sq = FLT_MAX;
+            s->datos[j].indice_dia = -1;
+        }
+        s->usados = s->k;
+    }
+    qsort(s->datos, s->k, sizeof(VecinoInterno), comparar_vecinos);
+    s->peor_dist = s->datos[s->k - 1].dist_sq;
+    s->peor_indice = s->datos[s->k - 1].indice_dia;
+}
+
+// Operación de usuario: inout[l] = fusión(in[l], inout[l]) para cada una de las 'len' listas
+static void op_fusionar_listas(void *in, void *inout, int *len, MPI_Datatype *tipo) {
+    int bytes;
+    MPI_Type_size(*tipo, &bytes);
+    int k = bytes / (int)(sizeof(int) + sizeof(float));
+
+    VecinoInterno *entrada = (VecinoInterno *)in;
+    VecinoInterno *acumulado = (VecinoInterno *)inout;
+    VecinoInterno *tmp = (VecinoInterno *)malloc(k * sizeof(VecinoInterno));
+    if (tmp == NULL) {
+        fprintf(stderr, "[ERROR] Sin memoria en la reducción de vecinos\n");
+        MPI_Abort(MPI_COMM_WORLD, EXIT_FAILURE);
+    }
+    for (int l = 0; l < *len; l++) {
+        VecinoInterno *destino = &acumulado[(long)l * k];
+        fusionar_top_k(&entrada[(long)l * k], destino, k, tmp);
+        for (int n = 0; n < k; n++) destino[n] = tmp[n];
+    }
+    free(tmp);
+}
+
+void crear_tipos_vecinos(int k, TiposVecinos *tipos) {
+    int longitudes[2] = {1, 1};
+    MPI_Aint desplazamientos[2] = {offsetof(VecinoInterno, indice_dia), offsetof(VecinoInterno, dist_sq)};
+    MPI_Datatype tipos_campos[2] = {MPI_INT, MPI_FLOAT};
+    MPI_Datatype tipo_struct;
+
+    MPI_Type_create_struct(2, longitudes, desplazamientos, tipos_campos, &tipo_struct);
+    MPI_Type_create_resized(tipo_struct, 0, sizeof(VecinoInterno), &tipos->tipo_vecino);
+    MPI_Type_free(&tipo_struct);
+    MPI_Type_commit(&tipos->tipo_vecino);
+
+    MPI_Type_contiguous(k, tipos->tipo_vecino, &tipos->tipo_lista);
+    MPI_Type_commit(&tipos->tipo_lista);
+
+    // Conmutativa: el orden (distancia, índice) es total
+    MPI_Op_create(op_fusionar_listas, 1, &tipos->op_fusion);
+}
+
+void liberar_tipos_vecinos(TiposVecinos *tipos) {
+    MPI_Op_free(&tipos->op_fusion);
+    MPI_Type_free(&tipos->tipo_lista);
+    MPI_Type_free(&tipos->tipo_vecino);
+}
@@ -0,0 +1,116 @@
+#ifndef VECINOS_H
+#define VECINOS_H
+
+#include <float.h>
+#include <mpi.h>
+
+// Estructura interna para usar qsort
+typedef struct {
+    int indice_dia;
+    float dist_sq; // Distance Squared
+} VecinoInterno;
+
+// Las listas de K vecinos se ordenan por (dist_sq, indice_dia): a igual distancia gana el día
+// más antiguo. Es un orden total, así que el resultado no depende de cómo se repartan las
+// filas entre hilos y procesos ni del orden en que se fusionen las listas.
+static inline int vecino_precede(float dist_a, int indice_a, float dist_b, int indice_b) {
+    return dist_a < dist_b || (dist_a == dist_b && indice_a < indice_b);
+}
+
+// Comparador para qsort con el mismo orden
+int comparar_vecinos(const void *a, const void *b);
+
+// Inserta un candidato en una lista de K vecinos ordenada (no hace nada si no mejora al K-ésimo)
+void insertar_vecino_ordenado(VecinoInterno *lista, int k, int indice_global, float distancia);
+
+// Fusiona dos listas ordenadas de K vecinos en 'salida' (K mejores de ambas).
+// 'salida' no puede solaparse con 'a' ni con 'b'.
+void fusionar_top_k(const VecinoInterno *a, const VecinoInterno *b, int k, VecinoInterno *salida);
+
+// Fusiona en 'destino' las listas ordenadas de K vecinos de 'num_hilos' hilos; la del hilo t
+// empieza en buffer_hilos[t * separacion]
+void fusionar_listas_hilos(const VecinoInterno *buffer_hilos, int num_hilos, long separacion, int k,
+                           VecinoInterno *destino);
+
+// Selección de los K mejores durante un recorrido, con tres estrategias:
+//   ORDENADO:  array ordenado con inserción por desplazamiento, O(K) por candidato aceptado.
+//              El más rápido con K pequeño (la lista cabe en una o dos líneas de caché).
+//   MONTICULO: montículo de máximos de K elementos, O(log K) por candidato aceptado.
+//   SELECCION: los candidatos que superan el umbral se apilan en un buffer de 2K; al llenarse,
+//              una selección parcial (tipo nth_element) deja los K mejores y ajusta el umbral.
+//              O(1) amortizado por candidato aceptado.
+// En todas el rechazo es una sola comparación con el K-ésimo actual, y el conjunto final es
+// el mismo (el orden (distancia, índice) es total). topk_finalizar deja datos[0..K) ordenado.
+typedef enum {
+    TOPK_AUTO = 0,          // ORDENADO si K <= TOPK_K_ORDENADO; si no, MONTICULO con poda y SELECCION sin ella
+    TOPK_ORDENADO,
+    TOPK_MONTICULO,
+    TOPK_SELECCION
+} EstrategiaTopK;
+
+// Límite de K para el array ordenado en modo AUTO (medido con ./bench_topk: hasta K=32 las
+// tres empatan en un recorrido real; por encima el desplazamiento O(K) pierde). SELECCION es
+// la más rápida aceptando candidatos, pero su umbral solo se ajusta al compactar el buffer:
+// con poda interesa el umbral exacto del montículo, que descarta más filas.
+#define TOPK_K_ORDENADO 32
+
+typedef struct {
+    VecinoInterno *datos;   // topk_capacidad() entradas
+    int k;
+    int usados;             // Solo SELECCION: entradas ocupadas del buffer
+    EstrategiaTopK estrategia;
+    float peor_dist;        // K-ésimo actual: un candidato entra solo si le precede
+    int peor_indice;
+    long insertados;        // Candidatos que superaron el umbral
+} SeleccionTopK;
+
+// Estrategia concreta para K (resuelve TOPK_AUTO) y entradas que necesita su buffer.
+// 'umbral_exacto' indica que el umbral alimenta cotas de poda.
+EstrategiaTopK topk_resolver(EstrategiaTopK pedida, int k, int umbral_exacto);
+int topk_capacidad(EstrategiaTopK estrategia, int k);
+const char* topk_nombre(EstrategiaTopK estrategia);
+
+// 'datos' debe tener topk_capacidad(estrategia, k) entradas (estrategia ya resuelta)
+void topk_iniciar(SeleccionTopK *s, VecinoInterno *datos, int k, EstrategiaTopK estrategia);
+
+// Deja en datos[0..K) los K mejores ordenados (los huecos sin candidato van al final)
+void topk_finalizar(SeleccionTopK *s);
+
+// Caminos lentos de topk_insertar (solo se llaman con candidatos que mejoran el umbral)
+void topk_monticulo_sustituir(SeleccionTopK *s, int indice, float distancia);
+void topk_seleccion_anadir(SeleccionTopK *s, int indice, float distancia);
+
+// Umbral actual (distancia del K-ésimo), para las cotas de poda y el abandono temprano
+static inline float topk_umbral(const SeleccionTopK *s) {
+    return s->peor_dist;
+}
+
+static inline void topk_insertar(SeleccionTopK *s, int indice, float distancia) {
+    if (!vecino_precede(distancia, indice, s->peor_dist, s->peor_indice)) return;
+    s->insertados++;
+    if (s->estrategia == TOPK_ORDENADO) {
+        insertar_vecino_ordenado(s->datos, s->k, indice, distancia);
+        s->peor_dist = s->datos[s->k - 1].dist_sq;
+        s->peor_indice = s->datos[s->k - 1].indice_dia;
+    } else if (s->estrategia == TOPK_MONTICULO) {
+        topk_monticulo_sustituir(s, indice, distancia);
+    } else {
+        topk_seleccion_anadir(s, indice, distancia);
+    }
+}
+
+// Tipos y operación MPI para reducir listas de vecinos sin pasar por MPI_BYTE:
+//   tipo_vecino: struct {int, float} con la extensión de VecinoInterno
+//   tipo_lista:  K vecinos contiguos (una lista completa es un elemento)
+//   op_fusion:   fusiona listas elemento a elemento con fusionar_top_k; K se deduce
+//                del tamaño del tipo, así la misma operación sirve para cualquier K.
+typedef struct {
+    MPI_Datatype tipo_vecino;
+    MPI_Datatype tipo_lista;
+    MPI_Op op_fusion;
+} TiposVecinos;
+
+void crear_tipos_vecinos(int k, TiposVecinos *tipos);
+void liberar_tipos_vecinos(TiposVecinos *tipos);
+
+#endif